@@ -0,0 +1,47 @@
+import sys
+
+import pandas as pd
+
+import simulation
+
+# Compare field propagation modes (/det/field/ commands) by steps per primary
+# and events/s, at each of the standard gun momenta.
+#
+# Usage (see simulation.py): python Analysis/benchmark_field.py [events per point] [threads]
+
+num_events = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+num_threads = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+
+momenta = [0.1, 0.15, 0.2, 0.3, 0.5, 0.7, 1.0, 2.0, 3.0, 5.0, 7.0, 10.0, 14.0, 20.0]  # GeV
+
+modes = {
+    "default": [],
+    "classicalRK4": ["/det/field/stepper classicalRK4"],
+    "bogackiShampine23": ["/det/field/stepper bogackiShampine23"],
+    "exactHelix": ["/det/field/stepper exactHelix"],
+    "exactHelix, SVT deltaChord 0.1 mm": ["/det/field/stepper exactHelix",
+                                          "/det/field/region SVT_Region",
+                                          "/det/field/deltaChord 0.1 mm"],
+}
+
+setup = simulation.standard_macro(num_threads, commands="/output/setFileName benchmark_field.root\n")
+
+rows = []
+for mode, commands in modes.items():
+    macro_text = setup + "\n".join(commands) + "\n/det/field/print\n"
+    for p in momenta:
+        macro_text += f"/generator/gun/momentum {p} GeV\n/run/beamOn {num_events}\n"
+
+    output = simulation.run(macro_text, "benchmark_field", description=f"field mode {mode}")
+
+    # one transport report per /run/beamOn, in momentum order
+    steps = simulation.numbers(simulation.steps_per_primary, output)
+    rates = simulation.numbers(simulation.events_per_second, output)
+    for p, n, rate in zip(momenta, steps, rates):
+        rows.append({"mode": mode, "p [GeV]": p, "steps/primary": n, "events/s": rate})
+
+df = pd.DataFrame(rows)
+print(df.pivot(index="p [GeV]", columns="mode", values="steps/primary").to_string())
+print()
+print(df.pivot(index="p [GeV]", columns="mode", values="events/s").to_string())
+df.to_csv("Analysis/output/field_benchmark.csv", index=False)
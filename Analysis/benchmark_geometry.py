@@ -0,0 +1,49 @@
+import re
+import sys
+
+import pandas as pd
+
+import simulation
+
+# Compare the layer geometries (/det/layerMode) for construction time, peak
+# memory, steps per primary and events/s.
+#
+# Usage (see simulation.py): python Analysis/benchmark_geometry.py [events] [threads]
+
+num_events = int(sys.argv[1]) if len(sys.argv) > 1 else 5000
+num_threads = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+
+modes = ["nested", "merged", "staves"]
+
+
+def run(mode, events):
+    macro_text = simulation.standard_macro(
+        num_threads, f"/det/layerMode {mode}\n",
+        f"/output/setFileName benchmark_geometry_{mode}.root\n/run/beamOn {events}\n")
+    return simulation.run_with_memory(macro_text, "benchmark_geometry", f"layer mode {mode}")
+
+
+rows = []
+for mode in modes:
+    # a run without events for the memory of the geometry alone, then the timed run
+    _, idle_memory = run(mode, 0)
+    output, memory = run(mode, num_events)
+
+    geometry = re.search(r"Geometry \(\w+ layers\): (\d+) sensors, (\d+) logical and (\d+) physical volumes, "
+                         r"built in ([0-9.eE+-]+) ms", output)
+    rows.append({
+        "mode": mode,
+        "sensors": int(geometry.group(1)) if geometry else None,
+        "logical volumes": int(geometry.group(2)) if geometry else None,
+        "physical volumes": int(geometry.group(3)) if geometry else None,
+        "construction [ms]": float(geometry.group(4)) if geometry else float("nan"),
+        "memory at init [MB]": idle_memory,
+        "peak memory [MB]": memory,
+        "steps/primary": simulation.number(simulation.steps_per_primary, output),
+        "events/s": simulation.number(simulation.events_per_second, output),
+    })
+
+df = pd.DataFrame(rows)
+df["events/s vs nested"] = df["events/s"] / df["events/s"].iloc[0]
+print(df.to_string(index=False))
+df.to_csv("Analysis/output/geometry_benchmark.csv", index=False)
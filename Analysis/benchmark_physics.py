@@ -0,0 +1,54 @@
+import re
+import sys
+import time
+
+import pandas as pd
+
+import simulation
+
+# Compare physics lists (DetectorSimulation -p) for initialisation time, CPU time
+# per event and momentum resolution, against FTFP_BERT.
+#
+# Usage (see simulation.py): python Analysis/benchmark_physics.py [events] [physics spec ...]
+
+num_events = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+specs = sys.argv[2:] or [
+    "FTFP_BERT",
+    "lean",
+    "lean,hadronic=none",
+    "lean,em=opt1,decay=off,hadronic=none",
+]
+if specs[0] != "FTFP_BERT":
+    specs.insert(0, "FTFP_BERT")
+
+setup = simulation.standard_macro(threads=1)
+
+rows = []
+resolutions = {}
+for spec in specs:
+    name = "benchmark_" + re.sub(r"[^A-Za-z0-9]+", "_", spec)
+
+    def run(macro_text):
+        return simulation.run(macro_text, name, ["-p", spec], f"DetectorSimulation -p {spec}")
+
+    # init only, for the time to build the physics tables
+    start = time.perf_counter()
+    run(setup)
+    init_time = time.perf_counter() - start
+
+    output = run(setup + f"/output/setFileName {name}.root\n/run/beamOn {num_events}\n")
+    ms_per_event = simulation.number(r"CPU time\s+:.*\(([0-9.eE+-]+) ms/event\)", output)
+
+    resolutions[spec] = simulation.pT_resolution(simulation.fit_tracks(name))["sigma"]
+
+    rows.append({"physics": spec, "init [s]": init_time, "ms/event": ms_per_event})
+
+reference = resolutions["FTFP_BERT"]
+for row in rows:
+    ratio = resolutions[row["physics"]] / reference
+    row["sigma(pT)/FTFP_BERT mean"] = ratio.mean()
+    row["max deviation"] = (ratio - 1).abs().max()
+
+summary = pd.DataFrame(rows)
+print(summary.to_string(index=False))
+summary.to_csv("Analysis/output/physics_benchmark.csv", index=False)
@@ -0,0 +1,67 @@
+import os
+import sys
+
+import pandas as pd
+
+import simulation
+from simulation import number
+
+# Thread scaling of DetectorSimulation: the same workload at 1..N threads, for
+# each run manager, with events/s, speedup, parallel efficiency, CPU
+# utilisation and the time spent filling and merging the ntuple.
+#
+# Usage (see simulation.py):
+#   python Analysis/benchmark_threads.py [events] [max threads] [run managers...] [--pin-affinity]
+#
+# Run managers are those of DetectorSimulation --run-manager (default: mt tasking).
+# Where events/s flattens, a low CPU utilisation points to threads waiting
+# (locks, end of run), a growing ntuple time to output merging.
+
+args = [a for a in sys.argv[1:] if a != "--pin-affinity"]
+pin_affinity = "--pin-affinity" in sys.argv[1:]
+num_events = int(args[0]) if len(args) > 0 else 20000
+max_threads = int(args[1]) if len(args) > 1 else os.cpu_count()
+run_managers = args[2:] or ["mt", "tasking"]
+
+thread_counts = []
+n = 1
+while n < max_threads:
+    thread_counts.append(n)
+    n *= 2
+thread_counts.append(max_threads)
+
+name = "benchmark_threads"
+
+# Initialisation is outside the timed run, so only the event loop and the end of run are measured
+macro_text = simulation.standard_macro(commands=f"/output/setFileName {name}.root\n/run/beamOn {num_events}\n")
+
+rows = []
+for run_manager in run_managers:
+    for threads in thread_counts:
+        options = ["--run-manager", run_manager, "--threads", str(threads)]
+        if pin_affinity:
+            options.append("--pin-affinity")
+        output = simulation.run(macro_text, name, options,
+                                f"DetectorSimulation --run-manager {run_manager} --threads {threads}")
+
+        row = {
+            "run manager": run_manager,
+            "threads": threads,
+            "events/s": number(simulation.events_per_second, output),
+            "CPU utilisation [%]": number(r"CPU utilisation\s+:\s+([0-9.eE+-]+)", output),
+            "ntuple fill [s]": number(r"Ntuple fill\s+:\s+([0-9.eE+-]+)", output),
+            "ntuple merge [s]": number(r"Ntuple merge \(end\)\s+:\s+([0-9.eE+-]+)", output),
+            "output write [s]": number(r"Output written in ([0-9.eE+-]+)", output),
+        }
+        print(f"{run_manager} {threads} threads: {row['events/s']:.1f} events/s", flush=True)
+        rows.append(row)
+
+summary = pd.DataFrame(rows)
+for run_manager, group in summary.groupby("run manager"):
+    single = group.loc[group["threads"] == 1, "events/s"].iloc[0]
+    summary.loc[group.index, "speedup"] = group["events/s"] / single
+    summary.loc[group.index, "efficiency [%]"] = group["events/s"] / (single * group["threads"]) * 100
+
+print(summary.to_string(index=False))
+os.makedirs("Analysis/output", exist_ok=True)
+summary.to_csv("Analysis/output/thread_scaling.csv", index=False)
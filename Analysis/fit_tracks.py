@@ -7,21 +7,60 @@ from mpl_toolkits.mplot3d import Axes3D
 import pandas as pd
 import ROOT
 
-from helix_fitting import fit_helix
+from helix_fitting import fit_helices, kalman_fit_helices
 
 B = 1.7
 min_hits_per_track = 4
 cutoff_momentum = 50_000 # 50 GeV
 
-if len(sys.argv) < 3:
-    print("Usage: python Analysis/fit_tracks.py <input_root_file> <output_csv_file>")
+usage = ("Usage: python Analysis/fit_tracks.py <input_root_file> <output_csv_file> [B]\n"
+         "       [--resolutions r1,r2,... (um)] [--seed n] [--kalman w1,w2,w3] [--hit-resolution r (um)]\n"
+         "--resolutions smears the truth hits of a /output/storeTruthHits run at each\n"
+         "resolution and writes one <output>_<r>um.csv per resolution\n"
+         "--kalman fits with the Kalman filter, for the run's /det/materialWidth1/2/3 and\n"
+         "hits of --hit-resolution (default 7 um) unless smeared with --resolutions")
+
+# optional flags, for files with truth hits
+resolutions = None
+smearing_seed = 0
+material_widths = None
+hit_resolution = 7
+args = sys.argv[1:]
+if "--resolutions" in args:
+    i = args.index("--resolutions")
+    resolutions = [float(r) for r in args[i + 1].split(",")]
+    del args[i:i + 2]
+if "--seed" in args:
+    i = args.index("--seed")
+    smearing_seed = int(args[i + 1])
+    del args[i:i + 2]
+if "--kalman" in args:
+    i = args.index("--kalman")
+    material_widths = [float(w) for w in args[i + 1].split(",")]
+    del args[i:i + 2]
+if "--hit-resolution" in args:
+    i = args.index("--hit-resolution")
+    hit_resolution = float(args[i + 1])
+    del args[i:i + 2]
+
+if len(args) < 2:
+    print(usage)
     sys.exit(1)
 
-if len(sys.argv) > 3:
-    B = float(sys.argv[3])
+if len(args) > 2:
+    B = float(args[2])
 
-input_root_file = "DetectorSimulation/output/" + sys.argv[1]
-output_csv_file = "Analysis/output/" + sys.argv[2]
+input_root_file = "DetectorSimulation/output/" + args[0]
+output_csv_file = "Analysis/output/" + args[1]
+
+if resolutions is not None:
+    from hit_smearing import smear_hits
+    stem = output_csv_file[:-4] if output_csv_file.endswith(".csv") else output_csv_file
+    # hit positions are in mm
+    outputs = {r: (r * 1e-3, f"{stem}_{r:g}um.csv") for r in resolutions}
+else:
+    outputs = {None: (None, output_csv_file)}
+kalman = material_widths is not None
 
 file = ROOT.TFile.Open(input_root_file)
 tracks = file.Get("tracks")
@@ -29,32 +68,56 @@ tracks = file.Get("tracks")
 # treat each entry as one primary track, with hit position vectors stored in branches
 num_tracks = tracks.GetEntries()
 
-# convenience for filling DataFrame
-data = []
+# Hits of all selected tracks, track i owning offsets[i]:offsets[i + 1], so
+# they can be smeared and fitted in one call each
+x, y, z, layers = [], [], [], []
+offsets = [0]
+columns = {key: [] for key in ("pX", "pY", "pZ", "EventID", "TrackID", "NumHits")}
 
 for i in range(num_tracks):
     tracks.GetEntry(i)
     if tracks.NumHits < min_hits_per_track:
         continue
-    
-    x = np.array(tracks.HitPositionX)
-    y = np.array(tracks.HitPositionY)
-    z = np.array(tracks.HitPositionZ)
 
-    d0, z0, phi0, fitted_pT, tanl = fit_helix(x, y, z, B)
+    x.extend(tracks.HitPositionX)
+    y.extend(tracks.HitPositionY)
+    z.extend(tracks.HitPositionZ)
+    if resolutions is not None or kalman:
+        layers.extend(tracks.HitLayerID)
+    offsets.append(len(x))
+
+    columns["pX"].append(tracks.MomentumX)
+    columns["pY"].append(tracks.MomentumY)
+    columns["pZ"].append(tracks.MomentumZ)
+    columns["EventID"].append(tracks.EventID)
+    columns["TrackID"].append(tracks.TrackID)
+    columns["NumHits"].append(tracks.NumHits)
+
+pX, pY, pZ = (np.array(columns[key], dtype=np.float64) for key in ("pX", "pY", "pZ"))
+p = np.sqrt(pX ** 2 + pY ** 2 + pZ ** 2)
+eta = np.arctanh(pZ / p)
+
+for key, (resolution, csv_file) in outputs.items():
+    if resolution is None:
+        hx, hy, hz = x, y, z
+    else:
+        hx, hy, hz = smear_hits(x, y, z, layers, offsets, columns["EventID"], columns["TrackID"],
+                                resolution, smearing_seed)
+
+    if kalman:
+        # hit positions are in mm
+        sigma = resolution if resolution is not None else hit_resolution * 1e-3
+        d0, z0, phi0, fitted_pT, tanl, chi2 = kalman_fit_helices(hx, hy, hz, layers, offsets, B, sigma,
+                                                                 material_widths)
+    else:
+        d0, z0, phi0, fitted_pT, tanl = fit_helices(hx, hy, hz, offsets, B)
 
     fitted_pZ = tanl * fitted_pT
     fitted_p = np.sqrt(fitted_pT ** 2 + fitted_pZ ** 2)
+    keep = ~(fitted_p > cutoff_momentum)
 
-    pX, pY, pZ = tracks.MomentumX, tracks.MomentumY, tracks.MomentumZ
-    p = np.sqrt(pX ** 2 + pY ** 2 + pZ ** 2)
-    eta = np.arctanh(pZ / p)
-
-    if fitted_p > cutoff_momentum:
-        continue
-
-    data.append({
-        "True p": round(p),
+    df = pd.DataFrame({
+        "True p": np.round(p).astype(np.int64),
         "True pX": pX,
         "True pY": pY,
         "True pZ": pZ,
@@ -64,9 +127,9 @@ for i in range(num_tracks):
         "Fit phi0": phi0,
         "Fit pT": fitted_pT,
         "Fit tanl": tanl,
-        "NumHits": tracks.NumHits
+        "NumHits": columns["NumHits"],
     })
-
-
-df = pd.DataFrame(data)
-df.to_csv(output_csv_file, index=False)    
\ No newline at end of file
+    if kalman:
+        df["Fit chi2"] = chi2
+    df = df[keep]
+    df.to_csv(csv_file, index=False)
@@ -1,5 +1,7 @@
 import numpy as np
 
+import reconstruction
+
 c = 299792458 
 q_e = 1.602176634e-19
 
@@ -82,6 +84,45 @@ def fit_helix(x, y, z, B):
 
     return d0, z0, phi0, pT_MeV, tanl
 
+# Fit many tracks at once, returning arrays (d0, z0, phi0, pT, tanl). Track i
+# owns hits offsets[i]:offsets[i + 1]. Uses the batched C++ fitter of the
+# Reconstruction library (HelixFit.hh) if it is built, else fit_helix per track.
+def fit_helices(x, y, z, offsets, B, threads=0):
+    x = np.ascontiguousarray(x, dtype=np.float64)
+    y = np.ascontiguousarray(y, dtype=np.float64)
+    z = np.ascontiguousarray(z, dtype=np.float64)
+    offsets = np.ascontiguousarray(offsets, dtype=np.int64)
+    num_tracks = len(offsets) - 1
+    results = np.empty((5, num_tracks))
+
+    if reconstruction.available():
+        d0, z0, phi0, pT, tanl = results
+        reconstruction.load().b8_fit_helices(B, num_tracks, offsets, x, y, z, d0, z0, phi0, pT, tanl, threads)
+    else:
+        for i in range(num_tracks):
+            hits = slice(offsets[i], offsets[i + 1])
+            results[:, i] = fit_helix(x[hits], y[hits], z[hits], B)
+    return tuple(results)
+
+# Kalman filter fit of many tracks (KalmanFit.hh) with multiple scattering in
+# the material of DetectorSimulation, given its /det/materialWidth1/2/3, and
+# hits of the given resolution (mm). layers are the HitLayerID of the hits.
+# Returns arrays (d0, z0, phi0, pT, tanl, chi2). Needs the Reconstruction library.
+def kalman_fit_helices(x, y, z, layers, offsets, B, resolution, material_widths=(0.0007, 0.0025, 0.0055),
+                       mass=139.57, threads=0):
+    x = np.ascontiguousarray(x, dtype=np.float64)
+    y = np.ascontiguousarray(y, dtype=np.float64)
+    z = np.ascontiguousarray(z, dtype=np.float64)
+    layers = np.ascontiguousarray(layers, dtype=np.int32)
+    offsets = np.ascontiguousarray(offsets, dtype=np.int64)
+    num_tracks = len(offsets) - 1
+    results = np.empty((6, num_tracks))
+
+    d0, z0, phi0, pT, tanl, chi2 = results
+    reconstruction.load().b8_kalman_fit_tracks(*material_widths, B, resolution, mass, num_tracks, offsets,
+                                               x, y, z, layers, d0, z0, phi0, pT, tanl, chi2, threads)
+    return tuple(results)
+
 # Equation of the helix
 def helix(x_c, y_c, z0, pZ, pT, R, phi):
     x = x_c + R * np.cos(phi)
@@ -0,0 +1,30 @@
+import numpy as np
+
+import reconstruction
+
+# Python access to the hit smearing of the C++ Reconstruction library, so the
+# same random numbers are used here as in the C++ tools (see reconstruction.py)
+
+
+def smear_hits(x, y, z, layer, offsets, event_ids, track_ids, resolution, seed=0):
+    """Smear truth hits of many tracks, returning new x, y, z arrays.
+
+    Track i owns hits offsets[i]:offsets[i + 1]. resolution is in mm, like the
+    hit positions. The result only depends on (seed, event ID, track ID).
+    """
+    x = np.array(x, dtype=np.float64)
+    y = np.array(y, dtype=np.float64)
+    z = np.array(z, dtype=np.float64)
+    offsets = np.ascontiguousarray(offsets, dtype=np.int64)
+    reconstruction.load().b8_smear_hits(resolution, seed, len(offsets) - 1,
+                                        np.ascontiguousarray(event_ids, dtype=np.int64),
+                                        np.ascontiguousarray(track_ids, dtype=np.int64),
+                                        offsets,
+                                        np.ascontiguousarray(layer, dtype=np.int32),
+                                        x, y, z)
+    return x, y, z
+
+
+def smear_track(x, y, z, layer, event_id, track_id, resolution, seed=0):
+    """Smear the truth hits of one track, returning new x, y, z arrays."""
+    return smear_hits(x, y, z, layer, [0, len(x)], [event_id], [track_id], resolution, seed)
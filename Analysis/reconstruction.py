@@ -0,0 +1,42 @@
+import ctypes
+import os
+
+import numpy as np
+
+# The C++ Reconstruction library, loaded with ctypes. Build it with
+#   cmake -S Reconstruction -B Reconstruction/build && cmake --build Reconstruction/build
+# or point B8_RECONSTRUCTION_LIB at libB8Reconstruction.so
+
+_default_lib = os.path.join(os.path.dirname(__file__), "..", "Reconstruction", "build", "libB8Reconstruction.so")
+_lib = None
+
+double_p = np.ctypeslib.ndpointer(np.float64, flags="C_CONTIGUOUS")
+int64_p = np.ctypeslib.ndpointer(np.int64, flags="C_CONTIGUOUS")
+int32_p = np.ctypeslib.ndpointer(np.int32, flags="C_CONTIGUOUS")
+
+
+def available():
+    """True if the library has been built (or B8_RECONSTRUCTION_LIB is set)."""
+    return _lib is not None or os.path.exists(os.environ.get("B8_RECONSTRUCTION_LIB", _default_lib))
+
+
+def load():
+    global _lib
+    if _lib is None:
+        lib = ctypes.CDLL(os.environ.get("B8_RECONSTRUCTION_LIB", _default_lib))
+        lib.b8_smear_hits.restype = None
+        lib.b8_smear_hits.argtypes = [ctypes.c_double, ctypes.c_uint64, ctypes.c_size_t,
+                                      int64_p, int64_p, int64_p, int32_p,
+                                      double_p, double_p, double_p]
+        lib.b8_fit_helices.restype = None
+        lib.b8_fit_helices.argtypes = [ctypes.c_double, ctypes.c_size_t, int64_p,
+                                       double_p, double_p, double_p,
+                                       double_p, double_p, double_p, double_p, double_p,
+                                       ctypes.c_uint]
+        lib.b8_kalman_fit_tracks.restype = None
+        lib.b8_kalman_fit_tracks.argtypes = [ctypes.c_double] * 6 + [ctypes.c_size_t, int64_p,
+                                             double_p, double_p, double_p, int32_p,
+                                             double_p, double_p, double_p, double_p, double_p, double_p,
+                                             ctypes.c_uint]
+        _lib = lib
+    return _lib
@@ -0,0 +1,114 @@
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+import pandas as pd
+
+# Running DetectorSimulation from the benchmark and validation scripts, which
+# are run from the repository root after building DetectorSimulation:
+#   python Analysis/<script>.py [arguments]
+# Each run writes its macro next to the executable, runs it there and removes
+# it again; a failed run prints the end of its output and stops the script.
+
+simulation_dir = "DetectorSimulation"
+executable = "build/DetectorSimulation"
+
+# The default configuration: material, resolution, field and a pi+ gun
+detector_setup = """/det/materialWidth1 0.0007
+/det/materialWidth2 0.0025
+/det/materialWidth3 0.0055
+/det/res 7 um
+"""
+beam_setup = """/globalField/setValue 0 0 1.7 tesla
+/gun/particle pi+
+"""
+
+# Numbers of the transport report
+steps_per_primary = r"Steps per primary\s+:\s+([0-9.eE+-]+)"
+events_per_second = r"Wall time\s+:.*\(([0-9.eE+-]+) events/s\)"
+
+
+def standard_macro(threads=None, geometry="", commands=""):
+    """The default configuration, with geometry commands before /run/initialize
+    and the given commands (output file, /run/beamOn...) after it."""
+    macro_text = detector_setup + geometry
+    if threads is not None:
+        macro_text += f"/run/numberOfThreads {threads}\n"
+    return macro_text + "/run/initialize\n" + beam_setup + commands
+
+
+def _write_macro(macro_text, name):
+    macro = os.path.join(simulation_dir, f"{name}.mac")
+    with open(macro, "w") as f:
+        f.write(macro_text)
+    return macro
+
+
+def _fail(output, description):
+    print(output[-2000:])
+    sys.exit(f"{description} failed")
+
+
+def run(macro_text, name, options=(), description=None):
+    """Run the macro as <name>.mac with the command line options, returning the output."""
+    macro = _write_macro(macro_text, name)
+    result = subprocess.run([executable, *options, f"{name}.mac"], cwd=simulation_dir,
+                            capture_output=True, text=True)
+    os.remove(macro)
+    if result.returncode != 0:
+        _fail(result.stdout + result.stderr, description or f"DetectorSimulation {name}")
+    return result.stdout
+
+
+def run_with_memory(macro_text, name, description=None):
+    """As run, also returning the peak resident memory of the run in MB."""
+    macro = _write_macro(macro_text, name)
+    # wait4 gives the peak resident memory of this run alone
+    with tempfile.TemporaryFile(mode="w+") as log:
+        pid = os.fork()
+        if pid == 0:
+            os.chdir(simulation_dir)
+            os.dup2(log.fileno(), 1)
+            os.dup2(log.fileno(), 2)
+            os.execv(executable, [executable, f"{name}.mac"])
+        _, status, usage = os.wait4(pid, 0)
+        log.seek(0)
+        output = log.read()
+    os.remove(macro)
+    if os.waitstatus_to_exitcode(status) != 0:
+        _fail(output, description or f"DetectorSimulation {name}")
+    return output, usage.ru_maxrss / 1024
+
+
+def number(pattern, output):
+    """The first number of the pattern in the output, NaN if it is not there."""
+    match = re.search(pattern, output)
+    return float(match.group(1)) if match else float("nan")
+
+
+def numbers(pattern, output):
+    """Every number of the pattern in the output, e.g. one per /run/beamOn."""
+    return [float(value) for value in re.findall(pattern, output)]
+
+
+def fit_tracks(name):
+    """Fit output/<name>.root with fit_tracks.py, returning the CSV file."""
+    subprocess.run([sys.executable, "Analysis/fit_tracks.py", f"{name}.root", f"{name}.csv"], check=True)
+    return f"Analysis/output/{name}.csv"
+
+
+def pT_resolution(csv_file):
+    """Relative pT resolution, from the central 68% of residuals, and mean hits per true momentum."""
+    df = pd.read_csv(csv_file)
+    true_pT = np.hypot(df["True pX"], df["True pY"])
+    df["residual"] = (df["Fit pT"] - true_pT) / true_pT
+
+    def sigma(r):
+        q16, q84 = np.percentile(r, [16, 84])
+        return (q84 - q16) / 2
+
+    grouped = df.groupby("True p")
+    return pd.DataFrame({"sigma": grouped["residual"].apply(sigma), "hits": grouped["NumHits"].mean()})
@@ -0,0 +1,76 @@
+import os
+import sys
+
+import numpy as np
+import pandas as pd
+import ROOT
+
+import simulation
+
+# Validate the merged layer geometry (/det/layerMode merged) against the nested
+# one: momentum resolution and hits per track at each gun momentum, hit
+# positions relative to the silicon surfaces, and throughput.
+#
+# Usage (see simulation.py): python Analysis/validate_layer_mode.py [events] [threads]
+
+num_events = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+num_threads = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+
+barrel_radii = [38.0, 50.0, 122.0, 272.0, 422.0]  # mm, as DetectorConstruction
+si_width = 0.05  # mm
+
+
+def simulate(mode, commands, name):
+    macro_text = simulation.standard_macro(num_threads, f"/det/layerMode {mode}\n", commands)
+    return simulation.run(macro_text, name, description=f"layer mode {mode}")
+
+
+def surface_distances(root_file):
+    # distance of truth barrel hits from the nearest silicon surface, in um
+    file = ROOT.TFile.Open(root_file)
+    tracks = file.Get("tracks")
+    distances = []
+    for entry in tracks:
+        for x, y, layer in zip(entry.HitPositionX, entry.HitPositionY, entry.HitLayerID):
+            if layer < len(barrel_radii):
+                dr = abs(np.hypot(x, y) - barrel_radii[layer])
+                distances.append(abs(dr - si_width / 2) * 1000)
+    return np.array(distances)
+
+
+rows = []
+results = {}
+for mode in ["nested", "merged"]:
+    name = f"layer_{mode}"
+
+    output = simulate(mode, f"/output/setFileName {name}.root\n/run/beamOn {num_events}\n", name)
+    results[mode] = simulation.pT_resolution(simulation.fit_tracks(name))
+
+    simulate(mode, f"/output/storeTruthHits true\n/output/setFileName {name}_truth.root\n/run/beamOn 2000\n",
+             name + "_truth")
+    distances = surface_distances(os.path.join(simulation.simulation_dir, "output", f"{name}_truth.root"))
+
+    rows.append({
+        "mode": mode,
+        "steps/primary": simulation.number(simulation.steps_per_primary, output),
+        "events/s": simulation.number(simulation.events_per_second, output),
+        "barrel hits on surface [%]": 100 * np.mean(distances < 1) if len(distances) else float("nan"),
+        "max distance [um]": distances.max() if len(distances) else float("nan"),
+    })
+
+comparison = pd.DataFrame({
+    "sigma(pT)/pT nested": results["nested"]["sigma"],
+    "sigma(pT)/pT merged": results["merged"]["sigma"],
+    "hits nested": results["nested"]["hits"],
+    "hits merged": results["merged"]["hits"],
+})
+comparison["ratio"] = comparison["sigma(pT)/pT merged"] / comparison["sigma(pT)/pT nested"]
+print(comparison.to_string())
+print()
+
+summary = pd.DataFrame(rows)
+summary["speedup"] = summary["events/s"] / summary["events/s"].iloc[0]
+print(summary.to_string(index=False))
+
+comparison.to_csv("Analysis/output/layer_mode_resolution.csv")
+summary.to_csv("Analysis/output/layer_mode_throughput.csv", index=False)
@@ -0,0 +1,234 @@
+import argparse
+import concurrent.futures
+import hashlib
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+# Run a simulation campaign through a content-addressed cache.
+#
+# Every run is keyed by a hash of its effective configuration: the macro
+# commands (with /control/execute expanded), the physics list, the seed and
+# the DetectorSimulation sources, which hold the DetectorConstruction defaults.
+# Every fit is keyed by its run's key, its arguments and the analysis sources.
+# Only entries missing from the cache are run, in parallel over local cores;
+# an edit to one macro re-simulates one configuration, an edit to the fitting
+# re-runs only the fits.
+#
+# Usage, from the repository root after building DetectorSimulation:
+#   python Campaign/run_campaign.py [campaign.json] [--jobs N] [--threads T]
+#                                   [--events N] [--dry-run]
+#
+# Results are linked by name into Campaign/results/.
+
+root_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+simulation_dir = os.path.join(root_dir, "DetectorSimulation")
+executable = os.path.join(simulation_dir, "build", "DetectorSimulation")
+cache_dir = os.path.join(root_dir, "Campaign", "cache")
+results_dir = os.path.join(root_dir, "Campaign", "results")
+
+# Everything the output of a run or a fit depends on besides its configuration
+simulation_sources = ["DetectorSimulation/DetectorSimulation.cc", "DetectorSimulation/CMakeLists.txt",
+                      "DetectorSimulation/include", "DetectorSimulation/src",
+                      "CollisionSimulation/BinaryEventFormat.h", "Reconstruction/include/CounterRNG.hh"]
+fit_sources = ["Analysis/fit_tracks.py", "Analysis/helix_fitting.py", "Analysis/hit_smearing.py",
+               "Analysis/reconstruction.py", "Reconstruction/include", "Reconstruction/src"]
+
+
+def hash_sources(paths):
+    digest = hashlib.sha256()
+    for path in paths:
+        full = os.path.join(root_dir, path)
+        files = [full] if os.path.isfile(full) else sorted(
+            os.path.join(d, f) for d, _, names in os.walk(full) for f in names)
+        for name in files:
+            digest.update(os.path.relpath(name, root_dir).encode())
+            with open(name, "rb") as f:
+                digest.update(f.read())
+    return digest.hexdigest()
+
+
+def expand_macro(path, events=None):
+    """Macro commands with comments removed and /control/execute expanded.
+    The output file name is left out, the cache decides where the output goes."""
+    commands = []
+    with open(os.path.join(simulation_dir, path)) as f:
+        for line in f:
+            line = " ".join(line.split("#")[0].split())
+            if not line or line.startswith("/output/setFileName"):
+                continue
+            if line.startswith("/control/execute "):
+                commands += expand_macro(line.split()[1], events)
+                continue
+            if events is not None and line.startswith("/run/beamOn"):
+                line = f"/run/beamOn {events}"
+            commands.append(line)
+    return commands
+
+
+def key_of(*parts):
+    return hashlib.sha256(json.dumps(parts, sort_keys=True).encode()).hexdigest()
+
+
+def entry_dir(key):
+    return os.path.join(cache_dir, key[:2], key)
+
+
+def is_cached(key):
+    # meta.json is written last, so a run that died half way is not cached
+    return os.path.exists(os.path.join(entry_dir(key), "meta.json"))
+
+
+def simulate(job):
+    """Run one configuration into a temporary directory, then move it into the cache."""
+    final = entry_dir(job["key"])
+    work = final + f".tmp{os.getpid()}"
+    shutil.rmtree(work, ignore_errors=True)
+    os.makedirs(work)
+
+    # RunAction writes to output/<file name>, relative to DetectorSimulation
+    output = os.path.relpath(os.path.join(work, "sim.root"), os.path.join(simulation_dir, "output"))
+    seed = job["seed"]
+    commands = [f"/run/numberOfThreads {job['threads']}", f"/random/runSeed {seed}"]
+    for command in job["commands"]:
+        if command.startswith("/run/beamOn"):
+            commands.append(f"/output/setFileName {output}")
+        commands.append(command)
+    macro = os.path.join(work, "run.mac")
+    with open(macro, "w") as f:
+        f.write("\n".join(commands) + "\n")
+
+    start = time.perf_counter()
+    with open(os.path.join(work, "log.txt"), "w") as log:
+        result = subprocess.run([executable, "-p", job["physics"], macro], cwd=simulation_dir,
+                                stdout=log, stderr=subprocess.STDOUT)
+    seconds = time.perf_counter() - start
+    if result.returncode != 0 or not os.path.exists(os.path.join(work, "sim.root")):
+        return job["name"], False, seconds
+
+    with open(os.path.join(work, "meta.json"), "w") as f:
+        json.dump({k: job[k] for k in ("name", "key", "physics", "seed", "commands", "code")} |
+                  {"seconds": seconds}, f, indent=2)
+    shutil.rmtree(final, ignore_errors=True)
+    os.rename(work, final)
+    return job["name"], True, seconds
+
+
+def fit(job):
+    final = entry_dir(job["key"])
+    work = final + f".tmp{os.getpid()}"
+    shutil.rmtree(work, ignore_errors=True)
+    os.makedirs(work)
+
+    # fit_tracks.py reads from DetectorSimulation/output/ and writes to Analysis/output/
+    sim_root = os.path.join(entry_dir(job["run_key"]), "sim.root")
+    input_file = os.path.relpath(sim_root, os.path.join(simulation_dir, "output"))
+    output_file = os.path.relpath(os.path.join(work, "fit.csv"), os.path.join(root_dir, "Analysis", "output"))
+
+    start = time.perf_counter()
+    with open(os.path.join(work, "log.txt"), "w") as log:
+        result = subprocess.run([sys.executable, "Analysis/fit_tracks.py", input_file, output_file] + job["args"],
+                                cwd=root_dir, stdout=log, stderr=subprocess.STDOUT)
+    seconds = time.perf_counter() - start
+    if result.returncode != 0:
+        return job["name"], False, seconds
+
+    with open(os.path.join(work, "meta.json"), "w") as f:
+        json.dump({k: job[k] for k in ("name", "key", "run_key", "args", "code")} | {"seconds": seconds}, f, indent=2)
+    shutil.rmtree(final, ignore_errors=True)
+    os.rename(work, final)
+    return job["name"], True, seconds
+
+
+def run_pool(function, jobs, num_workers):
+    failed = []
+    with concurrent.futures.ProcessPoolExecutor(max_workers=num_workers) as pool:
+        for name, ok, seconds in pool.map(function, jobs):
+            print(f"  {name}: {'done' if ok else 'FAILED'} in {seconds:.0f} s")
+            if not ok:
+                failed.append(name)
+    return failed
+
+
+def link_results(name, key):
+    # results/<name>.* point at the current cache entry of each run
+    os.makedirs(results_dir, exist_ok=True)
+    for file in os.listdir(entry_dir(key)):
+        stem, extension = os.path.splitext(file)
+        if stem not in ("sim", "fit") and not stem.startswith("fit_"):
+            continue
+        link = os.path.join(results_dir, name + stem[3:] + extension)
+        if os.path.lexists(link):
+            os.remove(link)
+        os.symlink(os.path.relpath(os.path.join(entry_dir(key), file), results_dir), link)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run a simulation campaign through a content-addressed cache")
+    parser.add_argument("campaign", nargs="?", default=os.path.join(root_dir, "Campaign", "standard_campaign.json"))
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel jobs (default: all cores)")
+    parser.add_argument("--threads", type=int, default=1, help="Geant4 threads per simulation job")
+    parser.add_argument("--events", type=int, help="override the number of events of every run")
+    parser.add_argument("--dry-run", action="store_true", help="only report what would run")
+    args = parser.parse_args()
+
+    with open(args.campaign) as f:
+        campaign = json.load(f)
+
+    sim_code = hash_sources(simulation_sources)
+    fit_code = hash_sources(fit_sources)
+
+    sim_jobs, fit_jobs, keys = [], [], {}
+    for run in campaign["runs"]:
+        physics = run.get("physics", campaign.get("physics", "FTFP_BERT"))
+        seed = run.get("seed", campaign.get("seed", 12345))
+        commands = expand_macro(run["macro"], args.events)
+        # the thread count is not part of the key: every event is seeded from the
+        # run seed and its event ID whatever the number of threads
+        run_key = key_of("simulation", commands, physics, seed, sim_code)
+        fit_args = run.get("fit_args", [])
+        fit_key = key_of("fit", run_key, fit_args, fit_code)
+        keys[run["name"]] = (run_key, fit_key)
+
+        if not is_cached(run_key):
+            sim_jobs.append({"name": run["name"], "key": run_key, "physics": physics, "seed": seed,
+                             "commands": commands, "code": sim_code, "threads": args.threads})
+        if not is_cached(fit_key):
+            fit_jobs.append({"name": run["name"], "key": fit_key, "run_key": run_key, "args": fit_args,
+                             "code": fit_code})
+
+    num_runs = len(campaign["runs"])
+    print(f"{num_runs - len(sim_jobs)}/{num_runs} simulations and {num_runs - len(fit_jobs)}/{num_runs} fits cached")
+    for job in sim_jobs:
+        print(f"  simulate {job['name']} ({job['key'][:12]})")
+    for job in fit_jobs:
+        print(f"  fit {job['name']} ({job['key'][:12]})")
+    if args.dry_run:
+        return
+
+    os.makedirs(os.path.join(simulation_dir, "output"), exist_ok=True)
+    os.makedirs(os.path.join(root_dir, "Analysis", "output"), exist_ok=True)
+
+    failed = []
+    if sim_jobs:
+        print("Simulating")
+        failed = run_pool(simulate, sim_jobs, max(1, args.jobs // args.threads))
+    fit_jobs = [job for job in fit_jobs if job["name"] not in failed]
+    if fit_jobs:
+        print("Fitting")
+        failed += run_pool(fit, fit_jobs, args.jobs)
+
+    for run in campaign["runs"]:
+        if run["name"] not in failed:
+            for key in keys[run["name"]]:
+                link_results(run["name"], key)
+
+    if failed:
+        sys.exit(f"failed: {', '.join(failed)} (see log.txt in their cache entries)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,322 @@
+// Compact binary event format written by CollisionSimulation and read by
+// DetectorSimulation (/generator/mode hepmc with a .b8ev file).
+//
+// Only what the detector simulation consumes is stored: final state particles
+// grouped by production vertex. Events are length-prefixed and stored in
+// blocks, each optionally compressed with zstd, so blocks can be encoded in
+// parallel and decoded one at a time.
+//
+// File layout (little endian):
+//   FileHeader
+//   repeated: BlockHeader, storedSize bytes of (possibly compressed) payload
+// Block payload: repeated events, each
+//   uint32 length (of the rest of the record)
+//   int64 eventNumber, uint32 numVertices
+//   per vertex: double x, y, z [mm], t [mm/c], uint32 numParticles
+//   per particle: int32 pdg, double px, py, pz [GeV]
+
+#ifndef BinaryEventFormat_h
+#define BinaryEventFormat_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef B8_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace B8Event
+{
+
+struct Particle {
+    std::int32_t pdg;
+    double px, py, pz;
+};
+
+struct Vertex {
+    double x, y, z, t;
+    std::vector<Particle> particles;
+};
+
+struct Event {
+    std::int64_t eventNumber = -1;
+    std::vector<Vertex> vertices;
+};
+
+enum Compression : std::uint32_t { kNone = 0, kZstd = 1 };
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t compression;
+    std::uint64_t numEvents;
+    std::uint64_t reserved;
+};
+
+struct BlockHeader {
+    std::uint32_t storedSize;
+    std::uint32_t rawSize;
+    std::uint32_t numEvents;
+    std::uint32_t reserved;
+};
+
+constexpr char kMagic[8] = {'B', '8', 'E', 'V', 'E', 'N', 'T', 'S'};
+constexpr std::uint32_t kVersion = 1;
+
+inline bool HasExtension(const std::string &fileName)
+{
+    auto ends = [&](const std::string &suffix) {
+        return fileName.size() >= suffix.size()
+            && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return ends(".b8ev") || ends(".b8ev.zst");
+}
+
+template <typename T>
+inline void Put(std::vector<char> &buffer, const T &value)
+{
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Every read is checked against the end of the record or block, so a
+// truncated or corrupt file throws instead of reading past the buffer
+[[noreturn]] inline void Corrupt()
+{
+    throw std::runtime_error("corrupt B8 event record");
+}
+
+template <typename T>
+inline T Get(const char *&cursor, const char *end)
+{
+    if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(T)))
+        Corrupt();
+    T value;
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+// Append one length-prefixed event record to a block payload
+inline void Encode(const Event &event, std::vector<char> &buffer)
+{
+    std::size_t lengthPos = buffer.size();
+    Put<std::uint32_t>(buffer, 0);
+
+    Put<std::int64_t>(buffer, event.eventNumber);
+    Put<std::uint32_t>(buffer, event.vertices.size());
+    for (const auto &vertex : event.vertices)
+    {
+        Put(buffer, vertex.x);
+        Put(buffer, vertex.y);
+        Put(buffer, vertex.z);
+        Put(buffer, vertex.t);
+        Put<std::uint32_t>(buffer, vertex.particles.size());
+        for (const auto &particle : vertex.particles)
+        {
+            Put(buffer, particle.pdg);
+            Put(buffer, particle.px);
+            Put(buffer, particle.py);
+            Put(buffer, particle.pz);
+        }
+    }
+
+    std::uint32_t length = buffer.size() - lengthPos - sizeof(std::uint32_t);
+    std::memcpy(buffer.data() + lengthPos, &length, sizeof(length));
+}
+
+// Decode the event record at cursor, which must end by end, and advance past it
+inline void Decode(const char *&cursor, const char *end, Event &event)
+{
+    auto length = Get<std::uint32_t>(cursor, end);
+    if (length > static_cast<std::size_t>(end - cursor))
+        Corrupt();
+    end = cursor + length;
+
+    // Counts are checked against the bytes left before anything is allocated
+    constexpr std::size_t kVertexSize = 4 * sizeof(double) + sizeof(std::uint32_t);
+    constexpr std::size_t kParticleSize = sizeof(std::int32_t) + 3 * sizeof(double);
+    auto count = [&](std::size_t recordSize) {
+        auto n = Get<std::uint32_t>(cursor, end);
+        if (n > static_cast<std::size_t>(end - cursor) / recordSize)
+            Corrupt();
+        return n;
+    };
+
+    event.eventNumber = Get<std::int64_t>(cursor, end);
+    event.vertices.resize(count(kVertexSize));
+    for (auto &vertex : event.vertices)
+    {
+        vertex.x = Get<double>(cursor, end);
+        vertex.y = Get<double>(cursor, end);
+        vertex.z = Get<double>(cursor, end);
+        vertex.t = Get<double>(cursor, end);
+        vertex.particles.resize(count(kParticleSize));
+        for (auto &particle : vertex.particles)
+        {
+            particle.pdg = Get<std::int32_t>(cursor, end);
+            particle.px = Get<double>(cursor, end);
+            particle.py = Get<double>(cursor, end);
+            particle.pz = Get<double>(cursor, end);
+        }
+    }
+    cursor = end;
+}
+
+// A block of encoded events, ready to be written. Compress() can run on any
+// thread; the writer only copies bytes.
+struct Block {
+    std::vector<char> payload;
+    std::uint32_t rawSize = 0;
+    std::uint32_t numEvents = 0;
+
+    void Add(const Event &event)
+    {
+        Encode(event, payload);
+        rawSize = payload.size();
+        numEvents++;
+    }
+
+    void Compress(Compression compression, int level = 3)
+    {
+        if (compression == kNone)
+            return;
+#ifdef B8_WITH_ZSTD
+        std::vector<char> compressed(ZSTD_compressBound(payload.size()));
+        std::size_t size = ZSTD_compress(compressed.data(), compressed.size(), payload.data(), payload.size(), level);
+        if (ZSTD_isError(size))
+            throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(size));
+        compressed.resize(size);
+        payload.swap(compressed);
+#else
+        (void)level;
+        throw std::runtime_error("built without zstd support");
+#endif
+    }
+};
+
+class Writer
+{
+public:
+    Writer(const std::string &fileName, Compression compression)
+        : fOut(fileName, std::ios::binary | std::ios::trunc), fCompression(compression)
+    {
+        if (!fOut)
+            throw std::runtime_error("cannot open " + fileName);
+        WriteHeader();
+    }
+
+    ~Writer() { Close(); }
+
+    Compression GetCompression() const { return fCompression; }
+
+    void WriteBlock(const Block &block)
+    {
+        BlockHeader header{static_cast<std::uint32_t>(block.payload.size()), block.rawSize, block.numEvents, 0};
+        fOut.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        fOut.write(block.payload.data(), block.payload.size());
+        fNumEvents += block.numEvents;
+    }
+
+    void Close()
+    {
+        if (!fOut.is_open())
+            return;
+        // Event count is only known at the end
+        fOut.seekp(0);
+        WriteHeader();
+        fOut.close();
+    }
+
+private:
+    void WriteHeader()
+    {
+        FileHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.compression = fCompression;
+        header.numEvents = fNumEvents;
+        fOut.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    std::ofstream fOut;
+    Compression fCompression;
+    std::uint64_t fNumEvents = 0;
+};
+
+class Reader
+{
+public:
+    explicit Reader(const std::string &fileName)
+        : fIn(fileName, std::ios::binary)
+    {
+        if (!fIn.read(reinterpret_cast<char *>(&fHeader), sizeof(fHeader))
+            || std::memcmp(fHeader.magic, kMagic, sizeof(kMagic)) != 0)
+            throw std::runtime_error(fileName + " is not a B8 binary event file");
+        if (fHeader.version != kVersion)
+            throw std::runtime_error(fileName + " has unsupported version " + std::to_string(fHeader.version));
+#ifndef B8_WITH_ZSTD
+        if (fHeader.compression == kZstd)
+            throw std::runtime_error(fileName + " is zstd compressed, but zstd support was not built");
+#endif
+    }
+
+    std::uint64_t NumEvents() const { return fHeader.numEvents; }
+
+    // Returns false at the end of the file
+    bool Next(Event &event)
+    {
+        if (fCursor == fEnd && !ReadBlock())
+            return false;
+        Decode(fCursor, fEnd, event);
+        return true;
+    }
+
+private:
+    bool ReadBlock()
+    {
+        BlockHeader header;
+        if (!fIn.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.numEvents == 0)
+            return false;
+
+        fStored.resize(header.storedSize);
+        if (!fIn.read(fStored.data(), header.storedSize))
+            throw std::runtime_error("truncated B8 event block");
+
+        if (fHeader.compression == kNone)
+        {
+            if (header.rawSize != header.storedSize)
+                throw std::runtime_error("corrupt B8 event block");
+            fRaw.swap(fStored);
+        }
+        else
+        {
+#ifdef B8_WITH_ZSTD
+            fRaw.resize(header.rawSize);
+            std::size_t size = ZSTD_decompress(fRaw.data(), fRaw.size(), fStored.data(), fStored.size());
+            if (ZSTD_isError(size) || size != header.rawSize)
+                throw std::runtime_error("corrupt zstd block");
+#endif
+        }
+
+        fCursor = fRaw.data();
+        fEnd = fRaw.data() + header.rawSize;
+        return true;
+    }
+
+    std::ifstream fIn;
+    FileHeader fHeader{};
+    std::vector<char> fStored;
+    std::vector<char> fRaw;
+    const char *fCursor = nullptr;
+    const char *fEnd = nullptr;
+};
+
+}
+
+#endif
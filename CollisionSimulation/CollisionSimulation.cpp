@@ -3,13 +3,93 @@
 #include "Pythia8/Pythia.h"
 #include "Pythia8Plugins/HepMC3.h"
 
+#include "HepMC3/WriterAscii.h"
+
+#include "BinaryEventFormat.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 using namespace Pythia8;
 
-int main() {
-    int nEvents = 1000;
-    Pythia8::Pythia8ToHepMC toHepMC("electron_proton.hepmc");
+struct Options {
+    long nEvents = 1000;
+    long seed = 1;
+    int nThreads = std::max(1u, std::thread::hardware_concurrency());
+    int blockSize = 1000;
+    std::string output = "electron_proton.hepmc";
+    std::string format;     // hepmc, b8ev or b8ev.zst; taken from the output name if empty
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: CollisionSimulation [options]\n"
+              << "  -n <events>   number of events (default 1000)\n"
+              << "  -s <seed>     run seed (default 1)\n"
+              << "  -j <threads>  number of generator threads (default: all cores)\n"
+              << "  -o <file>     output file (default electron_proton.hepmc)\n"
+              << "  -f <format>   hepmc, b8ev or b8ev.zst (default: from the output extension)\n"
+              << "  -b <events>   events per output block (default 1000)\n";
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "-n") options.nEvents = std::stol(value);
+        else if (arg == "-s") options.seed = std::stol(value);
+        else if (arg == "-j") options.nThreads = std::stoi(value);
+        else if (arg == "-o") options.output = value;
+        else if (arg == "-f") options.format = value;
+        else if (arg == "-b") options.blockSize = std::stoi(value);
+        else return false;
+    }
+
+    if (options.format.empty()) {
+        auto ends = [&](const std::string &suffix) {
+            return options.output.size() >= suffix.size()
+                && options.output.compare(options.output.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        options.format = ends(".b8ev.zst") ? "b8ev.zst" : ends(".b8ev") ? "b8ev" : "hepmc";
+    }
+#ifndef B8_WITH_ZSTD
+    // Caught here rather than when the first block is compressed on a worker thread
+    if (options.format == "b8ev.zst") {
+        std::cerr << "b8ev.zst output needs zstd, which this build was not linked with; use -f b8ev\n";
+        return false;
+    }
+#endif
+    return options.nEvents > 0 && options.nThreads > 0 && options.blockSize > 0
+        && (options.format == "hepmc" || options.format == "b8ev" || options.format == "b8ev.zst");
+}
+
+// Seed of every event depends only on the run seed and the event index, so the
+// output is identical whatever the number of threads
+int EventSeed(long seed, long iEvent, int attempt)
+{
+    std::uint64_t x = static_cast<std::uint64_t>(seed) * 0x9E3779B97F4A7C15ull
+                    + static_cast<std::uint64_t>(iEvent) * 0xD1B54A32D192ED03ull
+                    + static_cast<std::uint64_t>(attempt);
+    // splitmix64 finaliser
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    // Pythia accepts seeds up to 900000000
+    return static_cast<int>(x % 900000000) + 1;
+}
 
-    Pythia pythia;
+void Configure(Pythia &pythia)
+{
     pythia.readString("Beams:idA = 2212");      // Proton
     pythia.readString("Beams:idB = 11");        // Electron
     pythia.readString("Beams:frameType = 2");   // Lab frame
@@ -18,21 +98,180 @@ int main() {
     pythia.readString("WeakBosonExchange:ff2ff(t:gmZ) = on");
     pythia.readString("SpaceShower:dipoleRecoil = on");
     pythia.readString("PhaseSpace:Q2min = 100");
-    pythia.init();
+    pythia.readString("Next:numberCount = 0");
+}
+
+// Final state particles grouped by production vertex, in GeV and mm
+void FillBinaryEvent(const Pythia8::Event &pythiaEvent, long iEvent, B8Event::Event &event)
+{
+    event.eventNumber = iEvent;
+    event.vertices.clear();
+    for (int i = 0; i < pythiaEvent.size(); i++) {
+        const auto &particle = pythiaEvent[i];
+        if (!particle.isFinal()) continue;
+
+        B8Event::Vertex *vertex = nullptr;
+        for (auto &existing : event.vertices) {
+            if (existing.x == particle.xProd() && existing.y == particle.yProd()
+                && existing.z == particle.zProd() && existing.t == particle.tProd()) {
+                vertex = &existing;
+                break;
+            }
+        }
+        if (!vertex) {
+            event.vertices.push_back({particle.xProd(), particle.yProd(), particle.zProd(), particle.tProd(), {}});
+            vertex = &event.vertices.back();
+        }
+        vertex->particles.push_back({particle.id(), particle.px(), particle.py(), particle.pz()});
+    }
+}
+
+// Events of one block, generated by one thread and written in block order
+struct GeneratedBlock {
+    B8Event::Block binary;
+    std::vector<std::shared_ptr<HepMC3::GenEvent>> hepmc;
+    long numAbort = 0;
+};
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    bool binary = options.format != "hepmc";
+    auto compression = options.format == "b8ev.zst" ? B8Event::kZstd : B8Event::kNone;
+
+    std::unique_ptr<HepMC3::WriterAscii> hepmcWriter;
+    std::unique_ptr<B8Event::Writer> binaryWriter;
+    if (binary) {
+        binaryWriter = std::make_unique<B8Event::Writer>(options.output, compression);
+    }
+    else {
+        hepmcWriter = std::make_unique<HepMC3::WriterAscii>(options.output);
+    }
+
+    long numBlocks = (options.nEvents + options.blockSize - 1) / options.blockSize;
+    int nThreads = std::min<long>(options.nThreads, numBlocks);
+
+    std::mutex mutex;
+    std::condition_variable blockDone, blockWritten;
+    std::map<long, GeneratedBlock> doneBlocks;
+    long numWritten = 0;
+    std::atomic<long> nextBlock{0};
+    std::atomic<bool> initFailed{false};
+
+    // Each thread owns an initialised Pythia and reseeds it for every event
+    auto generate = [&]() {
+        Pythia pythia("../share/Pythia8/xmldoc", false);
+        Configure(pythia);
+        pythia.readString("Print:quiet = on");
+        if (!pythia.init()) {
+            initFailed = true;
+            blockDone.notify_all();
+            return;
+        }
+        HepMC3::Pythia8ToHepMC3 toHepMC;
+
+        for (long iBlock = nextBlock++; iBlock < numBlocks; iBlock = nextBlock++) {
+            // Do not run too far ahead of the writer, to bound memory
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                blockWritten.wait(lock, [&] { return iBlock < numWritten + 4 * nThreads; });
+            }
+
+            GeneratedBlock block;
+            B8Event::Event event;
+            long first = iBlock * options.blockSize;
+            long last = std::min(first + options.blockSize, options.nEvents);
+            for (long iEvent = first; iEvent < last; iEvent++) {
+                // Retry failed events with a new seed, so the file always has nEvents
+                bool generated = false;
+                for (int attempt = 0; attempt < 10 && !generated; attempt++) {
+                    pythia.rndm.init(EventSeed(options.seed, iEvent, attempt));
+                    generated = pythia.next();
+                    if (!generated) block.numAbort++;
+                }
+
+                if (binary) {
+                    FillBinaryEvent(pythia.event, iEvent, event);
+                    block.binary.Add(event);
+                }
+                else {
+                    auto hepmcEvent = std::make_shared<HepMC3::GenEvent>();
+                    toHepMC.fill_next_event(pythia, hepmcEvent.get(), iEvent);
+                    block.hepmc.push_back(hepmcEvent);
+                }
+            }
+            // Compression is the expensive part of writing, so it happens here in parallel
+            block.binary.Compress(compression);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            doneBlocks.emplace(iBlock, std::move(block));
+            blockDone.notify_all();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
 
-    int numAbort = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back(generate);
+    }
+
+    // Write blocks in order as they become available
+    long numAbort = 0;
+    for (long iBlock = 0; iBlock < numBlocks; iBlock++) {
+        GeneratedBlock block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            blockDone.wait(lock, [&] { return doneBlocks.count(iBlock) > 0 || initFailed; });
+            if (initFailed) break;
+            block = std::move(doneBlocks[iBlock]);
+            doneBlocks.erase(iBlock);
+        }
 
-    for (int iEvent = 0; iEvent < nEvents; ++iEvent) {
-        if (!pythia.next()) {
-            numAbort++;
+        if (binary) {
+            binaryWriter->WriteBlock(block.binary);
         }
-        toHepMC.writeNextEvent(pythia);
+        else {
+            for (const auto &hepmcEvent : block.hepmc) {
+                hepmcWriter->write_event(*hepmcEvent);
+            }
+        }
+        numAbort += block.numAbort;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        numWritten = iBlock + 1;
+        blockWritten.notify_all();
     }
 
-    pythia.stat();
+    if (initFailed) {
+        // Unblock threads still waiting on the writer before joining them
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            numWritten = numBlocks;
+            blockWritten.notify_all();
+        }
+        for (auto &thread : threads) thread.join();
+        std::cerr << "Pythia initialisation failed" << std::endl;
+        return 1;
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (binary) binaryWriter->Close();
+    else hepmcWriter->close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+    std::cout << "Generated " << options.nEvents << " events with " << nThreads << " threads in "
+              << seconds << " s (" << options.nEvents / seconds << " events/s)" << std::endl;
     std::cout << "Number of aborted events: " << numAbort << std::endl;
 
     return 0;
 
-}
\ No newline at end of file
+}
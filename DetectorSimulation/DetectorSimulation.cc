@@ -24,22 +24,153 @@
 // ********************************************************************
 
 #include "ActionInitialization.hh"
+#include "CheckpointManager.hh"
 #include "DetectorConstruction.hh"
-#include "FTFP_BERT.hh"
+#include "PhysicsList.hh"
+#include "ScanDriver.hh"
 
+#include "G4MTRunManager.hh"
 #include "G4RunManagerFactory.hh"
-#include "G4StepLimiterPhysics.hh"
 #include "G4SteppingVerbose.hh"
 #include "G4UIExecutive.hh"
 #include "G4UImanager.hh"
 #include "G4VisExecutive.hh"
+#include "G4ios.hh"
+
+#include <cstdlib>
+#include <utility>
+
+namespace
+{
+
+void PrintUsage()
+{
+    G4cerr << "Usage: DetectorSimulation [options] [macro]\n"
+           << "  -p <physics>  physics list (default FTFP_BERT): a Geant4 reference list, or\n"
+           << "                lean[,em=opt0|opt1|opt3|opt4][,decay=on|off][,hadronic=none|elastic|full]\n"
+           << "  --scan <file> run the configurations of a scan file back to back (see ScanDriver.hh),\n"
+           << "                after the macro, which then only sets up the job\n"
+           << "  --resume      continue /checkpoint/beamOn runs from their last checkpoint\n"
+           << "  --run-manager <type>\n"
+           << "                serial, mt, tasking or tbb (default: Geant4's default, usually tasking)\n"
+           << "  --threads <n> number of worker threads, overriding /run/numberOfThreads\n"
+           << "  --pin-affinity\n"
+           << "                pin each worker thread to a core\n"
+           << "  --shard <i/n> run shard i of n of every /checkpoint/beamOn, or --shard mpi to take\n"
+           << "                i and n from the MPI launcher (mpirun, srun); /run/beamOn is then refused\n"
+           << "Without a macro or scan file an interactive session is started" << G4endl;
+}
+
+G4bool ParseRunManagerType(const G4String &value, G4RunManagerType &type)
+{
+    if (value == "serial") type = G4RunManagerType::SerialOnly;
+    else if (value == "mt") type = G4RunManagerType::MTOnly;
+    else if (value == "tasking") type = G4RunManagerType::TaskingOnly;
+    else if (value == "tbb") type = G4RunManagerType::TBBOnly;
+    else return false;
+    return true;
+}
+
+// "i/n", or "mpi" for the rank and size set by the MPI launcher
+G4bool ParseShard(const G4String &value, G4int &shard, G4int &numShards)
+{
+    if (value == "mpi")
+    {
+        const std::pair<const char *, const char *> launchers[] = {
+            {"OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE"},   // Open MPI
+            {"PMI_RANK", "PMI_SIZE"},                           // MPICH, Intel MPI
+            {"SLURM_PROCID", "SLURM_NTASKS"},                   // srun
+        };
+        for (const auto &[rank, size] : launchers)
+        {
+            if (std::getenv(rank) && std::getenv(size))
+            {
+                shard = std::atoi(std::getenv(rank));
+                numShards = std::atoi(std::getenv(size));
+                return numShards > 0 && shard >= 0 && shard < numShards;
+            }
+        }
+        G4cerr << "--shard mpi: no MPI rank found in the environment" << G4endl;
+        return false;
+    }
+
+    auto slash = value.find('/');
+    if (slash == std::string::npos)
+    {
+        return false;
+    }
+    shard = std::atoi(value.substr(0, slash).c_str());
+    numShards = std::atoi(value.substr(slash + 1).c_str());
+    return numShards > 0 && shard >= 0 && shard < numShards;
+}
+
+}
 
 int main(int argc, char **argv)
 {
-    // Detect interactive mode (if no arguments) and define UI session
+    G4String physicsSpec = "FTFP_BERT";
+    G4String macroFile;
+    G4String scanFile;
+    G4bool resume = false;
+    G4int shard = 0;
+    G4int numShards = 0;
+    auto runManagerType = G4RunManagerType::Default;
+    G4String numThreads;
+    G4bool pinAffinity = false;
+    for (int i = 1; i < argc; i++)
+    {
+        G4String arg = argv[i];
+        if ((arg == "-p" || arg == "--physics") && i + 1 < argc)
+        {
+            physicsSpec = argv[++i];
+        }
+        else if (arg == "--scan" && i + 1 < argc)
+        {
+            scanFile = argv[++i];
+        }
+        else if (arg == "--resume")
+        {
+            resume = true;
+        }
+        else if (arg == "--run-manager" && i + 1 < argc)
+        {
+            if (!ParseRunManagerType(argv[++i], runManagerType))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            numThreads = argv[++i];
+        }
+        else if (arg == "--pin-affinity")
+        {
+            pinAffinity = true;
+        }
+        else if (arg == "--shard" && i + 1 < argc)
+        {
+            if (!ParseShard(argv[++i], shard, numShards))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (arg[0] != '-' && macroFile.empty())
+        {
+            macroFile = arg;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Detect interactive mode (if no macro) and define UI session
     //
     G4UIExecutive *ui = nullptr;
-    if (argc == 1)
+    if (macroFile.empty() && scanFile.empty())
     {
         ui = new G4UIExecutive(argc, argv);
     }
@@ -51,16 +182,40 @@ int main(int argc, char **argv)
     G4int precision = 4;
     G4SteppingVerbose::UseBestUnit(precision);
 
-    // Construct the default run manager
+    // Geant4 lets this override /run/numberOfThreads in the macros
+    if (!numThreads.empty())
+    {
+        setenv("G4FORCENUMBEROFTHREADS", numThreads.c_str(), 1);
+    }
+
+    // Construct the run manager
     //
-    auto runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+    auto runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+    if (pinAffinity)
+    {
+        // Workers are locked to cores round robin, starting from the first
+        if (auto mtRunManager = dynamic_cast<G4MTRunManager *>(runManager))
+        {
+            mtRunManager->SetPinAffinity(1);
+        }
+        else
+        {
+            G4cerr << "--pin-affinity: the serial run manager has no worker threads to pin" << G4endl;
+        }
+    }
 
     // Set mandatory initialization classes
     //
     runManager->SetUserInitialization(new DetectorConstruction());
 
-    auto physicsList = new FTFP_BERT;
-    physicsList->RegisterPhysics(new G4StepLimiterPhysics());
+    auto physicsList = PhysicsList::Create(physicsSpec);
+    if (!physicsList)
+    {
+        PrintUsage();
+        delete runManager;
+        delete ui;
+        return 1;
+    }
     runManager->SetUserInitialization(physicsList);
 
     // Set user action classes
@@ -78,14 +233,36 @@ int main(int argc, char **argv)
     // Get the pointer to the User Interface manager
     auto UImanager = G4UImanager::GetUIpointer();
 
+    // Commands for checkpointed runs, /checkpoint/
+    auto checkpointManager = new CheckpointManager(resume);
+    if (numShards > 0)
+    {
+        checkpointManager->SetShard(shard, numShards);
+    }
+
     // Process macro or start UI session
     //
     if (!ui)
     {
         // batch mode
-        G4String command = "/control/execute ";
-        G4String fileName = argv[1];
-        UImanager->ApplyCommand(command + fileName);
+        if (!macroFile.empty())
+        {
+            G4String command = "/control/execute ";
+            UImanager->ApplyCommand(command + macroFile);
+        }
+
+        if (!scanFile.empty())
+        {
+            ScanDriver scan;
+            if (!scan.Load(scanFile))
+            {
+                delete checkpointManager;
+                delete visManager;
+                delete runManager;
+                return 1;
+            }
+            scan.Run();
+        }
     }
     else
     {
@@ -104,6 +281,7 @@ int main(int argc, char **argv)
     // owned and deleted by the run manager, so they should not be deleted
     // in the main() program !
     //
+    delete checkpointManager;
     delete visManager;
     delete runManager;
 }
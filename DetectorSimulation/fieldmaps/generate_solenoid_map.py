@@ -0,0 +1,101 @@
+import argparse
+import struct
+
+import numpy as np
+
+# Analytic (r, z) field map of a finite solenoid, for testing /det/field/map
+# without the real magnet map. The solenoid is a stack of current loops; the
+# field of each loop is exact (elliptic integrals), so the map has the fringe
+# field the discs see at large |z|.
+#
+# Usage:
+#   python generate_solenoid_map.py [-o solenoid_rz.txt] [--binary]
+#
+# The text output has columns r z Br Bz (mm, tesla) and is converted by the
+# simulation on first use. --binary writes the simulation's binary layout
+# (FieldMapHeader in FieldMap.hh) directly.
+
+
+def elliptic_ke(m):
+    """Complete elliptic integrals K(m) and E(m), m = k^2 < 1, by the AGM."""
+    a = np.ones_like(m)
+    b = np.sqrt(1 - m)
+    c = np.sqrt(m)
+    power = 0.5
+    total = power * c * c
+    for _ in range(30):
+        a, b, c = (a + b) / 2, np.sqrt(a * b), (a - b) / 2
+        power *= 2
+        total += power * c * c
+    k = np.pi / (2 * a)
+    return k, k * (1 - total)
+
+
+def loop_field(radius, z0, r, z):
+    """Br, Bz of a current loop at z0 per unit mu0*I, at points (r, z)."""
+    dz = z - z0
+    alpha2 = radius**2 + r**2 + dz**2 - 2 * radius * r
+    beta2 = radius**2 + r**2 + dz**2 + 2 * radius * r
+    m = np.clip(1 - alpha2 / beta2, 0, 1 - 1e-15)
+    k, e = elliptic_ke(m)
+    beta = np.sqrt(beta2)
+    c = 1 / (2 * np.pi)
+    bz = c / (alpha2 * beta) * ((radius**2 - r**2 - dz**2) * e + alpha2 * k)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        br = np.where(r > 0, c * dz / (alpha2 * beta * r) * ((radius**2 + r**2 + dz**2) * e - alpha2 * k), 0.0)
+    return br, bz
+
+
+def solenoid_field(radius, length, num_loops, r, z):
+    br = np.zeros_like(r)
+    bz = np.zeros_like(r)
+    for z0 in np.linspace(-length / 2, length / 2, num_loops):
+        dbr, dbz = loop_field(radius, z0, r, z)
+        br += dbr
+        bz += dbz
+    return br, bz
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate an analytic solenoid field map")
+    parser.add_argument("-o", "--output", default="solenoid_rz.txt")
+    parser.add_argument("--binary", action="store_true", help="write the binary layout instead of text")
+    parser.add_argument("--field", type=float, default=1.7, help="central field [T]")
+    parser.add_argument("--radius", type=float, default=1600.0, help="coil radius [mm]")
+    parser.add_argument("--length", type=float, default=3840.0, help="coil length [mm]")
+    parser.add_argument("--loops", type=int, default=400, help="number of current loops")
+    parser.add_argument("--rmax", type=float, default=800.0, help="map extent in r [mm]")
+    parser.add_argument("--zmax", type=float, default=1700.0, help="map extent in |z| [mm]")
+    parser.add_argument("--step", type=float, default=10.0, help="grid spacing [mm]")
+    args = parser.parse_args()
+
+    r_nodes = np.arange(0, args.rmax + args.step / 2, args.step)
+    z_nodes = np.arange(-args.zmax, args.zmax + args.step / 2, args.step)
+    r, z = np.meshgrid(r_nodes, z_nodes, indexing="ij")
+
+    br, bz = solenoid_field(args.radius, args.length, args.loops, r, z)
+    _, bz0 = solenoid_field(args.radius, args.length, args.loops, np.zeros(1), np.zeros(1))
+    scale = args.field / bz0[0]
+    br *= scale
+    bz *= scale
+
+    if args.binary:
+        # FieldMapHeader: magic, version, type (0 = rz), n[3], reserved, min[3], step[3], sourceSize, sourceModified
+        header = struct.pack("<8sII3II3d3dQq", b"B8FIELDM", 1, 0, len(r_nodes), len(z_nodes), 1, 0,
+                             r_nodes[0], z_nodes[0], 0.0, args.step, args.step, 1.0, 0, 0)
+        values = np.stack([br, bz], axis=-1).astype("<f8")
+        with open(args.output, "wb") as f:
+            f.write(header)
+            f.write(values.tobytes())
+    else:
+        table = np.column_stack([r.ravel(), z.ravel(), br.ravel(), bz.ravel()])
+        np.savetxt(args.output, table, fmt="%.6g %.6g %.9g %.9g",
+                   header=f"Analytic solenoid: B0 {args.field} T, radius {args.radius} mm, "
+                          f"length {args.length} mm\nr [mm] z [mm] Br [T] Bz [T]")
+
+    print(f"{args.output}: {len(r_nodes)} x {len(z_nodes)} nodes, Bz(0, ±{args.zmax:g} mm) = "
+          f"{bz[0, 0]:.3f} T, Bz(0, 0) = {args.field} T")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+#ifndef BoundedQueue_h
+#define BoundedQueue_h 1
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/// Bounded lock-free multi-producer/multi-consumer queue of pointers
+/// (D. Vyukov's array queue). Each cell carries a sequence number, so a push
+/// or pop only costs one CAS on the shared position and one store to the cell.
+/// Capacity is rounded up to a power of two.
+
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        fMask = size - 1;
+        fCells = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; i++)
+            fCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    std::size_t Capacity() const { return fMask + 1; }
+
+    // Returns false if the queue is full
+    bool TryPush(T *value)
+    {
+        std::size_t pos = fEnqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;)
+        {
+            cell = &fCells[pos & fMask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = fEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns nullptr if the queue is empty
+    T *TryPop()
+    {
+        std::size_t pos = fDequeuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;)
+        {
+            cell = &fCells[pos & fMask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (fDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                pos = fDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T *value = cell->value;
+        cell->sequence.store(pos + fMask + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T *value = nullptr;
+    };
+
+    // keep producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<std::size_t> fEnqueuePos{0};
+    alignas(64) std::atomic<std::size_t> fDequeuePos{0};
+    alignas(64) std::unique_ptr<Cell[]> fCells;
+    std::size_t fMask = 0;
+};
+
+#endif
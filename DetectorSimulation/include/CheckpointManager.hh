@@ -0,0 +1,82 @@
+#ifndef CheckpointManager_h
+#define CheckpointManager_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class CheckpointMessenger;
+
+/// Long batch runs split into checkpointed segments, so a crashed or
+/// preempted job can be resumed (DetectorSimulation --resume).
+///
+/// /checkpoint/beamOn N runs N events as consecutive runs of at most
+/// /checkpoint/interval events. Segment k writes its own output file,
+/// output/<name>.seg<k>.root, which is complete on disk once the segment
+/// ends. After each segment the master random engine status and the number
+/// of completed segments are written to output/<name>.ckpt/, each through a
+/// temporary file and a rename so a crash never leaves a half written
+/// checkpoint.
+///
+/// Every event is seeded from the run seed and its event ID (EventRandom), so
+/// the event IDs are what a segment has to continue; the master engine status
+/// is kept for anything drawn outside of events. On --resume the completed
+/// segments are skipped, the engine is restored, event IDs continue from the
+/// last completed event and a HepMC input skips the events already
+/// transported. The segments are then the same as those of the run completed
+/// without interruption.
+///
+/// When every segment is done they are merged into output/<name> with
+/// ROOT's hadd, if it is on the PATH, and the checkpoint is removed.
+///
+/// With DetectorSimulation --shard i/n the job is one of n processes sharing
+/// /checkpoint/beamOn N: shard i runs event IDs [N*i/n, N*(i+1)/n) into
+/// output/<name>.shard<i>of<n>.root. Since every event is seeded from its
+/// event ID the shards together are the events of the unsharded run. Once
+/// the shard is complete a sidecar, output/<name>.shard<i>of<n>.shard,
+/// records the slice, the run seed and the files holding it, for
+/// Reconstruction's merge_shards. A plain /run/beamOn is not sliced, so a
+/// sharded job stops with an error on one instead of running every event in
+/// each shard.
+
+class CheckpointManager
+{
+public:
+    explicit CheckpointManager(G4bool resume);
+    ~CheckpointManager();
+
+    void SetInterval(G4long interval) { fInterval = interval; }
+    G4long GetInterval() const { return fInterval; }
+
+    // Run only slice shard of numShards of every BeamOn
+    void SetShard(G4int shard, G4int numShards);
+
+    // Run numEvents (or this shard's slice of them) in checkpointed segments,
+    // continuing a checkpoint if resuming
+    void BeamOn(G4long numEvents);
+
+private:
+    struct State {
+        G4long numEvents = 0;
+        G4long interval = 0;
+        G4long completed = 0;       // segments
+    };
+
+    G4bool ReadState(const G4String &directory, State &state) const;
+    void WriteState(const G4String &directory, const State &state) const;
+    // Returns false if the segments were left as they are
+    G4bool Merge(const G4String &outputName, const G4String &stem, G4long numSegments) const;
+    void WriteShardFile(const G4String &stem, G4long numEvents, G4long firstEvent, G4long lastEvent,
+                        G4long runSeed, const std::vector<G4String> &files) const;
+    static G4String SegmentName(const G4String &stem, G4long segment);
+    static G4String EngineName(const G4String &directory, G4long segment);
+    static void Apply(const G4String &command);
+
+    CheckpointMessenger *fMessenger = nullptr;
+    G4bool fResume = false;
+    G4long fInterval = 100000;
+    G4int fShard = 0;
+    G4int fNumShards = 0;       // 0 if not sharded
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CheckpointMessenger_h
+#define CheckpointMessenger_h 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAnInteger;
+
+class CheckpointManager;
+
+/// Messenger class that defines commands for CheckpointManager.
+///
+/// It implements commands:
+/// - /checkpoint/interval events
+/// - /checkpoint/beamOn events
+
+class CheckpointMessenger : public G4UImessenger
+{
+public:
+    CheckpointMessenger(CheckpointManager *);
+    ~CheckpointMessenger() override;
+
+    void SetNewValue(G4UIcommand *, G4String) override;
+
+private:
+    CheckpointManager *fCheckpointManager = nullptr;
+
+    G4UIdirectory *fCheckpointDirectory = nullptr;
+
+    G4UIcmdWithAnInteger *fIntervalCmd = nullptr;
+    G4UIcmdWithAnInteger *fBeamOnCmd = nullptr;
+};
+
+#endif
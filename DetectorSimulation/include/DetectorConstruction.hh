@@ -31,20 +31,38 @@
 #include "G4Threading.hh"
 #include "globals.hh"
 
+#include <memory>
+#include <vector>
+
 class G4VPhysicalVolume;
 class G4LogicalVolume;
 class G4Material;
 class G4UserLimits;
-class G4GlobalMagFieldMessenger;
 
 class DetectorMessenger;
+class FieldSetup;
+class SensorTileParameterisation;
 
 /// Detector construction class to define materials, geometry
 /// and global uniform magnetic field.
+///
+/// Each layer is either a copper support tube with the silicon inside it
+/// (nested, the default), or a single volume of a silicon-copper mixture with
+/// the same radiation length (merged), which halves the boundaries a track
+/// crosses. In merged mode TrackerSD places hits on the silicon surface.
+///
+/// The stave mode tiles the layers with MAPS sensors: flat barrel staves
+/// (a phi replica of sectors, each stave a z replica of sensors) and discs of
+/// parameterised sensor tiles, with gaps between them. Hits then carry a
+/// packed layer/stave/sensor ID (DetectorID.hh). Replicas and parameterised
+/// volumes share one logical volume per layer, so memory stays close to the
+/// tube model.
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
 public:
+    enum LayerMode { kNested, kMerged, kStaves };
+
     DetectorConstruction();
     ~DetectorConstruction() override;
 
@@ -56,14 +74,64 @@ public:
     void SetMaterialWidth1(G4double val) { fMaterialWidth1 = val; }
     void SetMaterialWidth2(G4double val) { fMaterialWidth2 = val; }
     void SetMaterialWidth3(G4double val) { fMaterialWidth3 = val; }
+    G4double GetMaterialWidth1() const { return fMaterialWidth1; }
+    G4double GetMaterialWidth2() const { return fMaterialWidth2; }
+    G4double GetMaterialWidth3() const { return fMaterialWidth3; }
+    void SetSVTCut(G4double val);
+    LayerMode GetLayerMode() const { return fLayerMode; }
+    void SetLayerMode(LayerMode mode) { fLayerMode = mode; }
+
+    // Layer layout, used by the geometry and by the stepping policy
+    G4double GetSiWidth() const { return fSiWidth; }
+    const std::vector<G4double> &GetBarrelRadii() const { return fBarrelRadii; }
+    const std::vector<G4double> &GetBarrelLengths() const { return fBarrelLengths; }
+    const std::vector<G4double> &GetDiscZPositions() const { return fDiscZPositions; }
+    const std::vector<G4double> &GetDiscInnerRadii() const { return fDiscInnerRadii; }
+    const std::vector<G4double> &GetDiscOuterRadii() const { return fDiscOuterRadii; }
+
+    // Cylinder enclosing all layers and supports
+    G4double GetEnvelopeRadius() const;
+    G4double GetEnvelopeHalfLength() const;
 
 private:
-    static G4ThreadLocal G4GlobalMagFieldMessenger* fMagFieldMessenger;
+    // Stave mode layers, returning the layer volume
+    G4LogicalVolume *ConstructBarrelStaves(G4int layer, G4double cuWidth, G4LogicalVolume *worldLV);
+    G4LogicalVolume *ConstructDiscTiles(G4int disc, G4double cuWidth, G4LogicalVolume *worldLV);
+
+    // Silicon-copper mixture of a merged layer with the radiation length of siWidth silicon plus cuWidth copper
+    G4Material *GetMergedMaterial(G4double cuWidth) const;
+
+    static G4ThreadLocal FieldSetup* fFieldSetup;
     std::vector<G4LogicalVolume*> trackerLogicalVolumes;
+
+    G4double fSiWidth = 50 * um;
+    std::vector<G4double> fBarrelRadii = {3.8 * cm, 5.0 * cm, 12.2 * cm, 27.2 * cm, 42.2 * cm};
+    std::vector<G4double> fBarrelLengths = {27.0 * cm, 27.0 * cm, 27.0 * cm, 54.0 * cm, 80.0 * cm};
+    std::vector<G4double> fDiscZPositions = {
+        25.0 * cm, 45.0 * cm, 70.0 * cm, 100.0 * cm, 135.0 * cm,
+        -25.0 * cm, -45.0 * cm, -65.0 * cm, -85.0 * cm, -105.0 * cm};
+    std::vector<G4double> fDiscInnerRadii = {
+        3.676 * cm, 3.676 * cm, 3.842 * cm, 5.443 * cm, 7.014 * cm,
+        3.676 * cm, 3.676 * cm, 3.676 * cm, 4.006 * cm, 4.635 * cm};
+    std::vector<G4double> fDiscOuterRadii = {
+        23.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm,
+        23.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm};
+    // Clearance of the envelope around the outermost layers and their supports
+    G4double fEnvelopeMargin = 1 * cm;
     G4double fDetectorResolution = 7 * um;
     G4double fMaterialWidth1 = 0.0007;
     G4double fMaterialWidth2 = 0.0025;
     G4double fMaterialWidth3 = 0.0055;
+    // Production cut in SVT_Region, the Geant4 default unless changed with /det/svtCut
+    G4double fSVTCut = 0.7 * mm;
+    LayerMode fLayerMode = kNested;
+    // MAPS sensor tiles of the stave mode, and the clearance between neighbouring staves
+    G4double fSensorWidth = 20 * mm;
+    G4double fSensorLength = 30 * mm;
+    G4double fStaveGap = 0.2 * mm;
+    G4int fNumSensors = 0;
+    // Owned here, G4PVParameterised does not delete its parameterisation
+    std::vector<std::unique_ptr<SensorTileParameterisation>> fTileParameterisations;
     DetectorMessenger* fMessenger = nullptr;  
 };
 
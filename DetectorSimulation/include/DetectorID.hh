@@ -0,0 +1,32 @@
+#ifndef DetectorID_h
+#define DetectorID_h 1
+
+#include "globals.hh"
+
+/// Packed sensor ID of a hit: layer in the low 5 bits, then 10 bits of stave
+/// and the sensor within the stave above them.
+///
+/// The layer numbers barrels first, then discs, as the copy numbers of the
+/// layer volumes. In the tube geometries (nested, merged) stave and sensor are
+/// 0, so the ID is the layer number. In the stave geometry a barrel stave is
+/// its phi sector and the sensor its position along z; a disc has one stave
+/// and numbers its sensor tiles row by row.
+
+namespace DetectorID
+{
+constexpr G4int kLayerBits = 5;
+constexpr G4int kStaveBits = 10;
+constexpr G4int kStaveShift = kLayerBits;
+constexpr G4int kSensorShift = kLayerBits + kStaveBits;
+
+inline G4int Pack(G4int layer, G4int stave, G4int sensor)
+{
+    return layer | (stave << kStaveShift) | (sensor << kSensorShift);
+}
+
+inline G4int Layer(G4int id) { return id & ((1 << kLayerBits) - 1); }
+inline G4int Stave(G4int id) { return (id >> kStaveShift) & ((1 << kStaveBits) - 1); }
+inline G4int Sensor(G4int id) { return id >> kSensorShift; }
+}
+
+#endif
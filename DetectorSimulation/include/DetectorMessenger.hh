@@ -31,6 +31,7 @@
 class G4UIdirectory;
 class G4UIcmdWithADouble;
 class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithAString;
 class G4UIcommand;
 
 class DetectorConstruction;
@@ -41,6 +42,8 @@ class DetectorConstruction;
 /// - /B2/det/setTargetMaterial name
 /// - /B2/det/stepMax value unit
 /// - /B2/det/setResolution value unit
+/// - /det/svtCut value unit
+/// - /det/layerMode nested|merged|staves
 
 class DetectorMessenger : public G4UImessenger
 {
@@ -59,6 +62,8 @@ private:
     G4UIcmdWithADouble *fMaterialWidth1Cmd = nullptr;
     G4UIcmdWithADouble *fMaterialWidth2Cmd = nullptr;
     G4UIcmdWithADouble *fMaterialWidth3Cmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fSVTCutCmd = nullptr;
+    G4UIcmdWithAString *fLayerModeCmd = nullptr;
 };
 
 #endif
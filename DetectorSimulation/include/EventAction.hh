@@ -29,6 +29,8 @@
 #include "G4UserEventAction.hh"
 #include "G4ThreeVector.hh"
 
+#include <map>
+
 class G4Event;
 
 /// Event action class
@@ -37,6 +39,7 @@ struct TrackInfo {
     G4ThreeVector momentum;
     G4int pdg;
     G4int eventID;
+    G4int trackID;
 };
 
 class EventAction : public G4UserEventAction
@@ -48,7 +51,8 @@ public:
     void BeginOfEventAction(const G4Event *) override;
     void EndOfEventAction(const G4Event *) override;
 
-    TrackInfo trackInfo;
+    // initial parameters of every primary in the event, keyed by track ID
+    std::map<G4int, TrackInfo> primaries;
 };
 
 #endif
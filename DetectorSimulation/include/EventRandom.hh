@@ -0,0 +1,53 @@
+#ifndef EventRandom_h
+#define EventRandom_h 1
+
+#include "CounterRNG.hh"
+
+#include "Randomize.hh"
+#include "globals.hh"
+
+#include <cstdint>
+
+/// Per event random streams of the simulation, counter-based streams
+/// (Reconstruction/include/CounterRNG.hh) keyed by (run seed, event ID,
+/// purpose).
+///
+/// The numbers of an event depend only on the run seed (/random/runSeed) and
+/// its event ID, never on the thread that simulated it, the number of threads
+/// or how the events were split between processes. SeedEngine() seeds the
+/// thread's Geant4 engine for an event from the same key, so transport is
+/// reproducible in the same way.
+
+namespace EventRandom
+{
+
+// One independent stream per use, so adding draws to one does not shift
+// another. Above any track ID, so they never share a key with the streams of
+// HitSmearing, keyed by (seed, event ID, track ID).
+enum Purpose : std::uint64_t {
+    kGeant4 = 1ull << 32,
+    kGun,
+    kPythia,
+    kEfficiency,
+    kSmearing,
+    kRawHits
+};
+
+inline B8Random::CounterRNG Stream(G4long runSeed, G4long eventID, Purpose purpose)
+{
+    return B8Random::CounterRNG{static_cast<std::uint64_t>(runSeed), static_cast<std::uint64_t>(eventID), purpose};
+}
+
+// Seed the Geant4 engine of this thread for one event
+inline void SeedEngine(G4long runSeed, G4long eventID)
+{
+    auto rng = Stream(runSeed, eventID, kGeant4);
+    // Engines take positive 32 bit seeds, the list ends with 0
+    long seeds[3] = {static_cast<long>(rng.Next() % 2147483646 + 1),
+                     static_cast<long>(rng.Next() % 2147483646 + 1), 0};
+    G4Random::setTheSeeds(seeds);
+}
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef FieldMap_h
+#define FieldMap_h 1
+
+#include "MappedFile.hh"
+
+#include "G4MagneticField.hh"
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// Header of a binary field map. Node values follow as doubles in tesla,
+/// (Br, Bz) per node for an (r, z) map and (Bx, By, Bz) for an (x, y, z)
+/// map, with the last axis varying fastest. Lengths are in mm.
+struct FieldMapHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t type;             // FieldMapData::kRZ or kXYZ
+    std::uint32_t n[3];             // nodes per axis (n[2] = 1 for an (r, z) map)
+    std::uint32_t reserved;
+    double min[3];
+    double step[3];
+    std::uint64_t sourceSize;       // text source of a converted map, to detect a stale cache
+    std::int64_t sourceModified;
+};
+
+/// Field map grid, read-only and shared by all threads.
+///
+/// Binary maps are memory-mapped directly. A text map (columns "r z Br Bz" or
+/// "x y z Bx By Bz", mm and tesla, '#' comments) is converted once into a
+/// binary "<file>.bin" next to it, which is then mapped, so every thread and
+/// every later job uses the same pages.
+
+class FieldMapData
+{
+public:
+    enum Type : std::uint32_t { kRZ = 0, kXYZ = 1 };
+
+    // Shared map for a file, loaded on first use. nullptr if it cannot be read.
+    static std::shared_ptr<const FieldMapData> Load(const std::string &fileName);
+
+    // Convert a text map to the binary layout
+    static bool Convert(const std::string &textFile, const std::string &binaryFile);
+
+    const FieldMapHeader &Header() const { return *fHeader; }
+    const double *Values() const { return fValues; }
+    const std::string &FileName() const { return fFileName; }
+
+private:
+    bool Open(const std::string &fileName);
+
+    MappedFile fFile;
+    const FieldMapHeader *fHeader = nullptr;
+    const double *fValues = nullptr;
+    std::string fFileName;
+};
+
+/// Magnetic field interpolated from a FieldMapData grid: bilinear in (r, z)
+/// with Br turned into (Bx, By), or trilinear in (x, y, z). The field is zero
+/// outside the grid.
+///
+/// Consecutive calls during stepping are nearly always in the same grid cell,
+/// so the corner values of the last cell are cached. Each thread has its own
+/// FieldMap (through FieldSetup), so the cache needs no locking.
+
+class FieldMap : public G4MagneticField
+{
+public:
+    FieldMap(std::shared_ptr<const FieldMapData> data, G4double scale = 1.);
+    ~FieldMap() override = default;
+
+    void GetFieldValue(const G4double point[4], G4double *field) const override;
+
+    const FieldMapData &GetData() const { return *fData; }
+    G4double GetScale() const { return fScale; }
+
+private:
+    // Load the corner values of the cell with the given lower node into the cache
+    void LoadCell(const std::array<std::int64_t, 3> &cell) const;
+
+    std::shared_ptr<const FieldMapData> fData;
+    G4double fScale;
+    G4int fNumAxes;
+    G4int fNumComponents;
+
+    mutable std::array<std::int64_t, 3> fCachedCell = {-1, -1, -1};
+    mutable std::array<std::array<G4double, 3>, 8> fCorners{};
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef FieldMessenger_h
+#define FieldMessenger_h 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADouble;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWith3VectorAndUnit;
+class G4UIcmdWithoutParameter;
+
+class FieldSetup;
+
+/// Messenger class that defines commands for FieldSetup.
+///
+/// It implements commands:
+/// - /det/field/value Bx By Bz unit
+/// - /globalField/setValue Bx By Bz unit (same as /det/field/value, for old macros)
+/// - /det/field/map file
+/// - /det/field/mapScale scale
+/// - /det/field/region world|name
+/// - /det/field/stepper name
+/// - /det/field/minStep value unit
+/// - /det/field/deltaChord value unit
+/// - /det/field/deltaIntersection value unit
+/// - /det/field/deltaOneStep value unit
+/// - /det/field/epsMin value
+/// - /det/field/epsMax value
+/// - /det/field/print
+/// - /det/field/benchmark n
+
+class FieldMessenger : public G4UImessenger
+{
+public:
+    FieldMessenger(FieldSetup *);
+    ~FieldMessenger() override;
+
+    void SetNewValue(G4UIcommand *, G4String) override;
+
+private:
+    FieldSetup *fFieldSetup = nullptr;
+
+    G4UIdirectory *fFieldDirectory = nullptr;
+    G4UIdirectory *fGlobalFieldDirectory = nullptr;
+
+    G4UIcmdWith3VectorAndUnit *fValueCmd = nullptr;
+    G4UIcmdWith3VectorAndUnit *fGlobalValueCmd = nullptr;
+    G4UIcmdWithAString *fMapCmd = nullptr;
+    G4UIcmdWithADouble *fMapScaleCmd = nullptr;
+    G4UIcmdWithAString *fRegionCmd = nullptr;
+    G4UIcmdWithAString *fStepperCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fMinStepCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fDeltaChordCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fDeltaIntersectionCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fDeltaOneStepCmd = nullptr;
+    G4UIcmdWithADouble *fEpsMinCmd = nullptr;
+    G4UIcmdWithADouble *fEpsMaxCmd = nullptr;
+    G4UIcmdWithoutParameter *fPrintCmd = nullptr;
+    G4UIcmdWithAnInteger *fBenchmarkCmd = nullptr;
+};
+
+#endif
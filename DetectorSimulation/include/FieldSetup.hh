@@ -0,0 +1,97 @@
+#ifndef FieldSetup_h
+#define FieldSetup_h 1
+
+#include "G4ThreeVector.hh"
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+#include <map>
+#include <memory>
+
+class FieldMap;
+class G4FieldManager;
+class G4MagIntegratorStepper;
+class G4MagneticField;
+class G4Mag_UsualEqRhs;
+class G4UniformMagField;
+class FieldMessenger;
+
+/// Magnetic field and its propagation settings.
+///
+/// Replaces G4GlobalMagFieldMessenger: the field is the same uniform solenoid
+/// field, but the stepper and the accuracy parameters can be chosen for the
+/// world and separately for any region (e.g. SVT_Region), which then gets its
+/// own G4FieldManager. In a uniform field the exact helix stepper needs no
+/// integration error control at all, so it takes far fewer field calls than
+/// the default Runge-Kutta.
+///
+/// The field is either uniform or interpolated from a field map (FieldMap),
+/// e.g. a solenoid map with its fringe field at the discs. Switching between
+/// them keeps the stepper and accuracy settings of every region.
+///
+/// One instance per thread, created in ConstructSDandField. A region's field
+/// manager is set on the logical volumes of the region, which are per thread,
+/// rather than on the G4Region, which all threads share.
+
+class FieldSetup
+{
+public:
+    FieldSetup(const G4ThreeVector &fieldValue);
+    ~FieldSetup();
+
+    // Uniform field, replacing any field map
+    void SetFieldValue(const G4ThreeVector &value);
+    // Field map from a text or binary file, scaled by mapScale. Returns false if it cannot be read.
+    G4bool LoadFieldMap(const G4String &fileName);
+    void SetMapScale(G4double scale);
+
+    // Time n field evaluations of the uniform field and of the field map
+    void Benchmark(G4int n) const;
+
+    // The following apply to the selected region ("world" for the global field manager)
+    void SelectRegion(const G4String &name);
+    // Give the regions with their own settings their field managers again,
+    // after the geometry has been rebuilt
+    void AttachRegions();
+    void SetStepper(const G4String &name);
+    void SetMinStep(G4double minStep);
+    void SetDeltaChord(G4double deltaChord);
+    void SetDeltaIntersection(G4double deltaIntersection);
+    void SetDeltaOneStep(G4double deltaOneStep);
+    void SetEpsilonMin(G4double epsilonMin);
+    void SetEpsilonMax(G4double epsilonMax);
+
+    void Print() const;
+
+    static constexpr const char *stepperNames =
+        "dormandPrince745 classicalRK4 cashKarpRKF45 bogackiShampine23 exactHelix helixMixed";
+
+private:
+    struct RegionSetup {
+        G4FieldManager *fieldManager = nullptr;
+        G4bool ownsFieldManager = false;
+        G4String stepperName = "dormandPrince745";
+        G4double minStep = 0.01 * mm;
+        G4double deltaChord = 0.25 * mm;
+        std::unique_ptr<G4MagIntegratorStepper> stepper;
+    };
+
+    void UpdateChordFinder(RegionSetup &setup);
+    void AttachToRegion(const G4String &name, G4FieldManager *fieldManager);
+    void UseField(G4MagneticField *field, G4bool enabled);
+
+    // Field in use: fUniformField or fFieldMap
+    G4MagneticField *fField = nullptr;
+    G4UniformMagField *fUniformField = nullptr;
+    std::unique_ptr<FieldMap> fFieldMap;
+    G4double fMapScale = 1.;
+    G4Mag_UsualEqRhs *fEquation = nullptr;
+
+    std::map<G4String, RegionSetup> fRegions;
+    RegionSetup *fSelected = nullptr;
+    G4String fSelectedName = "world";
+
+    FieldMessenger *fMessenger = nullptr;
+};
+
+#endif
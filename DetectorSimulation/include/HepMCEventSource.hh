@@ -0,0 +1,114 @@
+#ifndef HepMCEventSource_h
+#define HepMCEventSource_h 1
+
+#include "BoundedQueue.hh"
+#include "HepMCIndex.hh"
+#include "PrimaryEventRecord.hh"
+
+#include "globals.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace HepMC3
+{
+class GenEvent;
+class ReaderAscii;
+}
+
+namespace B8Event
+{
+class Reader;
+}
+
+/// Which events of the file to read. Anything other than the default needs
+/// the byte-offset index, which lets the reader jump straight to each event.
+struct HepMCSelection {
+    G4long firstEvent = 0;              // position in the file, not event number
+    G4long stride = 1;
+    G4long maxEvents = -1;
+    G4int minFinalState = 0;            // skip events with fewer status 1 particles
+    std::vector<G4long> eventNumbers;   // explicit list, overrides first/stride
+    G4bool useIndex = false;
+
+    G4bool NeedsIndex() const
+    {
+        return useIndex || firstEvent != 0 || stride != 1 || maxEvents >= 0
+            || minFinalState > 0 || !eventNumbers.empty();
+    }
+    bool operator==(const HepMCSelection &) const = default;
+};
+
+/// Process-wide source of generator events read from a HepMC3 ASCII file.
+///
+/// A single background thread parses the file ahead of the worker threads and
+/// converts each event to a PrimaryEventRecord, which is handed over through a
+/// bounded lock-free queue. Every worker pops the next distinct event, so each
+/// generator event is transported exactly once whatever the number of threads,
+/// and ASCII parsing overlaps with transport. A worker that finds the queue
+/// empty sleeps on a condition variable until the reader pushes an event.
+///
+/// With a non-trivial HepMCSelection the reader uses the sidecar HepMCIndex
+/// and parses only the selected events, e.g. every Nth event starting at K to
+/// split one generator file over N simulation processes.
+///
+/// Files in the compact binary format of CollisionSimulation (.b8ev, .b8ev.zst)
+/// are read the same way; they need no index since decoding is cheap.
+
+class HepMCEventSource
+{
+public:
+    static HepMCEventSource &Instance();
+
+    HepMCEventSource(const HepMCEventSource &) = delete;
+    HepMCEventSource &operator=(const HepMCEventSource &) = delete;
+
+    // Start reading fileName if it is not already open with this selection. Safe
+    // to call from every worker, once per run; only the first call for a given
+    // file does any work, but every call takes the source's mutex.
+    void Open(const G4String &fileName, std::size_t prefetch, const HepMCSelection &selection = {});
+
+    // Next unread event, or nullptr once the file is exhausted
+    std::unique_ptr<PrimaryEventRecord> Next();
+
+    void Close();
+
+    // Discard the first numEvents of the next file opened, the events already
+    // transported before a checkpointed run was resumed (see CheckpointManager).
+    // A HepMC3 ASCII file is indexed for this so the skipped events are not parsed
+    void SetSkip(G4long numEvents) { fSkip = numEvents; }
+
+    G4long GetEventsRead() const { return fEventsRead.load(std::memory_order_relaxed); }
+
+private:
+    HepMCEventSource() = default;
+    ~HepMCEventSource();
+
+    void StopReader();
+    void ReadLoop(std::shared_ptr<HepMC3::ReaderAscii> reader);
+    void ReadIndexedLoop(std::shared_ptr<HepMCIndex> index, HepMCSelection selection, G4long skip);
+    void ReadBinaryLoop(std::shared_ptr<B8Event::Reader> reader, HepMCSelection selection);
+    static PrimaryEventRecord *Convert(HepMC3::GenEvent &hepmcEvent);
+    void Push(PrimaryEventRecord *record);
+    // Mark the end of the reader's events and wake every waiting worker
+    void Finish();
+
+    std::mutex fMutex;
+    G4String fFileName;
+    HepMCSelection fSelection;
+    std::unique_ptr<BoundedQueue<PrimaryEventRecord>> fQueue;
+    std::thread fReaderThread;
+    std::atomic<bool> fFinished{false};
+    std::atomic<bool> fStop{false};
+    std::atomic<G4long> fEventsRead{0};
+    // Workers wait here for fEventsRead to change or fFinished
+    std::mutex fWaitMutex;
+    std::condition_variable fEventPushed;
+    G4long fSkip = 0;
+};
+
+#endif
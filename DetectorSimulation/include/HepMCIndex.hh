@@ -0,0 +1,63 @@
+#ifndef HepMCIndex_h
+#define HepMCIndex_h 1
+
+#include "MappedFile.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/// Per-event entry of a HepMCIndex. Fixed size so the sidecar file can be
+/// memory-mapped and used in place.
+struct HepMCIndexEntry {
+    std::uint64_t offset;          // byte offset of the "E" line
+    std::int64_t eventNumber;
+    std::uint32_t numVertices;
+    std::uint32_t numParticles;
+    std::uint32_t numFinalState;   // particles with status 1
+    std::uint32_t reserved;
+};
+
+/// Byte-offset index of a HepMC3 ASCII file.
+///
+/// The index lives next to the event file as "<file>.idx". It is built with a
+/// single line scan the first time it is needed (or when the event file has
+/// changed since) and memory-mapped afterwards, so any event can be located
+/// without parsing the ones before it.
+
+class HepMCIndex
+{
+public:
+    HepMCIndex() = default;
+
+    // Map the index of hepmcFile, building it first if missing or stale
+    bool Open(const std::string &hepmcFile);
+
+    // Scan hepmcFile and write its index to indexFile
+    static bool Build(const std::string &hepmcFile, const std::string &indexFile);
+    static std::string IndexFileName(const std::string &hepmcFile) { return hepmcFile + ".idx"; }
+
+    std::size_t Size() const { return fNumEvents; }
+    const HepMCIndexEntry &operator[](std::size_t i) const { return fEntries[i]; }
+
+    // Position of an event number in the file, or -1 if it is not there
+    std::int64_t Find(std::int64_t eventNumber) const;
+
+    // Raw ASCII text of event i inside the mapped event file
+    std::string_view EventText(std::size_t i) const;
+    // Text before the first event: version line, tools, weight names and run attributes
+    std::string_view HeaderText() const;
+
+private:
+    MappedFile fIndexFile;
+    MappedFile fEventFile;
+    const HepMCIndexEntry *fEntries = nullptr;
+    std::size_t fNumEvents = 0;
+    std::uint64_t fEndOffset = 0;
+    bool fSorted = true;
+    mutable std::unordered_map<std::int64_t, std::int64_t> fLookup;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef HepMCIndexedReader_h
+#define HepMCIndexedReader_h 1
+
+#include "HepMCIndex.hh"
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string_view>
+
+namespace HepMC3
+{
+class GenEvent;
+class GenRunInfo;
+class ReaderAscii;
+}
+
+/// Reads the events of a HepMC3 ASCII file at positions of its HepMCIndex.
+///
+/// One ReaderAscii parses the whole file, its stream pointed in place into
+/// the mapped file: first at the header, so the GenRunInfo (tools, weight
+/// names, run attributes) is read once as in a sequential read, then at each
+/// requested event. Events therefore carry the same run info whichever way
+/// they were read.
+
+class HepMCIndexedReader
+{
+public:
+    // The index must outlive the reader
+    explicit HepMCIndexedReader(const HepMCIndex &index);
+    ~HepMCIndexedReader();
+
+    HepMCIndexedReader(const HepMCIndexedReader &) = delete;
+    HepMCIndexedReader &operator=(const HepMCIndexedReader &) = delete;
+
+    // Parse event position of the index into event
+    bool Read(std::size_t position, HepMC3::GenEvent &event);
+
+    std::shared_ptr<HepMC3::GenRunInfo> GetRunInfo() const;
+
+private:
+    // Get area over text of the mapped file, which ReaderAscii never writes
+    class TextBuffer : public std::streambuf
+    {
+    public:
+        void Point(std::string_view text)
+        {
+            char *begin = const_cast<char *>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+
+    void Point(std::string_view text);
+
+    const HepMCIndex &fIndex;
+    TextBuffer fBuffer;
+    std::istream fStream;
+    std::unique_ptr<HepMC3::ReaderAscii> fReader;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MappedFile_h
+#define MappedFile_h 1
+
+#include <cstddef>
+#include <string>
+
+/// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &fileName);
+    void Close();
+
+    const char *Data() const { return fData; }
+    std::size_t Size() const { return fSize; }
+
+private:
+    const char *fData = nullptr;
+    std::size_t fSize = 0;
+};
+
+#endif
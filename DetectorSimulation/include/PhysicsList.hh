@@ -0,0 +1,31 @@
+#ifndef PhysicsList_h
+#define PhysicsList_h 1
+
+#include "G4VModularPhysicsList.hh"
+#include "globals.hh"
+
+/// Lean modular physics list for tracking studies.
+///
+/// The resolution studies only need multiple scattering, ionisation, decays
+/// and at most the occasional hadronic interaction in the thin layers, so the
+/// full FTFP_BERT hadronic stack and its cross-section tables can be left out.
+/// Built from a spec given with -p on the command line:
+///
+///   lean[,em=opt0|opt1|opt3|opt4][,decay=on|off][,hadronic=none|elastic|full]
+///
+/// The defaults are em=opt0 (the EM physics of FTFP_BERT), decay=on and
+/// hadronic=elastic. hadronic=full adds the FTFP_BERT hadronic constructors.
+/// Any other spec is looked up as a Geant4 reference list, e.g. FTFP_BERT.
+
+class PhysicsList : public G4VModularPhysicsList
+{
+public:
+    PhysicsList(const G4String &emOption, G4bool decay, const G4String &hadronic);
+    ~PhysicsList() override = default;
+
+    // Reference list or lean list from a -p spec, nullptr if the spec is invalid.
+    // G4StepLimiterPhysics is added in both cases.
+    static G4VModularPhysicsList *Create(const G4String &spec);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef PrimaryEventRecord_h
+#define PrimaryEventRecord_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+/// Generator event already converted to Geant4 units, but not yet to
+/// G4PrimaryVertex/G4PrimaryParticle. Those use thread-local allocators,
+/// so they can only be created on the worker that transports the event.
+
+struct PrimaryParticleRecord {
+    G4int pdg = 0;
+    G4ThreeVector momentum;
+};
+
+struct PrimaryVertexRecord {
+    G4ThreeVector position;
+    G4double time = 0;
+    std::vector<PrimaryParticleRecord> particles;
+};
+
+struct PrimaryEventRecord {
+    G4long eventNumber = -1;
+    std::vector<PrimaryVertexRecord> vertices;
+};
+
+#endif
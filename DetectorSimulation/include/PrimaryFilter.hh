@@ -0,0 +1,26 @@
+#ifndef PrimaryFilter_h
+#define PrimaryFilter_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <set>
+
+/// Kinematic prefilter applied while generator particles are turned into
+/// G4PrimaryParticles. Particles that cannot reach the SVT acceptance are
+/// dropped before they cost any transport.
+
+struct PrimaryFilter {
+    enum Decision { kAccepted = 0, kEta, kPt, kNeutral, kPDG, kNumDecisions };
+
+    G4bool enabled = false;
+    G4double etaMin = -3.5;
+    G4double etaMax = 3.5;
+    G4double minPt = 0.;
+    G4bool chargedOnly = false;
+    std::set<G4int> pdgWhitelist;   // empty accepts every PDG code
+
+    Decision Apply(G4int pdg, const G4ThreeVector &momentum) const;
+};
+
+#endif
@@ -26,6 +26,7 @@
 #ifndef B2PrimaryGeneratorAction_h
 #define B2PrimaryGeneratorAction_h 1
 
+#include <memory>
 #include <vector>
 
 #include "G4VUserPrimaryGeneratorAction.hh"
@@ -34,13 +35,15 @@
 #include "G4PrimaryParticle.hh"
 #include "G4SystemOfUnits.hh"
 
-#include "HepMC3/ReaderAscii.h"
-#include "HepMC3/GenEvent.h"
-#include "HepMC3/GenVertex.h"
-#include "HepMC3/GenParticle.h"
+#include "HepMCEventSource.hh"
+#include "PrimaryEventRecord.hh"
+#include "PrimaryFilter.hh"
+#include "PythiaGenerator.hh"
 
 class G4ParticleGun;
 class G4Event;
+class PrimaryGeneratorMessenger;
+class RunAction;
 
 /// The primary generator action class with particle gum.
 ///
@@ -48,19 +51,59 @@ class G4Event;
 /// perpendicular to the input face. The type of the particle
 /// can be changed via the G4 build-in commands of G4ParticleGun class
 /// (see the macros provided with this example).
+/// /generator/gun/multiplicity shoots several independent particles per
+/// event, which spreads the per-event overhead over many tracks.
+///
+/// In hepmc mode the primaries instead come from the process-wide
+/// HepMCEventSource, so every worker transports different generator events.
+/// In pythia mode each worker generates its own e+p collisions in process.
+/// Generator particles pass through a PrimaryFilter on the way to Geant4.
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-    PrimaryGeneratorAction(const std::string &hepmcFile);
-    ~PrimaryGeneratorAction() override = default;
+    PrimaryGeneratorAction(RunAction *runAction, const std::string &hepmcFile);
+    ~PrimaryGeneratorAction() override;
 
     void GeneratePrimaries(G4Event *) override;
 
+    void SetMode(const G4String &mode) { fMode = mode; }
+    void SetGunMultiplicity(G4int multiplicity) { fGunMultiplicity = multiplicity; }
+    void SetGunMomentum(G4double momentum) { fGunMomentum = momentum; }
+    void SetHepMCFileName(const G4String &fileName) { fHepMCFileName = fileName; }
+    void SetPrefetch(G4int prefetch) { fPrefetch = prefetch; }
+    HepMCSelection &GetHepMCSelection() { return fHepMCSelection; }
+    void LoadEventList(const G4String &fileName);
+    void BuildHepMCIndex();
+    PrimaryFilter &GetFilter() { return fFilter; }
+    PythiaSettings &GetPythiaSettings() { return fPythiaSettings; }
+
 private:
-    HepMC3::ReaderAscii hepMCReader;
+    G4long GetRunSeed() const;
+    void GenerateFromGun(G4Event *);
+    void GenerateFromHepMC(G4Event *);
+    void GenerateFromPythia(G4Event *);
+    void AddPrimaries(const PrimaryEventRecord &record, G4Event *);
+
     G4ParticleGun *fParticleGun = nullptr;
     std::vector<G4double> fPossibleMomenta;
+    G4int fGunMultiplicity = 1;
+    G4double fGunMomentum = 0.;     // 0 picks one of fPossibleMomenta for each particle
+
+    G4String fMode = "gun";
+    G4String fHepMCFileName;
+    G4int fPrefetch = 256;
+    HepMCSelection fHepMCSelection;
+    G4int fHepMCRunID = -1;     // run for which this thread last opened the source
+    PrimaryFilter fFilter;
+    PythiaSettings fPythiaSettings;
+#ifdef WITH_PYTHIA8
+    std::unique_ptr<PythiaGenerator> fPythiaGenerator;
+#endif
+
+    RunAction *fRunAction = nullptr;
+
+    PrimaryGeneratorMessenger *fMessenger = nullptr;
 };
 
 #endif
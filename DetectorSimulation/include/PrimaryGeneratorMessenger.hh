@@ -0,0 +1,86 @@
+#ifndef PrimaryGeneratorMessenger_h
+#define PrimaryGeneratorMessenger_h 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithABool;
+class G4UIcmdWithoutParameter;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithADouble;
+class G4UIcommand;
+
+class PrimaryGeneratorAction;
+
+/// Messenger class that defines commands for PrimaryGeneratorAction.
+///
+/// It implements commands:
+/// - /generator/mode gun|hepmc|pythia
+/// - /generator/gun/multiplicity n
+/// - /generator/gun/momentum value unit
+/// - /generator/hepmc/file name
+/// - /generator/hepmc/prefetch n
+/// - /generator/hepmc/firstEvent k
+/// - /generator/hepmc/stride n
+/// - /generator/hepmc/maxEvents n
+/// - /generator/hepmc/minFinalState n
+/// - /generator/hepmc/eventList file
+/// - /generator/hepmc/useIndex bool
+/// - /generator/hepmc/buildIndex
+/// - /generator/filter/enable bool
+/// - /generator/filter/etaRange min max
+/// - /generator/filter/minPt value unit
+/// - /generator/filter/chargedOnly bool
+/// - /generator/filter/addPDG code
+/// - /generator/filter/clearPDG
+/// - /generator/pythia/protonEnergy value unit
+/// - /generator/pythia/electronEnergy value unit
+/// - /generator/pythia/Q2min value
+/// - /generator/pythia/readString setting
+
+class PrimaryGeneratorMessenger : public G4UImessenger
+{
+public:
+    PrimaryGeneratorMessenger(PrimaryGeneratorAction *);
+    ~PrimaryGeneratorMessenger() override;
+
+    void SetNewValue(G4UIcommand *, G4String) override;
+
+private:
+    PrimaryGeneratorAction *fPrimaryGenerator = nullptr;
+
+    G4UIdirectory *fGeneratorDirectory = nullptr;
+    G4UIdirectory *fGunDirectory = nullptr;
+    G4UIdirectory *fHepMCDirectory = nullptr;
+    G4UIdirectory *fFilterDirectory = nullptr;
+    G4UIdirectory *fPythiaDirectory = nullptr;
+
+    G4UIcmdWithAString *fModeCmd = nullptr;
+    G4UIcmdWithAnInteger *fMultiplicityCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fGunMomentumCmd = nullptr;
+    G4UIcmdWithAString *fHepMCFileCmd = nullptr;
+    G4UIcmdWithAnInteger *fPrefetchCmd = nullptr;
+    G4UIcmdWithAnInteger *fFirstEventCmd = nullptr;
+    G4UIcmdWithAnInteger *fStrideCmd = nullptr;
+    G4UIcmdWithAnInteger *fMaxEventsCmd = nullptr;
+    G4UIcmdWithAnInteger *fMinFinalStateCmd = nullptr;
+    G4UIcmdWithAString *fEventListCmd = nullptr;
+    G4UIcmdWithABool *fUseIndexCmd = nullptr;
+    G4UIcmdWithoutParameter *fBuildIndexCmd = nullptr;
+
+    G4UIcmdWithABool *fFilterEnableCmd = nullptr;
+    G4UIcommand *fEtaRangeCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fMinPtCmd = nullptr;
+    G4UIcmdWithABool *fChargedOnlyCmd = nullptr;
+    G4UIcmdWithAnInteger *fAddPDGCmd = nullptr;
+    G4UIcmdWithoutParameter *fClearPDGCmd = nullptr;
+
+    G4UIcmdWithADoubleAndUnit *fProtonEnergyCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fElectronEnergyCmd = nullptr;
+    G4UIcmdWithADouble *fQ2minCmd = nullptr;
+    G4UIcmdWithAString *fReadStringCmd = nullptr;
+};
+
+#endif
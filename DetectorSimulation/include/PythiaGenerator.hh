@@ -0,0 +1,54 @@
+#ifndef PythiaGenerator_h
+#define PythiaGenerator_h 1
+
+#include "PrimaryEventRecord.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Pythia8
+{
+class Pythia;
+}
+
+/// Beam and process settings, the same as CollisionSimulation.cpp by default
+struct PythiaSettings {
+    G4double protonEnergy = 275 * GeV;
+    G4double electronEnergy = 18 * GeV;
+    G4double Q2min = 100;                   // GeV^2
+    std::vector<std::string> extraSettings; // passed on to Pythia::readString
+
+    bool operator==(const PythiaSettings &) const = default;
+};
+
+/// e+p collisions generated in process with Pythia8.
+///
+/// Each Geant4 worker owns one of these (through its PrimaryGeneratorAction),
+/// so generation scales with the number of threads and no intermediate HepMC
+/// file is needed. Pythia is initialised once per thread; its random number
+/// generator is then reseeded at every event from the worker's event seed, so
+/// an event does not depend on which thread generated it.
+
+class PythiaGenerator
+{
+public:
+    PythiaGenerator();
+    ~PythiaGenerator();
+
+    void Initialize(const PythiaSettings &settings);
+    bool IsInitialized(const PythiaSettings &settings) const { return fPythia && settings == fSettings; }
+
+    // Generate one event with the given seed. Returns false if Pythia failed.
+    bool Next(G4long seed, PrimaryEventRecord &record);
+
+private:
+    std::unique_ptr<Pythia8::Pythia> fPythia;
+    PythiaSettings fSettings;
+    G4long fNumGenerated = 0;
+};
+
+#endif
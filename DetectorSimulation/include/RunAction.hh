@@ -26,8 +26,15 @@
 #ifndef B2RunAction_h
 #define B2RunAction_h 1
 
+#include "PrimaryFilter.hh"
+#include "SteppingAction.hh"
+
 #include "G4UserRunAction.hh"
+#include "G4Accumulable.hh"
 #include "G4String.hh"
+#include "G4Timer.hh"
+
+#include <array>
 
 class G4Run;
 class RunActionMessenger;
@@ -51,8 +58,76 @@ public:
     static G4ThreadLocal std::vector<G4double> hitPositionX;
     static G4ThreadLocal std::vector<G4double> hitPositionY;
     static G4ThreadLocal std::vector<G4double> hitPositionZ;
+    static G4ThreadLocal std::vector<G4int> hitLayerID;
+    // Packed layer/stave/sensor ID, see DetectorID.hh
+    static G4ThreadLocal std::vector<G4int> hitDetectorID;
+
+    // Seconds this thread spent adding ntuple rows in the current run
+    static G4ThreadLocal G4double ntupleFillTime;
+
+    // Added to the Geant4 event IDs written out, so the segments of a
+    // checkpointed run (see CheckpointManager) number their events as one run.
+    // Set by the master between runs.
+    static inline G4int eventIDOffset = 0;
+
+    // With --shard only the segments of /checkpoint/beamOn take this shard's
+    // slice of the events; a plain /run/beamOn would run all of them in every
+    // shard, so the master refuses it. Set by the CheckpointManager.
+    static inline G4bool sharded = false;
+    static inline G4bool inCheckpointSegment = false;
+
+    // Store truth hit positions, to be smeared when read (see Reconstruction/HitSmearing)
+    G4bool storeTruthHits = false;
+
+    // Online reconstruction: fit every primary's hits at the end of the event
+    // into the fits ntuple (see TrackerSD::EndOfEvent), keeping the hits of
+    // only rawHitFraction of them in the tracks ntuple
+    enum Fitter { kNoFit, kHelixFit, kKalmanFit };
+    Fitter fitter = kNoFit;
+    G4double rawHitFraction = 0.01;
 
     void SetOutputFileName(const G4String& fileName) { outputFileName = fileName; }
+    void SetStoreTruthHits(G4bool store) { storeTruthHits = store; }
+    void SetFitter(Fitter value) { fitter = value; }
+    void SetRawHitFraction(G4double fraction) { rawHitFraction = fraction; }
+
+    // Key of all random numbers of the run, with the event ID (see EventRandom.hh)
+    G4long runSeed = 1;
+    void SetRunSeed(G4long seed) { runSeed = seed; }
+
+    // Count of generator particles per prefilter decision, merged over threads
+    void CountPrimary(PrimaryFilter::Decision decision) { fPrimaryCounts[decision] += 1; }
+
+    // Count of secondaries tracked or killed by the StackingAction policy
+    void CountSecondary(G4bool tracked) { (tracked ? fSecondariesTracked : fSecondariesKilled) += 1; }
+
+    // Number of primaries and of their steps
+    void CountPrimarySteps(G4int steps) { fPrimaryTracks += 1; fPrimarySteps += steps; }
+
+    // Count of tracks stopped by each SteppingAction rule
+    void CountStopped(SteppingAction::Rule rule) { fStoppedCounts[rule] += 1; }
+
+private:
+    void PrintPrimaryCounts() const;
+    void PrintTransportReport(const G4Run *run);
+    void PrintSteppingReport() const;
+
+    std::array<G4Accumulable<G4long>, PrimaryFilter::kNumDecisions> fPrimaryCounts;
+    G4Accumulable<G4long> fSecondariesTracked;
+    G4Accumulable<G4long> fSecondariesKilled;
+    G4Accumulable<G4long> fPrimaryTracks;
+    G4Accumulable<G4long> fPrimarySteps;
+    std::array<G4Accumulable<G4long>, SteppingAction::kNumRules> fStoppedCounts;
+
+    // Seconds spent filling the ntuple during events and writing it at the
+    // end of the run, summed over the workers
+    G4Accumulable<G4double> fNtupleFillTime;
+    G4Accumulable<G4double> fWorkerWriteTime;
+
+    // Process CPU time of the run, summed over all threads (master only)
+    G4Timer fTimer;
+    // CPU time per event of the last run that tracked every secondary
+    G4double fFullModeCPUPerEvent = 0.;
 };
 
 #endif
@@ -28,6 +28,9 @@
 
 class RunAction;
 class G4UIcmdWithAString;
+class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADouble;
 
 class RunActionMessenger : public G4UImessenger
 {
@@ -40,4 +43,8 @@ public:
 private:
     RunAction* fRunAction;
     G4UIcmdWithAString* fFileCmd;
+    G4UIcmdWithABool* fTruthHitsCmd;
+    G4UIcmdWithAnInteger* fRunSeedCmd;
+    G4UIcmdWithAString* fReconstructCmd;
+    G4UIcmdWithADouble* fRawHitFractionCmd;
 };
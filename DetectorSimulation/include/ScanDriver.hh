@@ -0,0 +1,51 @@
+#ifndef ScanDriver_h
+#define ScanDriver_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+/// Runs a list of detector configurations back to back in one process
+/// (DetectorSimulation --scan <file>).
+///
+/// The scan file is a table: a header line naming the columns, then one
+/// configuration per line, '#' starting a comment. Columns are
+///   name            output file name without .root (required)
+///   events          events to simulate (required)
+///   materialWidth1  /det/materialWidth1, and likewise materialWidth2, materialWidth3
+///   resolution      /det/res, in um
+///   field           /globalField/setValue 0 0 <field> tesla
+///   particle        /gun/particle
+/// Columns left out keep the value set by the setup macro.
+///
+/// The kernel and physics tables are initialised once. Between
+/// configurations only what changed is applied, and the geometry is rebuilt
+/// with /run/reinitializeGeometry only when a material width changed.
+
+class ScanDriver
+{
+public:
+    // Read the scan file. Returns false if it cannot be read or is malformed.
+    G4bool Load(const G4String &fileName);
+
+    // Run every configuration, initialising the run manager first if needed
+    void Run();
+
+private:
+    struct Column {
+        G4String name;
+        G4String command;   // UI command, {} replaced by the value
+        G4bool geometry;    // a change needs the geometry to be rebuilt
+    };
+
+    static const std::vector<Column> &KnownColumns();
+
+    void Apply(const G4String &command) const;
+
+    std::vector<const Column *> fColumns;
+    G4int fNameColumn = -1;
+    G4int fEventsColumn = -1;
+    std::vector<std::vector<G4String>> fRows;
+};
+
+#endif
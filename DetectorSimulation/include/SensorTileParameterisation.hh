@@ -0,0 +1,34 @@
+#ifndef SensorTileParameterisation_h
+#define SensorTileParameterisation_h 1
+
+#include "G4ThreeVector.hh"
+#include "G4VPVParameterisation.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4VPhysicalVolume;
+
+/// Rectangular sensor tiles covering a disc, for a G4PVParameterised.
+///
+/// Tiles lie on a regular grid centred on the beam axis and are kept only
+/// where they fit entirely within the annulus, so the disc has acceptance
+/// gaps at its inner and outer edge as a real tiled disc would. All tiles
+/// share one logical volume; only their positions are stored.
+
+class SensorTileParameterisation : public G4VPVParameterisation
+{
+public:
+    SensorTileParameterisation(G4double innerRadius, G4double outerRadius,
+                               G4double tileWidth, G4double tileLength);
+    ~SensorTileParameterisation() override = default;
+
+    void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume *physVol) const override;
+
+    G4int GetNumTiles() const { return fPositions.size(); }
+
+private:
+    std::vector<G4ThreeVector> fPositions;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+class RunAction;
+class StackingActionMessenger;
+
+/// Secondary transport policy.
+///
+/// TrackerSD only records hits of primaries, so secondaries (delta rays,
+/// conversions, hadronic fragments from the supports and beam pipe) cost CPU
+/// time without contributing to the tracks ntuple. Secondaries are still
+/// produced, so the energy lost by the primary is unchanged; the policy only
+/// decides whether they are tracked afterwards:
+/// - full      : track all secondaries (default, as before)
+/// - kill      : primary-only transport, kill every secondary
+/// - threshold : only track secondaries above a kinetic energy threshold
+
+class StackingAction : public G4UserStackingAction
+{
+public:
+    enum Policy { kFull, kKill, kThreshold };
+
+    StackingAction(RunAction *runAction);
+    ~StackingAction() override;
+
+    G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track *track) override;
+
+    void SetPolicy(Policy policy) { fPolicy = policy; }
+    void SetThreshold(G4double threshold) { fThreshold = threshold; }
+
+private:
+    Policy fPolicy = kFull;
+    G4double fThreshold = 1 * MeV;
+
+    RunAction *fRunAction = nullptr;
+
+    StackingActionMessenger *fMessenger = nullptr;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef StackingActionMessenger_h
+#define StackingActionMessenger_h 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+
+class StackingAction;
+
+/// Messenger class that defines commands for StackingAction.
+///
+/// It implements commands:
+/// - /transport/secondaries full|kill|threshold
+/// - /transport/secondaryThreshold value unit
+
+class StackingActionMessenger : public G4UImessenger
+{
+public:
+    StackingActionMessenger(StackingAction *);
+    ~StackingActionMessenger() override;
+
+    void SetNewValue(G4UIcommand *, G4String) override;
+
+private:
+    StackingAction *fStackingAction = nullptr;
+
+    G4UIdirectory *fTransportDirectory = nullptr;
+
+    G4UIcmdWithAString *fPolicyCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fThresholdCmd = nullptr;
+};
+
+#endif
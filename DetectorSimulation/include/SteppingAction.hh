@@ -1,9 +1,63 @@
+#pragma once
 #include "G4UserSteppingAction.hh"
+#include "G4SystemOfUnits.hh"
 #include "globals.hh"
 
+#include <array>
+
+class RunAction;
+class SteppingActionMessenger;
+
+/// Track termination policy.
+///
+/// Rules, each counted per run and histogrammed (pT of the primaries it
+/// stopped) so their effect on the fitted tracks can be checked:
+/// - maxSteps  : kill after n steps (10000 by default, the only rule on by default)
+/// - envelope  : kill once outside the cylinder enclosing the SVT
+/// - halfTurns : kill charged tracks after n half-turns in the transverse plane
+/// - inward    : kill charged tracks once they curl back towards the beam axis
+/// - watchdog  : kill every remaining track of an event that used more than
+///               a given thread CPU time
+
 class SteppingAction : public G4UserSteppingAction {
 public:
-    SteppingAction() = default;
-    virtual ~SteppingAction() = default;
+    enum Rule { kMaxSteps, kEnvelope, kHalfTurns, kInward, kWatchdog, kNumRules };
+    static const std::array<const char *, kNumRules> ruleNames;
+
+    SteppingAction(RunAction *runAction);
+    virtual ~SteppingAction();
     virtual void UserSteppingAction(const G4Step* step) override;
+
+    void SetMaxSteps(G4int maxSteps) { fMaxSteps = maxSteps; }
+    void SetEnvelope(G4bool enable) { fEnvelope = enable; }
+    void SetMaxHalfTurns(G4int maxHalfTurns) { fMaxHalfTurns = maxHalfTurns; }
+    void SetKillInward(G4bool enable) { fKillInward = enable; }
+    void SetEventTimeLimit(G4double limit) { fEventTimeLimit = limit; }
+
+private:
+    void StartTrack(const G4Step *step);
+    void Kill(const G4Step *step, Rule rule);
+    static G4double ThreadCPUTime();
+
+    // Rule settings, 0 or false disables a rule
+    G4int fMaxSteps = 10000;
+    G4bool fEnvelope = false;
+    G4int fMaxHalfTurns = 0;
+    G4bool fKillInward = false;
+    G4double fEventTimeLimit = 0.;
+
+    // State of the current track
+    G4double fTurnAngle = 0.;
+    G4double fLastPhi = 0.;
+    G4double fStartRadius = 0.;
+    G4double fMaxRadius = 0.;
+
+    // State of the current event, for the watchdog
+    G4int fEventID = -1;
+    G4double fEventStartTime = 0.;
+    G4bool fEventTimedOut = false;
+
+    RunAction *fRunAction = nullptr;
+
+    SteppingActionMessenger *fMessenger = nullptr;
 };
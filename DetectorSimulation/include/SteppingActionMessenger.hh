@@ -0,0 +1,42 @@
+#ifndef SteppingActionMessenger_h
+#define SteppingActionMessenger_h 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithABool;
+class G4UIcmdWithADoubleAndUnit;
+
+class SteppingAction;
+
+/// Messenger class that defines commands for SteppingAction.
+///
+/// It implements commands:
+/// - /stepping/maxSteps n
+/// - /stepping/envelope bool
+/// - /stepping/maxHalfTurns n
+/// - /stepping/killInward bool
+/// - /stepping/eventTimeLimit value unit
+
+class SteppingActionMessenger : public G4UImessenger
+{
+public:
+    SteppingActionMessenger(SteppingAction *);
+    ~SteppingActionMessenger() override;
+
+    void SetNewValue(G4UIcommand *, G4String) override;
+
+private:
+    SteppingAction *fSteppingAction = nullptr;
+
+    G4UIdirectory *fSteppingDirectory = nullptr;
+
+    G4UIcmdWithAnInteger *fMaxStepsCmd = nullptr;
+    G4UIcmdWithABool *fEnvelopeCmd = nullptr;
+    G4UIcmdWithAnInteger *fMaxHalfTurnsCmd = nullptr;
+    G4UIcmdWithABool *fKillInwardCmd = nullptr;
+    G4UIcmdWithADoubleAndUnit *fEventTimeLimitCmd = nullptr;
+};
+
+#endif
@@ -26,12 +26,17 @@
 #ifndef B2TrackerSD_h
 #define B2TrackerSD_h 1
 
+#include "EventAction.hh"
+#include "EventRandom.hh"
 #include "TrackerHit.hh"
 
 #include "G4VSensitiveDetector.hh"
 
+#include <cstdint>
 #include <vector>
 
+class RunAction;
+
 class G4Step;
 class G4HCofThisEvent;
 
@@ -40,6 +45,16 @@ class G4HCofThisEvent;
 /// The hits are accounted in hits in ProcessHits() function which is called
 /// by Geant4 kernel at each step. A hit is created with each step with non zero
 /// energy deposit.
+///
+/// With merged layers (DetectorConstruction::kMerged) the sensitive volume also
+/// holds the support material, so a hit is made only by the step crossing the
+/// silicon exit surface, at the interpolated crossing point. That is where
+/// the last silicon step ends in the nested geometry.
+///
+/// With /output/reconstruct the hits of each primary are also fitted at the
+/// end of the event, with HelixFit or KalmanFit of Reconstruction, into the
+/// fits ntuple, and only /output/rawHitFraction of the primaries keep their
+/// hits in the tracks ntuple.
 
 class TrackerSD : public G4VSensitiveDetector
 {
@@ -52,10 +67,36 @@ public:
     G4bool ProcessHits(G4Step *step, G4TouchableHistory *history) override;
     void EndOfEvent(G4HCofThisEvent *hitCollection) override;
 
+    // Nominal layer positions for merged layers. Detector IDs number the
+    // barrels first, then the discs.
+    void SetMergedLayers(const std::vector<G4double> &barrelRadii, const std::vector<G4double> &discZPositions,
+                         G4double siWidth);
+
+    void SetStaveIDs(G4bool staveIDs) { fStaveIDs = staveIDs; }
+
 private:
+    // Crossing of the silicon exit surface of a merged layer in this step, as a
+    // fraction of the step. Returns false if the step does not cross it.
+    G4bool FindMergedCrossing(const G4Step *step, G4int detectorID, G4double &fraction,
+                              G4double &siliconFraction) const;
+
+    std::vector<G4double> fMergedSurfaces;
+    G4int fNumBarrels = 0;
+    G4double fSiWidth = 0.;
+    G4bool fStaveIDs = false;
+
     TrackerHitsCollection *fHitsCollection = nullptr;
     G4int fEventID = -1;
+    // Per event streams, so efficiency and smearing do not depend on the thread
+    B8Random::CounterRNG fEfficiencyRNG{0};
+    B8Random::CounterRNG fSmearingRNG{0};
+    B8Random::CounterRNG fRawHitRNG{0};
     G4ThreeVector GetSmearedPosition(const TrackerHit &hit);
+
+    // Fit the hits of one primary into the fits ntuple (/output/reconstruct)
+    void FillFit(const RunAction &runAction, const TrackInfo &info);
+    std::vector<G4double> fFitX, fFitY, fFitZ;
+    std::vector<std::int32_t> fFitLayerIDs;
 };
 
 #endif
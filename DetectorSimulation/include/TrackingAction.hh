@@ -28,10 +28,16 @@
 
 #include "G4UserTrackingAction.hh"
 
+class RunAction;
+
 class TrackingAction : public G4UserTrackingAction {
 public:
-  TrackingAction() = default;
+  TrackingAction(RunAction* runAction) : fRunAction(runAction) {}
   virtual ~TrackingAction() = default;
 
   void PreUserTrackingAction(const G4Track* track) override;
+  void PostUserTrackingAction(const G4Track* track) override;
+
+private:
+  RunAction* fRunAction = nullptr;
 };
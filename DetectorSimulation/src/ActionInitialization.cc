@@ -34,6 +34,7 @@
 #include "RunAction.hh"
 #include "TrackingAction.hh"
 #include "SteppingAction.hh"
+#include "StackingAction.hh"
 
 void ActionInitialization::BuildForMaster() const
 {
@@ -42,11 +43,14 @@ void ActionInitialization::BuildForMaster() const
 
 void ActionInitialization::Build() const
 {
+    // Default input for /generator/mode hepmc, can be changed with /generator/hepmc/file
     std::string hepmcFileName = "../CollisionSimulation/electron_proton.hepmc";
 
-    SetUserAction(new PrimaryGeneratorAction(hepmcFileName));
-    SetUserAction(new RunAction);
+    auto runAction = new RunAction;
+    SetUserAction(runAction);
+    SetUserAction(new PrimaryGeneratorAction(runAction, hepmcFileName));
     SetUserAction(new EventAction);
-    SetUserAction(new TrackingAction);
-    SetUserAction(new SteppingAction);
+    SetUserAction(new TrackingAction(runAction));
+    SetUserAction(new SteppingAction(runAction));
+    SetUserAction(new StackingAction(runAction));
 }
@@ -0,0 +1,257 @@
+#include "CheckpointManager.hh"
+
+#include "CheckpointMessenger.hh"
+#include "HepMCEventSource.hh"
+#include "RunAction.hh"
+
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+CheckpointManager::CheckpointManager(G4bool resume)
+    : fResume(resume)
+{
+    fMessenger = new CheckpointMessenger(this);
+}
+
+CheckpointManager::~CheckpointManager()
+{
+    delete fMessenger;
+}
+
+void CheckpointManager::BeamOn(G4long numEvents)
+{
+    auto runAction = static_cast<const RunAction *>(G4RunManager::GetRunManager()->GetUserRunAction());
+    G4String macroOutputName = runAction->outputFileName;
+    G4String stem = macroOutputName;
+    if (stem.size() > 5 && stem.substr(stem.size() - 5) == ".root")
+    {
+        stem = stem.substr(0, stem.size() - 5);
+    }
+
+    // A shard runs its slice of the event IDs of the whole run into its own file
+    G4long firstEvent = 0;
+    G4long lastEvent = numEvents;
+    if (fNumShards > 0)
+    {
+        firstEvent = numEvents * fShard / fNumShards;
+        lastEvent = numEvents * (fShard + 1) / fNumShards;
+        stem += ".shard" + std::to_string(fShard) + "of" + std::to_string(fNumShards);
+        G4cout << "CheckpointManager: shard " << fShard << " of " << fNumShards << " runs events "
+               << firstEvent << " to " << lastEvent - 1 << G4endl;
+    }
+    G4String outputName = stem + ".root";
+    G4String directory = "output/" + stem + ".ckpt";
+
+    State state;
+    state.numEvents = numEvents;
+    state.interval = fInterval;
+
+    State saved;
+    if (fResume && ReadState(directory, saved))
+    {
+        // Segments are only the same if they are cut at the same events
+        if (saved.numEvents != numEvents || saved.interval != fInterval)
+        {
+            G4Exception("CheckpointManager::BeamOn",
+                        "CHECKPOINT_MISMATCH",
+                        FatalException,
+                        ("Checkpoint in " + directory + " is for " + std::to_string(saved.numEvents)
+                         + " events in segments of " + std::to_string(saved.interval)).c_str());
+            return;
+        }
+        state.completed = saved.completed;
+        G4Random::restoreEngineStatus(EngineName(directory, state.completed).c_str());
+        G4cout << "CheckpointManager: resuming " << outputName << " after " << state.completed
+               << " segments (" << state.completed * fInterval << " events)" << G4endl;
+    }
+    else
+    {
+        if (fResume)
+        {
+            G4cout << "CheckpointManager: no checkpoint in " << directory << ", starting from the beginning" << G4endl;
+        }
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        WriteState(directory, state);
+    }
+
+    // A HepMC input continues after the events of earlier shards and segments
+    if (firstEvent + state.completed * fInterval > 0)
+    {
+        HepMCEventSource::Instance().SetSkip(firstEvent + state.completed * fInterval);
+    }
+
+    G4long numSegments = (lastEvent - firstEvent + fInterval - 1) / fInterval;
+    for (G4long segment = state.completed; segment < numSegments; segment++)
+    {
+        G4long first = firstEvent + segment * fInterval;
+        G4long events = std::min(fInterval, lastEvent - first);
+        G4cout << G4endl << "Checkpoint segment " << segment + 1 << "/" << numSegments << ": events "
+               << first << " to " << first + events - 1 << G4endl;
+
+        RunAction::eventIDOffset = static_cast<G4int>(first);
+        Apply("/output/setFileName " + SegmentName(stem, segment));
+        RunAction::inCheckpointSegment = true;
+        Apply("/run/beamOn " + std::to_string(events));
+        RunAction::inCheckpointSegment = false;
+
+        // Engine first, then the segment count that points to it
+        G4String engine = EngineName(directory, segment + 1);
+        G4Random::saveEngineStatus((engine + ".tmp").c_str());
+        std::filesystem::rename(engine + ".tmp", engine);
+        state.completed = segment + 1;
+        WriteState(directory, state);
+        std::filesystem::remove(EngineName(directory, segment));
+    }
+
+    RunAction::eventIDOffset = 0;
+    Apply("/output/setFileName " + macroOutputName);
+
+    G4bool merged = Merge(outputName, stem, numSegments);
+    if (fNumShards > 0)
+    {
+        std::vector<G4String> files;
+        if (merged)
+        {
+            files.push_back(outputName);
+        }
+        for (G4long segment = 0; !merged && segment < numSegments; segment++)
+        {
+            files.push_back(SegmentName(stem, segment));
+        }
+        WriteShardFile(stem, numEvents, firstEvent, lastEvent, runAction->runSeed, files);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void CheckpointManager::SetShard(G4int shard, G4int numShards)
+{
+    fShard = shard;
+    fNumShards = numShards;
+    RunAction::sharded = numShards > 0;
+}
+
+void CheckpointManager::WriteShardFile(const G4String &stem, G4long numEvents, G4long firstEvent,
+                                       G4long lastEvent, G4long runSeed,
+                                       const std::vector<G4String> &files) const
+{
+    // Written last, so its presence means the shard is complete
+    G4String fileName = "output/" + stem + ".shard";
+    {
+        std::ofstream out(fileName + ".tmp");
+        out << "shard " << fShard << " " << fNumShards << "\n"
+            << "events " << numEvents << "\n"
+            << "first " << firstEvent << "\n"
+            << "last " << lastEvent << "\n"
+            << "runSeed " << runSeed << "\n";
+        for (const auto &file : files)
+        {
+            out << "file " << file << "\n";
+        }
+    }
+    std::filesystem::rename(fileName + ".tmp", fileName);
+    G4cout << "CheckpointManager: shard " << fShard << " of " << fNumShards << " complete, see " << fileName
+           << G4endl;
+}
+
+G4bool CheckpointManager::ReadState(const G4String &directory, State &state) const
+{
+    std::ifstream in(directory + "/state");
+    std::string key;
+    G4long value;
+    G4int found = 0;
+    while (in >> key >> value)
+    {
+        if (key == "events") { state.numEvents = value; found++; }
+        if (key == "interval") { state.interval = value; found++; }
+        if (key == "completed") { state.completed = value; found++; }
+    }
+    return found == 3 && std::filesystem::exists(EngineName(directory, state.completed));
+}
+
+void CheckpointManager::WriteState(const G4String &directory, const State &state) const
+{
+    // Segment 0 starts from the engine as set up by the macro
+    if (state.completed == 0)
+    {
+        G4String engine = EngineName(directory, 0);
+        G4Random::saveEngineStatus((engine + ".tmp").c_str());
+        std::filesystem::rename(engine + ".tmp", engine);
+    }
+
+    G4String fileName = directory + "/state";
+    {
+        std::ofstream out(fileName + ".tmp");
+        out << "events " << state.numEvents << "\n"
+            << "interval " << state.interval << "\n"
+            << "completed " << state.completed << "\n";
+    }
+    std::filesystem::rename(fileName + ".tmp", fileName);
+}
+
+G4bool CheckpointManager::Merge(const G4String &outputName, const G4String &stem, G4long numSegments) const
+{
+    std::ostringstream command;
+    command << "hadd -f output/" << outputName;
+    for (G4long segment = 0; segment < numSegments; segment++)
+    {
+        command << " output/" << SegmentName(stem, segment);
+    }
+
+    if (std::system("command -v hadd > /dev/null 2>&1") != 0)
+    {
+        G4cout << "CheckpointManager: hadd not found, merge the segments with" << G4endl
+               << "  " << command.str() << G4endl;
+        return false;
+    }
+
+    if (std::system((command.str() + " > /dev/null").c_str()) != 0)
+    {
+        G4Exception("CheckpointManager::Merge",
+                    "CHECKPOINT_MERGE",
+                    JustWarning,
+                    ("Merging the segments failed, they are left in output/: " + command.str()).c_str());
+        return false;
+    }
+
+    for (G4long segment = 0; segment < numSegments; segment++)
+    {
+        std::filesystem::remove("output/" + SegmentName(stem, segment));
+    }
+    G4cout << "CheckpointManager: merged " << numSegments << " segments into output/" << outputName << G4endl;
+    return true;
+}
+
+G4String CheckpointManager::SegmentName(const G4String &stem, G4long segment)
+{
+    std::ostringstream name;
+    name << stem << ".seg" << std::setw(4) << std::setfill('0') << segment << ".root";
+    return name.str();
+}
+
+G4String CheckpointManager::EngineName(const G4String &directory, G4long segment)
+{
+    return directory + "/engine_" + std::to_string(segment) + ".rndm";
+}
+
+void CheckpointManager::Apply(const G4String &command)
+{
+    G4int status = G4UImanager::GetUIpointer()->ApplyCommand(command);
+    if (status != 0)
+    {
+        G4Exception("CheckpointManager::Apply",
+                    "CHECKPOINT_COMMAND",
+                    FatalException,
+                    ("Command failed (status " + std::to_string(status) + "): " + command).c_str());
+    }
+}
@@ -0,0 +1,46 @@
+#include "CheckpointMessenger.hh"
+
+#include "CheckpointManager.hh"
+
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIdirectory.hh"
+
+CheckpointMessenger::CheckpointMessenger(CheckpointManager *checkpointManager)
+    : fCheckpointManager(checkpointManager)
+{
+    fCheckpointDirectory = new G4UIdirectory("/checkpoint/");
+    fCheckpointDirectory->SetGuidance("Checkpointed runs that can be resumed with --resume");
+
+    // Only the master runs these; the workers have no CheckpointManager
+    fIntervalCmd = new G4UIcmdWithAnInteger("/checkpoint/interval", this);
+    fIntervalCmd->SetGuidance("Set the number of events per checkpointed segment");
+    fIntervalCmd->SetParameterName("events", false);
+    fIntervalCmd->SetRange("events > 0");
+    fIntervalCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fIntervalCmd->SetToBeBroadcasted(false);
+
+    fBeamOnCmd = new G4UIcmdWithAnInteger("/checkpoint/beamOn", this);
+    fBeamOnCmd->SetGuidance("Run events in checkpointed segments of /checkpoint/interval events");
+    fBeamOnCmd->SetGuidance("With --resume, continue from the last checkpoint of the same output file");
+    fBeamOnCmd->SetParameterName("events", false);
+    fBeamOnCmd->SetRange("events > 0");
+    fBeamOnCmd->AvailableForStates(G4State_Idle);
+    fBeamOnCmd->SetToBeBroadcasted(false);
+}
+
+CheckpointMessenger::~CheckpointMessenger()
+{
+    delete fIntervalCmd;
+    delete fBeamOnCmd;
+    delete fCheckpointDirectory;
+}
+
+void CheckpointMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+    if (command == fIntervalCmd) {
+        fCheckpointManager->SetInterval(fIntervalCmd->GetNewIntValue(newValue));
+    }
+    if (command == fBeamOnCmd) {
+        fCheckpointManager->BeamOn(fBeamOnCmd->GetNewIntValue(newValue));
+    }
+}
@@ -30,25 +30,39 @@
 #include "DetectorConstruction.hh"
 
 #include "DetectorMessenger.hh"
+#include "FieldSetup.hh"
+#include "SensorTileParameterisation.hh"
 #include "TrackerSD.hh"
 
 #include "G4AutoDelete.hh"
 #include "G4Box.hh"
 #include "G4Colour.hh"
-#include "G4GlobalMagFieldMessenger.hh"
+#include "G4GeometryManager.hh"
 #include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4Material.hh"
 #include "G4NistManager.hh"
+#include "G4PVParameterised.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
 #include "G4SDManager.hh"
+#include "G4SolidStore.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
 #include "G4Tubs.hh"
 #include "G4TransportationManager.hh"
 #include "G4UserLimits.hh"
 #include "G4UniformMagField.hh"
 #include "G4VisAttributes.hh"
 
-G4ThreadLocal G4GlobalMagFieldMessenger *DetectorConstruction::fMagFieldMessenger = nullptr;
+#include <algorithm>
+#include <cmath>
+
+G4ThreadLocal FieldSetup *DetectorConstruction::fFieldSetup = nullptr;
 
 DetectorConstruction::DetectorConstruction()
 {
@@ -62,7 +76,19 @@ DetectorConstruction::~DetectorConstruction()
 
 G4VPhysicalVolume *DetectorConstruction::Construct()
 {
+    G4Timer timer;
+    timer.Start();
+
+    // The geometry is rebuilt after /run/reinitializeGeometry (e.g. by the
+    // scan driver between configurations), so clear the previous one
+    G4GeometryManager::GetInstance()->OpenGeometry();
+    G4PhysicalVolumeStore::GetInstance()->Clean();
+    G4LogicalVolumeStore::GetInstance()->Clean();
+    G4SolidStore::GetInstance()->Clean();
+
     trackerLogicalVolumes.clear();
+    fNumSensors = 0;
+    fTileParameterisations.clear();
 
     G4NistManager *nistManager = G4NistManager::Instance();
 
@@ -101,15 +127,12 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
         new G4PVPlacement(nullptr, {}, worldLV, "World_PV", nullptr, false, 0);
 
     // Dimensions of silicon barrels and discs
-    G4double siWidth = 50 * um;
-    int numBarrels = 5;
-    int numDiscs = 10;
-
-    std::vector<G4double> barrelRadii = {3.8 * cm, 5.0 * cm, 12.2 * cm, 27.2 * cm,
-                                         42.2 * cm};
+    const G4double siWidth = fSiWidth;
+    int numBarrels = fBarrelRadii.size();
+    int numDiscs = fDiscZPositions.size();
 
-    std::vector<G4double> barrelLengths = {27.0 * cm, 27.0 * cm, 27.0 * cm,
-                                           54.0 * cm, 80.0 * cm};
+    const auto &barrelRadii = fBarrelRadii;
+    const auto &barrelLengths = fBarrelLengths;
 
     // Extra support material (copper) to pad the material budget to
     // 0.05 X/X_0%, 0.25 X/X_0% and 0.55 X/X_0%, or whatever they are set as
@@ -126,17 +149,9 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
 
     G4double discCuWidth = cuWidth2;
 
-    std::vector<G4double> discZPositions = {
-        25.0 * cm, 45.0 * cm, 70.0 * cm, 100.0 * cm, 135.0 * cm,
-        -25.0 * cm, -45.0 * cm, -65.0 * cm, -85.0 * cm, -105.0 * cm};
-
-    std::vector<G4double> discInnerRadii = {
-        3.676 * cm, 3.676 * cm, 3.842 * cm, 5.443 * cm, 7.014 * cm,
-        3.676 * cm, 3.676 * cm, 3.676 * cm, 4.006 * cm, 4.635 * cm};
-
-    std::vector<G4double> discOuterRadii = {
-        23.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm,
-        23.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm, 43.0 * cm};
+    const auto &discZPositions = fDiscZPositions;
+    const auto &discInnerRadii = fDiscInnerRadii;
+    const auto &discOuterRadii = fDiscOuterRadii;
 
     // Beryllium beampipe with vacuum inside
     G4double beamPipeRadius = 3.1 * cm;
@@ -157,9 +172,41 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
     new G4PVPlacement(nullptr, G4ThreeVector(0, 0, 0), vacuumLV, "Vacuum_PV",
                       beamPipeLV, false, 0, true);
 
+    // SVT layers and their supports form one region with its own production cuts,
+    // so delta rays and conversions can be suppressed there without touching the
+    // beam pipe. Found rather than created so the geometry can be rebuilt.
+    auto svtRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("SVT_Region");
+    if (!svtRegion->GetProductionCuts()) {
+        svtRegion->SetProductionCuts(new G4ProductionCuts);
+    }
+    svtRegion->GetProductionCuts()->SetProductionCut(fSVTCut);
+
     // Barrel segments
     for (int i = 0; i < numBarrels; i++)
     {
+        if (fLayerMode == kStaves)
+        {
+            svtRegion->AddRootLogicalVolume(ConstructBarrelStaves(i, barrelCuWidth[i], worldLV));
+            continue;
+        }
+        if (fLayerMode == kMerged)
+        {
+            // One volume with the width of the support, silicon and copper mixed
+            auto name = "SVT_Barrel_" + std::to_string(i);
+            auto barrelShape = new G4Tubs(name,
+                                          barrelRadii[i] - siWidth / 2 - barrelCuWidth[i] / 2,
+                                          barrelRadii[i] + siWidth / 2 + barrelCuWidth[i] / 2,
+                                          barrelLengths[i] / 2, 0. * deg, 360. * deg);
+            auto barrelLV = new G4LogicalVolume(barrelShape, GetMergedMaterial(barrelCuWidth[i]), name + "_LV",
+                                                nullptr, nullptr, nullptr);
+            barrelLV->SetVisAttributes(trackerVisAtt);
+            new G4PVPlacement(nullptr, G4ThreeVector(0, 0, 0), barrelLV, name + "_PV",
+                              worldLV, false, i, true);
+            svtRegion->AddRootLogicalVolume(barrelLV);
+            trackerLogicalVolumes.push_back(barrelLV);
+            continue;
+        }
+
         // Add surrounding support copper material to pad material width
         auto name = "SVT_Barrel_" + std::to_string(i) + "_Support";
         auto supportBarrelShape = new G4Tubs(name,
@@ -171,6 +218,7 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
         supportBarrelLV->SetVisAttributes(trackerVisAtt);
         new G4PVPlacement(nullptr, G4ThreeVector(0, 0, 0), supportBarrelLV, name + "_PV",
                           worldLV, false, i, true);
+        svtRegion->AddRootLogicalVolume(supportBarrelLV);
 
         name = "SVT_Barrel_" + std::to_string(i);
         auto barrelShape = new G4Tubs(name, barrelRadii[i] - siWidth / 2,
@@ -187,6 +235,27 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
     // Disc segments
     for (int i = 0; i < numDiscs; i++)
     {
+        if (fLayerMode == kStaves)
+        {
+            svtRegion->AddRootLogicalVolume(ConstructDiscTiles(i, discCuWidth, worldLV));
+            continue;
+        }
+        if (fLayerMode == kMerged)
+        {
+            auto name = "SVT_Disc_" + std::to_string(i);
+            auto discShape =
+                new G4Tubs(name, discInnerRadii[i], discOuterRadii[i],
+                           siWidth / 2 + discCuWidth / 2, 0. * deg, 360. * deg);
+            auto discLV = new G4LogicalVolume(discShape, GetMergedMaterial(discCuWidth), name + "_LV",
+                                              nullptr, nullptr, nullptr);
+            discLV->SetVisAttributes(trackerVisAtt);
+            new G4PVPlacement(nullptr, G4ThreeVector(0, 0, discZPositions[i]), discLV,
+                              name + "_PV", worldLV, false, numBarrels + i, true);
+            svtRegion->AddRootLogicalVolume(discLV);
+            trackerLogicalVolumes.push_back(discLV);
+            continue;
+        }
+
         // Add surrounding support copper material to pad material width
         auto name = "SVT_Disc_" + std::to_string(i) + "_Support";
         auto supportDiscShape =
@@ -197,6 +266,7 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
         supportDiscLV->SetVisAttributes(trackerVisAtt);
         new G4PVPlacement(nullptr, G4ThreeVector(0, 0, discZPositions[i]), supportDiscLV,
                           name + "_PV", worldLV, false, numBarrels + i, true);
+        svtRegion->AddRootLogicalVolume(supportDiscLV);
 
         name = "SVT_Disc_" + std::to_string(i);
         auto discShape =
@@ -210,25 +280,212 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
         trackerLogicalVolumes.push_back(discLV);
     }
 
+    timer.Stop();
+    const char *modeNames[] = {"nested", "merged", "staves"};
+    G4cout << "Geometry (" << modeNames[fLayerMode] << " layers): "
+           << (fLayerMode == kStaves ? fNumSensors : numBarrels + numDiscs) << " sensors, "
+           << G4LogicalVolumeStore::GetInstance()->size() << " logical and "
+           << G4PhysicalVolumeStore::GetInstance()->size() << " physical volumes, built in "
+           << timer.GetRealElapsed() * 1000 << " ms" << G4endl;
+
     return worldPV;
 }
 
+G4LogicalVolume *DetectorConstruction::ConstructBarrelStaves(G4int layer, G4double cuWidth,
+                                                             G4LogicalVolume *worldLV)
+{
+    G4Material *air = G4Material::GetMaterial("G4_AIR");
+    G4Material *silicon = G4Material::GetMaterial("G4_Si");
+    G4Material *copper = G4Material::GetMaterial("G4_Cu");
+
+    G4VisAttributes staveVisAtt(G4Colour(1.0, 1.0, 0.0, 0.5));
+    staveVisAtt.SetVisibility(true);
+    staveVisAtt.SetForceSolid(true);
+
+    G4double radius = fBarrelRadii[layer];
+    G4double length = fBarrelLengths[layer];
+    G4double thickness = fSiWidth + cuWidth;
+
+    // Enough staves to go round with sensors of fSensorWidth. Each is as wide
+    // as its sector allows at its inner face, less the gap to its neighbours.
+    auto numStaves = static_cast<G4int>(std::ceil(twopi * radius / fSensorWidth));
+    G4double sectorAngle = twopi / numStaves;
+    G4double staveWidth = 2 * (radius - thickness / 2) * std::tan(sectorAngle / 2) - fStaveGap;
+    auto numSensors = static_cast<G4int>(std::max(1L, std::lround(length / fSensorLength)));
+
+    // The flat staves reach beyond the nominal radius at their edges
+    G4double innerRadius = radius - thickness / 2 - 1 * um;
+    G4double outerRadius = std::hypot(radius + thickness / 2, staveWidth / 2) + 1 * um;
+
+    auto name = "SVT_Barrel_" + std::to_string(layer);
+    auto layerShape = new G4Tubs(name, innerRadius, outerRadius, length / 2, 0. * deg, 360. * deg);
+    auto layerLV = new G4LogicalVolume(layerShape, air, name + "_LV");
+    layerLV->SetVisAttributes(G4VisAttributes::GetInvisible());
+    new G4PVPlacement(nullptr, G4ThreeVector(0, 0, 0), layerLV, name + "_PV", worldLV, false, layer, true);
+
+    auto sectorShape = new G4Tubs(name + "_Sector", innerRadius, outerRadius, length / 2,
+                                  -sectorAngle / 2, sectorAngle);
+    auto sectorLV = new G4LogicalVolume(sectorShape, air, name + "_Sector_LV");
+    sectorLV->SetVisAttributes(G4VisAttributes::GetInvisible());
+    new G4PVReplica(name + "_Sector_PV", sectorLV, layerLV, kPhi, numStaves, sectorAngle);
+
+    // Stave along x in the sector frame: copper support with the silicon in its middle
+    auto supportShape = new G4Box(name + "_Stave_Support", thickness / 2, staveWidth / 2, length / 2);
+    auto supportLV = new G4LogicalVolume(supportShape, copper, name + "_Stave_Support_LV");
+    supportLV->SetVisAttributes(staveVisAtt);
+    new G4PVPlacement(nullptr, G4ThreeVector(radius, 0, 0), supportLV, name + "_Stave_Support_PV",
+                      sectorLV, false, 0, true);
+
+    auto staveShape = new G4Box(name + "_Stave", fSiWidth / 2, staveWidth / 2, length / 2);
+    auto staveLV = new G4LogicalVolume(staveShape, silicon, name + "_Stave_LV");
+    staveLV->SetVisAttributes(staveVisAtt);
+    new G4PVPlacement(nullptr, G4ThreeVector(0, 0, 0), staveLV, name + "_Stave_PV", supportLV, false, 0, true);
+
+    auto sensorShape = new G4Box(name + "_Sensor", fSiWidth / 2, staveWidth / 2, length / numSensors / 2);
+    auto sensorLV = new G4LogicalVolume(sensorShape, silicon, name + "_Sensor_LV");
+    sensorLV->SetVisAttributes(staveVisAtt);
+    new G4PVReplica(name + "_Sensor_PV", sensorLV, staveLV, kZAxis, numSensors, length / numSensors);
+
+    trackerLogicalVolumes.push_back(sensorLV);
+    fNumSensors += numStaves * numSensors;
+    return layerLV;
+}
+
+G4LogicalVolume *DetectorConstruction::ConstructDiscTiles(G4int disc, G4double cuWidth, G4LogicalVolume *worldLV)
+{
+    G4Material *air = G4Material::GetMaterial("G4_AIR");
+    G4Material *silicon = G4Material::GetMaterial("G4_Si");
+    G4Material *copper = G4Material::GetMaterial("G4_Cu");
+
+    G4VisAttributes tileVisAtt(G4Colour(1.0, 1.0, 0.0, 0.5));
+    tileVisAtt.SetVisibility(true);
+    tileVisAtt.SetForceSolid(true);
+
+    G4int layer = fBarrelRadii.size() + disc;
+    G4double innerRadius = fDiscInnerRadii[disc];
+    G4double outerRadius = fDiscOuterRadii[disc];
+    G4double thickness = fSiWidth + cuWidth;
+
+    auto name = "SVT_Disc_" + std::to_string(disc);
+    auto layerShape = new G4Tubs(name, innerRadius, outerRadius, thickness / 2, 0. * deg, 360. * deg);
+    auto layerLV = new G4LogicalVolume(layerShape, air, name + "_LV");
+    layerLV->SetVisAttributes(G4VisAttributes::GetInvisible());
+    new G4PVPlacement(nullptr, G4ThreeVector(0, 0, fDiscZPositions[disc]), layerLV, name + "_PV",
+                      worldLV, false, layer, true);
+
+    // Copper support disc behind the sensor plane
+    auto supportShape = new G4Tubs(name + "_Support", innerRadius, outerRadius, cuWidth / 2, 0. * deg, 360. * deg);
+    auto supportLV = new G4LogicalVolume(supportShape, copper, name + "_Support_LV");
+    supportLV->SetVisAttributes(tileVisAtt);
+    new G4PVPlacement(nullptr, G4ThreeVector(0, 0, fSiWidth / 2), supportLV, name + "_Support_PV",
+                      layerLV, false, 0, true);
+
+    // A parameterised volume must be the only daughter of its mother, so the
+    // tiles sit in their own plane
+    auto planeShape = new G4Tubs(name + "_Plane", innerRadius, outerRadius, fSiWidth / 2, 0. * deg, 360. * deg);
+    auto planeLV = new G4LogicalVolume(planeShape, air, name + "_Plane_LV");
+    planeLV->SetVisAttributes(G4VisAttributes::GetInvisible());
+    new G4PVPlacement(nullptr, G4ThreeVector(0, 0, -cuWidth / 2), planeLV, name + "_Plane_PV",
+                      layerLV, false, 0, true);
+
+    auto tiles = new SensorTileParameterisation(innerRadius, outerRadius, fSensorWidth, fSensorLength);
+    auto tileShape = new G4Box(name + "_Sensor", fSensorWidth / 2, fSensorLength / 2, fSiWidth / 2);
+    auto tileLV = new G4LogicalVolume(tileShape, silicon, name + "_Sensor_LV");
+    tileLV->SetVisAttributes(tileVisAtt);
+    // kUndefined lets the navigator build smart voxels over the tiles
+    new G4PVParameterised(name + "_Sensor_PV", tileLV, planeLV, kUndefined, tiles->GetNumTiles(), tiles);
+    fTileParameterisations.emplace_back(tiles);
+
+    trackerLogicalVolumes.push_back(tileLV);
+    fNumSensors += tiles->GetNumTiles();
+    return layerLV;
+}
+
 void DetectorConstruction::ConstructSDandField()
 {
-    // Set trackers as sensitive detectors
-    auto trackerSD = new TrackerSD("SVT_SD", "HitsCollection");
-    G4SDManager::GetSDMpointer()->AddNewDetector(trackerSD);
+    // Set trackers as sensitive detectors. After a geometry rebuild the
+    // detector exists already and is attached to the new volumes.
+    auto sdManager = G4SDManager::GetSDMpointer();
+    auto trackerSD = static_cast<TrackerSD *>(sdManager->FindSensitiveDetector("SVT_SD", false));
+    if (!trackerSD)
+    {
+        trackerSD = new TrackerSD("SVT_SD", "HitsCollection");
+        sdManager->AddNewDetector(trackerSD);
+    }
 
     for (auto *lv : trackerLogicalVolumes)
     {
         SetSensitiveDetector(lv, trackerSD);
     }
 
-    // Set uniform magnetic field
-    G4ThreeVector fieldValue = G4ThreeVector(0., 0., 1.7 * tesla);
-        fMagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
-    fMagFieldMessenger->SetVerboseLevel(1);
+    // Merged layers are thicker than the silicon, so hits are placed on its surface
+    if (fLayerMode == kMerged)
+    {
+        trackerSD->SetMergedLayers(fBarrelRadii, fDiscZPositions, fSiWidth);
+    }
+    trackerSD->SetStaveIDs(fLayerMode == kStaves);
+
+    // Set uniform magnetic field, see /det/field/ for the propagation settings.
+    // It is kept with its settings when the geometry is rebuilt.
+    if (!fFieldSetup)
+    {
+        G4ThreeVector fieldValue = G4ThreeVector(0., 0., 1.7 * tesla);
+        fFieldSetup = new FieldSetup(fieldValue);
+
+        // Register the field setup for deleting
+        G4AutoDelete::Register(fFieldSetup);
+    }
+    else
+    {
+        // A rebuilt geometry has new logical volumes
+        fFieldSetup->AttachRegions();
+    }
+}
+
+void DetectorConstruction::SetSVTCut(G4double val)
+{
+    fSVTCut = val;
 
-    // Register the field messenger for deleting
-    G4AutoDelete::Register(fMagFieldMessenger);
+    // Between runs the cuts are updated in place and picked up at the next /run/beamOn
+    auto svtRegion = G4RegionStore::GetInstance()->GetRegion("SVT_Region", false);
+    if (svtRegion && svtRegion->GetProductionCuts()) {
+        svtRegion->GetProductionCuts()->SetProductionCut(val);
+    }
+}
+
+G4Material *DetectorConstruction::GetMergedMaterial(G4double cuWidth) const
+{
+    // Named by its composition, so a rebuilt geometry reuses it
+    G4String name = "SVT_SiCu_" + std::to_string(std::lround(fSiWidth / nm)) + "_"
+                    + std::to_string(std::lround(cuWidth / nm));
+    if (auto material = G4Material::GetMaterial(name, false)) {
+        return material;
+    }
+
+    // With mass fractions of the two layers, the mixture's radiation length
+    // (the mass-weighted harmonic mean) gives the same X/X0 over the full width
+    auto silicon = G4Material::GetMaterial("G4_Si");
+    auto copper = G4Material::GetMaterial("G4_Cu");
+    G4double siMass = silicon->GetDensity() * fSiWidth;
+    G4double cuMass = copper->GetDensity() * cuWidth;
+    auto material = new G4Material(name, (siMass + cuMass) / (fSiWidth + cuWidth), 2);
+    material->AddMaterial(silicon, siMass / (siMass + cuMass));
+    material->AddMaterial(copper, cuMass / (siMass + cuMass));
+    return material;
+}
+
+G4double DetectorConstruction::GetEnvelopeRadius() const
+{
+    G4double radius = 0.;
+    for (auto r : fBarrelRadii) radius = std::max(radius, r);
+    for (auto r : fDiscOuterRadii) radius = std::max(radius, r);
+    return radius + fEnvelopeMargin;
+}
+
+G4double DetectorConstruction::GetEnvelopeHalfLength() const
+{
+    G4double halfLength = 0.;
+    for (auto l : fBarrelLengths) halfLength = std::max(halfLength, l / 2);
+    for (auto z : fDiscZPositions) halfLength = std::max(halfLength, std::abs(z));
+    return halfLength + fEnvelopeMargin;
 }
@@ -33,6 +33,7 @@
 
 #include "G4UIcmdWithADouble.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAString.hh"
 #include "G4UIdirectory.hh"
 
 DetectorMessenger::DetectorMessenger(DetectorConstruction *det) : fDetectorConstruction(det)
@@ -60,6 +61,24 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction *det) : fDetectorConst
     fMaterialWidth3Cmd->SetGuidance("Set material width of OB 4 layer");
     fMaterialWidth3Cmd->SetParameterName("materialWidth3", false);
     fMaterialWidth3Cmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fSVTCutCmd = new G4UIcmdWithADoubleAndUnit("/det/svtCut", this);
+    fSVTCutCmd->SetGuidance("Set production cut (range) for gammas, e-, e+ and protons in SVT_Region");
+    fSVTCutCmd->SetParameterName("cut", false);
+    fSVTCutCmd->SetUnitCategory("Length");
+    fSVTCutCmd->SetRange("cut > 0");
+    fSVTCutCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fLayerModeCmd = new G4UIcmdWithAString("/det/layerMode", this);
+    fLayerModeCmd->SetGuidance("Select how a layer and its support material are built");
+    fLayerModeCmd->SetGuidance("  nested: copper support volume with the silicon inside it");
+    fLayerModeCmd->SetGuidance("  merged: one volume of a silicon-copper mixture with the same X/X0,");
+    fLayerModeCmd->SetGuidance("          hits placed on the silicon surface");
+    fLayerModeCmd->SetGuidance("  staves: barrel staves and disc tiles of MAPS sensors, with gaps,");
+    fLayerModeCmd->SetGuidance("          hits with packed layer/stave/sensor IDs");
+    fLayerModeCmd->SetParameterName("mode", false);
+    fLayerModeCmd->SetCandidates("nested merged staves");
+    fLayerModeCmd->AvailableForStates(G4State_PreInit);
 }
 
 DetectorMessenger::~DetectorMessenger()
@@ -69,6 +88,8 @@ DetectorMessenger::~DetectorMessenger()
     delete fMaterialWidth1Cmd;
     delete fMaterialWidth2Cmd;
     delete fMaterialWidth3Cmd;
+    delete fSVTCutCmd;
+    delete fLayerModeCmd;
 }
 
 void DetectorMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
@@ -85,4 +106,18 @@ void DetectorMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
     if (command == fMaterialWidth3Cmd) {
         fDetectorConstruction->SetMaterialWidth3(fMaterialWidth3Cmd->GetNewDoubleValue(newValue));
     }
+    if (command == fSVTCutCmd) {
+        fDetectorConstruction->SetSVTCut(fSVTCutCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fLayerModeCmd) {
+        if (newValue == "merged") {
+            fDetectorConstruction->SetLayerMode(DetectorConstruction::kMerged);
+        }
+        else if (newValue == "staves") {
+            fDetectorConstruction->SetLayerMode(DetectorConstruction::kStaves);
+        }
+        else {
+            fDetectorConstruction->SetLayerMode(DetectorConstruction::kNested);
+        }
+    }
 }
@@ -35,7 +35,7 @@
 
 void EventAction::BeginOfEventAction(const G4Event *)
 {
-    trackInfo = {};
+    primaries.clear();
 }
 
 void EventAction::EndOfEventAction(const G4Event *event) {}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "FieldMap.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+constexpr char kFieldMapMagic[8] = {'B', '8', 'F', 'I', 'E', 'L', 'D', 'M'};
+constexpr std::uint32_t kFieldMapVersion = 1;
+
+bool SourceStamp(const std::string &fileName, std::uint64_t &size, std::int64_t &modified)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(fileName, error);
+    if (error)
+        return false;
+    modified = std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+    return !error;
+}
+
+bool HasMagic(const std::string &fileName)
+{
+    char magic[8] = {};
+    std::ifstream in(fileName, std::ios::binary);
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kFieldMapMagic, sizeof(magic)) == 0;
+}
+}
+
+std::shared_ptr<const FieldMapData> FieldMapData::Load(const std::string &fileName)
+{
+    // One mapping per file for the whole process; threads share it read-only
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const FieldMapData>> loaded;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto data = loaded[fileName].lock())
+        return data;
+
+    auto data = std::make_shared<FieldMapData>();
+    if (!data->Open(fileName))
+        return nullptr;
+    loaded[fileName] = data;
+    return data;
+}
+
+bool FieldMapData::Open(const std::string &fileName)
+{
+    fFileName = fileName;
+
+    std::string binaryFile = fileName;
+    std::uint64_t sourceSize = 0;
+    std::int64_t sourceModified = 0;
+    bool converted = !HasMagic(fileName);
+    if (converted)
+    {
+        binaryFile = fileName + ".bin";
+        if (!SourceStamp(fileName, sourceSize, sourceModified))
+            return false;
+    }
+
+    auto headerValid = [&]() {
+        if (fFile.Size() < sizeof(FieldMapHeader))
+            return false;
+        auto header = reinterpret_cast<const FieldMapHeader *>(fFile.Data());
+        std::size_t numAxes = header->type == kRZ ? 2 : 3;
+        std::size_t numComponents = numAxes;
+        // Interpolation needs a cell, two nodes, along every axis of the map
+        for (std::size_t axis = 0; axis < numAxes; axis++)
+        {
+            if (header->n[axis] < 2 || !(header->step[axis] > 0.))
+                return false;
+        }
+        return std::memcmp(header->magic, kFieldMapMagic, sizeof(kFieldMapMagic)) == 0
+            && header->version == kFieldMapVersion
+            && (header->type == kRZ || header->type == kXYZ)
+            && (!converted || (header->sourceSize == sourceSize && header->sourceModified == sourceModified))
+            && fFile.Size() == sizeof(FieldMapHeader)
+                   + std::size_t(header->n[0]) * header->n[1] * header->n[2] * numComponents * sizeof(double);
+    };
+
+    if (!fFile.Open(binaryFile) || !headerValid())
+    {
+        if (!converted || !Convert(fileName, binaryFile) || !fFile.Open(binaryFile) || !headerValid())
+            return false;
+    }
+
+    fHeader = reinterpret_cast<const FieldMapHeader *>(fFile.Data());
+    fValues = reinterpret_cast<const double *>(fFile.Data() + sizeof(FieldMapHeader));
+    return true;
+}
+
+bool FieldMapData::Convert(const std::string &textFile, const std::string &binaryFile)
+{
+    FieldMapHeader header{};
+    std::memcpy(header.magic, kFieldMapMagic, sizeof(kFieldMapMagic));
+    header.version = kFieldMapVersion;
+    if (!SourceStamp(textFile, header.sourceSize, header.sourceModified))
+        return false;
+
+    std::ifstream in(textFile);
+    std::vector<std::vector<double>> rows;
+    std::string line;
+    std::size_t numColumns = 0;
+    while (std::getline(in, line))
+    {
+        auto start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        std::istringstream is(line);
+        std::vector<double> row;
+        double value;
+        while (is >> value)
+            row.push_back(value);
+        if (numColumns == 0)
+            numColumns = row.size();
+        if (row.size() != numColumns || (numColumns != 4 && numColumns != 6))
+        {
+            G4cerr << "FieldMapData: bad line in " << textFile << ": " << line << G4endl;
+            return false;
+        }
+        rows.push_back(std::move(row));
+    }
+    if (rows.empty())
+        return false;
+
+    header.type = numColumns == 4 ? kRZ : kXYZ;
+    std::size_t numAxes = header.type == kRZ ? 2 : 3;
+    std::size_t numComponents = numAxes;
+
+    // The nodes may be listed in any order but must form a regular grid
+    std::array<std::vector<double>, 3> axes;
+    for (std::size_t axis = 0; axis < 3; axis++)
+    {
+        auto &values = axes[axis];
+        if (axis < numAxes)
+        {
+            for (const auto &row : rows)
+                values.push_back(row[axis]);
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+        else
+        {
+            values.push_back(0.);
+        }
+        header.n[axis] = values.size();
+        header.min[axis] = values.front();
+        header.step[axis] = values.size() > 1 ? (values.back() - values.front()) / (values.size() - 1) : 1.;
+        if (axis < numAxes && values.size() < 2)
+        {
+            G4cerr << "FieldMapData: " << textFile << " has a single node along axis " << axis
+                   << ", at least two are needed to interpolate" << G4endl;
+            return false;
+        }
+    }
+
+    std::size_t numNodes = std::size_t(header.n[0]) * header.n[1] * header.n[2];
+    if (rows.size() != numNodes)
+    {
+        G4cerr << "FieldMapData: " << textFile << " has " << rows.size() << " nodes, a full grid needs "
+               << numNodes << G4endl;
+        return false;
+    }
+
+    std::vector<double> values(numNodes * numComponents);
+    for (const auto &row : rows)
+    {
+        std::size_t index = 0;
+        for (std::size_t axis = 0; axis < 3; axis++)
+        {
+            double u = axis < numAxes ? (row[axis] - header.min[axis]) / header.step[axis] : 0.;
+            auto i = std::lround(u);
+            if (std::abs(u - i) > 1e-3)
+            {
+                G4cerr << "FieldMapData: " << textFile << " is not a regular grid" << G4endl;
+                return false;
+            }
+            index = index * header.n[axis] + i;
+        }
+        for (std::size_t c = 0; c < numComponents; c++)
+            values[index * numComponents + c] = row[numAxes + c];
+    }
+
+    // Write to a temporary file first, so a concurrent job never maps half a map
+    std::string tmpFile = binaryFile + ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double));
+        if (!out)
+        {
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpFile.c_str(), binaryFile.c_str()) != 0)
+    {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+
+    G4cout << "FieldMapData: converted " << textFile << " (" << header.n[0] << " x " << header.n[1]
+           << " x " << header.n[2] << " nodes) into " << binaryFile << G4endl;
+    return true;
+}
+
+FieldMap::FieldMap(std::shared_ptr<const FieldMapData> data, G4double scale)
+    : fData(std::move(data)), fScale(scale)
+{
+    fNumAxes = fData->Header().type == FieldMapData::kRZ ? 2 : 3;
+    fNumComponents = fNumAxes;
+}
+
+void FieldMap::GetFieldValue(const G4double point[4], G4double *field) const
+{
+    const auto &header = fData->Header();
+
+    // Grid coordinates, (r, z) or (x, y, z)
+    G4double r = 0.;
+    std::array<G4double, 3> coordinates;
+    if (fNumAxes == 2)
+    {
+        r = std::sqrt(point[0] * point[0] + point[1] * point[1]);
+        coordinates = {r / mm, point[2] / mm, 0.};
+    }
+    else
+    {
+        coordinates = {point[0] / mm, point[1] / mm, point[2] / mm};
+    }
+
+    std::array<std::int64_t, 3> cell = {0, 0, 0};
+    std::array<G4double, 3> t = {0., 0., 0.};
+    for (G4int axis = 0; axis < fNumAxes; axis++)
+    {
+        G4double u = (coordinates[axis] - header.min[axis]) / header.step[axis];
+        std::int64_t i = static_cast<std::int64_t>(std::floor(u));
+        if (i < 0 || u > header.n[axis] - 1)
+        {
+            field[0] = field[1] = field[2] = 0.;
+            return;
+        }
+        // The last node belongs to the cell below it
+        i = std::min<std::int64_t>(i, header.n[axis] - 2);
+        cell[axis] = i;
+        t[axis] = u - i;
+    }
+
+    if (cell != fCachedCell)
+        LoadCell(cell);
+
+    // Linear interpolation along each axis in turn over the 2^numAxes corners
+    G4double b[3] = {0., 0., 0.};
+    G4int numCorners = 1 << fNumAxes;
+    for (G4int corner = 0; corner < numCorners; corner++)
+    {
+        G4double weight = 1.;
+        for (G4int axis = 0; axis < fNumAxes; axis++)
+        {
+            G4bool upper = corner & (1 << (fNumAxes - 1 - axis));
+            weight *= upper ? t[axis] : 1. - t[axis];
+        }
+        for (G4int c = 0; c < fNumComponents; c++)
+            b[c] += weight * fCorners[corner][c];
+    }
+
+    if (fNumAxes == 2)
+    {
+        // (Br, Bz) to (Bx, By, Bz)
+        G4double br = b[0];
+        field[0] = r > 0. ? br * point[0] / r * fScale * tesla : 0.;
+        field[1] = r > 0. ? br * point[1] / r * fScale * tesla : 0.;
+        field[2] = b[1] * fScale * tesla;
+    }
+    else
+    {
+        field[0] = b[0] * fScale * tesla;
+        field[1] = b[1] * fScale * tesla;
+        field[2] = b[2] * fScale * tesla;
+    }
+}
+
+void FieldMap::LoadCell(const std::array<std::int64_t, 3> &cell) const
+{
+    const auto &header = fData->Header();
+    const double *values = fData->Values();
+
+    G4int numCorners = 1 << fNumAxes;
+    for (G4int corner = 0; corner < numCorners; corner++)
+    {
+        std::size_t index = 0;
+        for (G4int axis = 0; axis < 3; axis++)
+        {
+            G4bool upper = axis < fNumAxes && (corner & (1 << (fNumAxes - 1 - axis)));
+            index = index * header.n[axis] + cell[axis] + (upper ? 1 : 0);
+        }
+        for (G4int c = 0; c < fNumComponents; c++)
+            fCorners[corner][c] = values[index * fNumComponents + c];
+    }
+    fCachedCell = cell;
+}
@@ -0,0 +1,175 @@
+#include "FieldMessenger.hh"
+
+#include "FieldSetup.hh"
+
+#include "G4UIcmdWith3VectorAndUnit.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIdirectory.hh"
+
+FieldMessenger::FieldMessenger(FieldSetup *fieldSetup) : fFieldSetup(fieldSetup)
+{
+    fFieldDirectory = new G4UIdirectory("/det/field/");
+    fFieldDirectory->SetGuidance("Magnetic field and field propagation control");
+
+    fGlobalFieldDirectory = new G4UIdirectory("/globalField/");
+    fGlobalFieldDirectory->SetGuidance("Global uniform magnetic field");
+
+    fValueCmd = new G4UIcmdWith3VectorAndUnit("/det/field/value", this);
+    fValueCmd->SetGuidance("Set uniform magnetic field value (0 switches off field propagation)");
+    fValueCmd->SetParameterName("Bx", "By", "Bz", false);
+    fValueCmd->SetUnitCategory("Magnetic flux density");
+    fValueCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fGlobalValueCmd = new G4UIcmdWith3VectorAndUnit("/globalField/setValue", this);
+    fGlobalValueCmd->SetGuidance("Set uniform magnetic field value, same as /det/field/value");
+    fGlobalValueCmd->SetParameterName("Bx", "By", "Bz", false);
+    fGlobalValueCmd->SetUnitCategory("Magnetic flux density");
+    fGlobalValueCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMapCmd = new G4UIcmdWithAString("/det/field/map", this);
+    fMapCmd->SetGuidance("Use a field map instead of the uniform field (/det/field/value switches back)");
+    fMapCmd->SetGuidance("Text maps have columns r z Br Bz or x y z Bx By Bz (mm, tesla) on a regular grid,");
+    fMapCmd->SetGuidance("and are converted once to a binary <file>.bin that all threads memory-map");
+    fMapCmd->SetParameterName("file", false);
+    fMapCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMapScaleCmd = new G4UIcmdWithADouble("/det/field/mapScale", this);
+    fMapScaleCmd->SetGuidance("Scale factor applied to the field map values");
+    fMapScaleCmd->SetParameterName("scale", false);
+    fMapScaleCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fRegionCmd = new G4UIcmdWithAString("/det/field/region", this);
+    fRegionCmd->SetGuidance("Select the region the following propagation settings apply to");
+    fRegionCmd->SetGuidance("world is the global field manager; any other region, e.g. SVT_Region,");
+    fRegionCmd->SetGuidance("gets its own field manager, starting from the world settings");
+    fRegionCmd->SetParameterName("region", false);
+    fRegionCmd->AvailableForStates(G4State_Idle);
+
+    fStepperCmd = new G4UIcmdWithAString("/det/field/stepper", this);
+    fStepperCmd->SetGuidance("Select the integration stepper");
+    fStepperCmd->SetGuidance("exactHelix is exact in a uniform field, dormandPrince745 is the Geant4 default");
+    fStepperCmd->SetParameterName("stepper", false);
+    fStepperCmd->SetCandidates(FieldSetup::stepperNames);
+    fStepperCmd->AvailableForStates(G4State_Idle);
+
+    fMinStepCmd = new G4UIcmdWithADoubleAndUnit("/det/field/minStep", this);
+    fMinStepCmd->SetGuidance("Set minimum step of the integration driver");
+    fMinStepCmd->SetParameterName("minStep", false);
+    fMinStepCmd->SetUnitCategory("Length");
+    fMinStepCmd->SetRange("minStep > 0");
+    fMinStepCmd->AvailableForStates(G4State_Idle);
+
+    fDeltaChordCmd = new G4UIcmdWithADoubleAndUnit("/det/field/deltaChord", this);
+    fDeltaChordCmd->SetGuidance("Set maximum sagitta of a chord segment");
+    fDeltaChordCmd->SetParameterName("deltaChord", false);
+    fDeltaChordCmd->SetUnitCategory("Length");
+    fDeltaChordCmd->SetRange("deltaChord > 0");
+    fDeltaChordCmd->AvailableForStates(G4State_Idle);
+
+    fDeltaIntersectionCmd = new G4UIcmdWithADoubleAndUnit("/det/field/deltaIntersection", this);
+    fDeltaIntersectionCmd->SetGuidance("Set accuracy of volume boundary intersections");
+    fDeltaIntersectionCmd->SetParameterName("deltaIntersection", false);
+    fDeltaIntersectionCmd->SetUnitCategory("Length");
+    fDeltaIntersectionCmd->SetRange("deltaIntersection > 0");
+    fDeltaIntersectionCmd->AvailableForStates(G4State_Idle);
+
+    fDeltaOneStepCmd = new G4UIcmdWithADoubleAndUnit("/det/field/deltaOneStep", this);
+    fDeltaOneStepCmd->SetGuidance("Set position accuracy of one integration step");
+    fDeltaOneStepCmd->SetParameterName("deltaOneStep", false);
+    fDeltaOneStepCmd->SetUnitCategory("Length");
+    fDeltaOneStepCmd->SetRange("deltaOneStep > 0");
+    fDeltaOneStepCmd->AvailableForStates(G4State_Idle);
+
+    fEpsMinCmd = new G4UIcmdWithADouble("/det/field/epsMin", this);
+    fEpsMinCmd->SetGuidance("Set minimum relative integration accuracy (for long steps)");
+    fEpsMinCmd->SetParameterName("epsMin", false);
+    fEpsMinCmd->SetRange("epsMin > 0");
+    fEpsMinCmd->AvailableForStates(G4State_Idle);
+
+    fEpsMaxCmd = new G4UIcmdWithADouble("/det/field/epsMax", this);
+    fEpsMaxCmd->SetGuidance("Set maximum relative integration accuracy (for short steps)");
+    fEpsMaxCmd->SetParameterName("epsMax", false);
+    fEpsMaxCmd->SetRange("epsMax > 0");
+    fEpsMaxCmd->AvailableForStates(G4State_Idle);
+
+    fPrintCmd = new G4UIcmdWithoutParameter("/det/field/print", this);
+    fPrintCmd->SetGuidance("Print the field value and propagation settings of every region");
+    fPrintCmd->AvailableForStates(G4State_Idle);
+
+    fBenchmarkCmd = new G4UIcmdWithAnInteger("/det/field/benchmark", this);
+    fBenchmarkCmd->SetGuidance("Time field evaluations of the uniform field and of the loaded field map");
+    fBenchmarkCmd->SetParameterName("n", true);
+    fBenchmarkCmd->SetDefaultValue(1000000);
+    fBenchmarkCmd->SetRange("n > 0");
+    fBenchmarkCmd->AvailableForStates(G4State_Idle);
+}
+
+FieldMessenger::~FieldMessenger()
+{
+    delete fValueCmd;
+    delete fGlobalValueCmd;
+    delete fMapCmd;
+    delete fMapScaleCmd;
+    delete fRegionCmd;
+    delete fStepperCmd;
+    delete fMinStepCmd;
+    delete fDeltaChordCmd;
+    delete fDeltaIntersectionCmd;
+    delete fDeltaOneStepCmd;
+    delete fEpsMinCmd;
+    delete fEpsMaxCmd;
+    delete fPrintCmd;
+    delete fBenchmarkCmd;
+    delete fGlobalFieldDirectory;
+    delete fFieldDirectory;
+}
+
+void FieldMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+    if (command == fValueCmd) {
+        fFieldSetup->SetFieldValue(fValueCmd->GetNew3VectorValue(newValue));
+    }
+    if (command == fGlobalValueCmd) {
+        fFieldSetup->SetFieldValue(fGlobalValueCmd->GetNew3VectorValue(newValue));
+    }
+    if (command == fMapCmd) {
+        fFieldSetup->LoadFieldMap(newValue);
+    }
+    if (command == fMapScaleCmd) {
+        fFieldSetup->SetMapScale(fMapScaleCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fRegionCmd) {
+        fFieldSetup->SelectRegion(newValue);
+    }
+    if (command == fStepperCmd) {
+        fFieldSetup->SetStepper(newValue);
+    }
+    if (command == fMinStepCmd) {
+        fFieldSetup->SetMinStep(fMinStepCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fDeltaChordCmd) {
+        fFieldSetup->SetDeltaChord(fDeltaChordCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fDeltaIntersectionCmd) {
+        fFieldSetup->SetDeltaIntersection(fDeltaIntersectionCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fDeltaOneStepCmd) {
+        fFieldSetup->SetDeltaOneStep(fDeltaOneStepCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fEpsMinCmd) {
+        fFieldSetup->SetEpsilonMin(fEpsMinCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fEpsMaxCmd) {
+        fFieldSetup->SetEpsilonMax(fEpsMaxCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fPrintCmd) {
+        fFieldSetup->Print();
+    }
+    if (command == fBenchmarkCmd) {
+        fFieldSetup->Benchmark(fBenchmarkCmd->GetNewIntValue(newValue));
+    }
+}
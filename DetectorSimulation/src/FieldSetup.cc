@@ -0,0 +1,320 @@
+#include "FieldSetup.hh"
+
+#include "FieldMap.hh"
+#include "FieldMessenger.hh"
+
+#include "G4BogackiShampine23.hh"
+#include "G4CashKarpRKF45.hh"
+#include "G4ChordFinder.hh"
+#include "G4ClassicalRK4.hh"
+#include "G4DormandPrince745.hh"
+#include "G4ExactHelixStepper.hh"
+#include "G4FieldManager.hh"
+#include "G4HelixMixedStepper.hh"
+#include "G4LogicalVolume.hh"
+#include "G4MagIntegratorDriver.hh"
+#include "G4Mag_UsualEqRhs.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4TransportationManager.hh"
+#include "G4UniformMagField.hh"
+#include "G4UnitsTable.hh"
+#include "G4ios.hh"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+FieldSetup::FieldSetup(const G4ThreeVector &fieldValue)
+{
+    fUniformField = new G4UniformMagField(fieldValue);
+    fField = fUniformField;
+    fEquation = new G4Mag_UsualEqRhs(fField);
+
+    auto &world = fRegions["world"];
+    world.fieldManager = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+    fSelected = &world;
+
+    SetFieldValue(fieldValue);
+    UpdateChordFinder(world);
+
+    fMessenger = new FieldMessenger(this);
+}
+
+FieldSetup::~FieldSetup()
+{
+    delete fMessenger;
+
+    for (auto &[name, setup] : fRegions) {
+        delete setup.fieldManager->GetChordFinder();
+        setup.fieldManager->SetChordFinder(nullptr);
+        if (setup.ownsFieldManager) {
+            delete setup.fieldManager;
+        }
+    }
+    delete fEquation;
+    delete fUniformField;
+}
+
+void FieldSetup::SetFieldValue(const G4ThreeVector &value)
+{
+    fUniformField->SetFieldValue(value);
+
+    // As G4GlobalMagFieldMessenger, a zero field switches off field propagation
+    if (fField == fUniformField) {
+        for (auto &[name, setup] : fRegions) {
+            setup.fieldManager->SetDetectorField(value.mag2() > 0. ? fField : nullptr);
+        }
+    }
+    else {
+        UseField(fUniformField, value.mag2() > 0.);
+        fFieldMap.reset();
+    }
+}
+
+G4bool FieldSetup::LoadFieldMap(const G4String &fileName)
+{
+    auto data = FieldMapData::Load(fileName);
+    if (!data) {
+        G4Exception("FieldSetup::LoadFieldMap",
+                    "FIELD_MAP_READ",
+                    JustWarning,
+                    ("Cannot read field map " + fileName + ", field unchanged").c_str());
+        return false;
+    }
+
+    // The old map stays alive until nothing refers to it any more
+    auto fieldMap = std::make_unique<FieldMap>(data, fMapScale);
+    UseField(fieldMap.get(), true);
+    fFieldMap = std::move(fieldMap);
+    return true;
+}
+
+void FieldSetup::SetMapScale(G4double scale)
+{
+    fMapScale = scale;
+    if (fFieldMap) {
+        LoadFieldMap(fFieldMap->GetData().FileName());
+    }
+}
+
+void FieldSetup::UseField(G4MagneticField *field, G4bool enabled)
+{
+    fField = field;
+    fEquation->SetFieldObj(field);
+    for (auto &[name, setup] : fRegions) {
+        setup.fieldManager->SetDetectorField(enabled ? field : nullptr);
+        // The default chord finder keeps its own pointer to the field
+        UpdateChordFinder(setup);
+    }
+}
+
+void FieldSetup::SelectRegion(const G4String &name)
+{
+    if (fRegions.count(name) == 0) {
+        auto region = G4RegionStore::GetInstance()->GetRegion(name, false);
+        if (!region) {
+            G4Exception("FieldSetup::SelectRegion",
+                        "FIELD_NO_REGION",
+                        JustWarning,
+                        ("No region called " + name + ", field settings unchanged").c_str());
+            return;
+        }
+
+        // A region with its own settings gets its own field manager, starting from the world settings
+        auto &setup = fRegions[name];
+        const auto &world = fRegions["world"];
+        setup.fieldManager = new G4FieldManager(world.fieldManager->GetDetectorField());
+        setup.ownsFieldManager = true;
+        setup.stepperName = world.stepperName;
+        setup.minStep = world.minStep;
+        setup.deltaChord = world.deltaChord;
+        setup.fieldManager->SetAccuraciesWithDeltaOneStep(world.fieldManager->GetDeltaOneStep());
+        setup.fieldManager->SetDeltaIntersection(world.fieldManager->GetDeltaIntersection());
+        setup.fieldManager->SetMinimumEpsilonStep(world.fieldManager->GetMinimumEpsilonStep());
+        setup.fieldManager->SetMaximumEpsilonStep(world.fieldManager->GetMaximumEpsilonStep());
+        UpdateChordFinder(setup);
+        AttachToRegion(name, setup.fieldManager);
+    }
+    fSelected = &fRegions[name];
+    fSelectedName = name;
+}
+
+void FieldSetup::AttachRegions()
+{
+    for (const auto &[name, setup] : fRegions) {
+        if (setup.ownsFieldManager) {
+            AttachToRegion(name, setup.fieldManager);
+        }
+    }
+}
+
+void FieldSetup::AttachToRegion(const G4String &name, G4FieldManager *fieldManager)
+{
+    // Not G4Region::SetFieldManager: the region is shared by all threads,
+    // while the field manager of a logical volume is thread-local
+    auto region = G4RegionStore::GetInstance()->GetRegion(name, false);
+    if (!region) {
+        return;
+    }
+    auto volume = region->GetRootLogicalVolumeIterator();
+    for (std::size_t i = 0; i < region->GetNumberOfRootVolumes(); i++, ++volume) {
+        (*volume)->SetFieldManager(fieldManager, true);
+    }
+}
+
+void FieldSetup::SetStepper(const G4String &name)
+{
+    fSelected->stepperName = name;
+    UpdateChordFinder(*fSelected);
+}
+
+void FieldSetup::SetMinStep(G4double minStep)
+{
+    fSelected->minStep = minStep;
+    UpdateChordFinder(*fSelected);
+}
+
+void FieldSetup::SetDeltaChord(G4double deltaChord)
+{
+    fSelected->deltaChord = deltaChord;
+    fSelected->fieldManager->GetChordFinder()->SetDeltaChord(deltaChord);
+}
+
+void FieldSetup::SetDeltaIntersection(G4double deltaIntersection)
+{
+    fSelected->fieldManager->SetDeltaIntersection(deltaIntersection);
+}
+
+void FieldSetup::SetDeltaOneStep(G4double deltaOneStep)
+{
+    fSelected->fieldManager->SetDeltaOneStep(deltaOneStep);
+}
+
+void FieldSetup::SetEpsilonMin(G4double epsilonMin)
+{
+    fSelected->fieldManager->SetMinimumEpsilonStep(epsilonMin);
+}
+
+void FieldSetup::SetEpsilonMax(G4double epsilonMax)
+{
+    fSelected->fieldManager->SetMaximumEpsilonStep(epsilonMax);
+}
+
+void FieldSetup::UpdateChordFinder(RegionSetup &setup)
+{
+    auto fieldManager = setup.fieldManager;
+    G4ChordFinder *chordFinder = nullptr;
+    std::unique_ptr<G4MagIntegratorStepper> stepper;
+
+    const auto &name = setup.stepperName;
+    if (name == "classicalRK4") {
+        stepper = std::make_unique<G4ClassicalRK4>(fEquation);
+    }
+    else if (name == "cashKarpRKF45") {
+        stepper = std::make_unique<G4CashKarpRKF45>(fEquation);
+    }
+    else if (name == "bogackiShampine23") {
+        stepper = std::make_unique<G4BogackiShampine23>(fEquation);
+    }
+    else if (name == "exactHelix") {
+        if (fField != fUniformField) {
+            G4Exception("FieldSetup::UpdateChordFinder",
+                        "FIELD_HELIX_MAP",
+                        JustWarning,
+                        "exactHelix assumes a uniform field within each step and has no error control in a field map");
+        }
+        stepper = std::make_unique<G4ExactHelixStepper>(fEquation);
+    }
+    else if (name == "helixMixed") {
+        stepper = std::make_unique<G4HelixMixedStepper>(fEquation);
+    }
+
+    if (stepper) {
+        auto driver = new G4MagInt_Driver(setup.minStep, stepper.get(), stepper->GetNumberOfVariables());
+        chordFinder = new G4ChordFinder(driver);
+    }
+    else {
+        // Geant4 default, Dormand-Prince 7(4)5 with interpolation
+        chordFinder = new G4ChordFinder(fField, setup.minStep);
+    }
+    chordFinder->SetDeltaChord(setup.deltaChord);
+
+    // The old chord finder deletes its driver, which uses the old stepper
+    delete fieldManager->GetChordFinder();
+    fieldManager->SetChordFinder(chordFinder);
+    setup.stepper = std::move(stepper);
+}
+
+void FieldSetup::Print() const
+{
+    G4cout << G4endl;
+    if (fFieldMap) {
+        G4cout << "Magnetic field map " << fFieldMap->GetData().FileName() << " scaled by " << fMapScale << G4endl;
+    }
+    else {
+        G4cout << "Magnetic field " << G4BestUnit(fUniformField->GetConstantFieldValue(), "Magnetic flux density")
+               << G4endl;
+    }
+    for (const auto &[name, setup] : fRegions) {
+        auto fieldManager = setup.fieldManager;
+        G4cout << " " << name << ": stepper " << setup.stepperName
+               << ", minStep " << G4BestUnit(setup.minStep, "Length")
+               << ", deltaChord " << G4BestUnit(setup.deltaChord, "Length")
+               << ", deltaIntersection " << G4BestUnit(fieldManager->GetDeltaIntersection(), "Length")
+               << ", deltaOneStep " << G4BestUnit(fieldManager->GetDeltaOneStep(), "Length")
+               << ", epsMin " << fieldManager->GetMinimumEpsilonStep()
+               << ", epsMax " << fieldManager->GetMaximumEpsilonStep() << G4endl;
+    }
+}
+
+void FieldSetup::Benchmark(G4int n) const
+{
+    if (!fFieldMap) {
+        G4cout << "No field map loaded, use /det/field/map first" << G4endl;
+        return;
+    }
+
+    // Points inside the map, in the SVT volume. A local engine, so the benchmark
+    // does not change the event random numbers.
+    std::mt19937_64 engine(12345);
+    std::uniform_real_distribution<G4double> uniform(-1., 1.);
+    const G4double rMax = 45 * cm;
+    const G4double zMax = 140 * cm;
+
+    // Random walk with 1 mm steps, as successive calls of one track, and
+    // independent random points, which defeat the cell cache
+    std::vector<G4double> walk(4 * n), scattered(4 * n);
+    G4double position[3] = {0., 0., 0.};
+    for (G4int i = 0; i < n; i++) {
+        for (G4int j = 0; j < 3; j++) {
+            position[j] += uniform(engine) * mm;
+            walk[4 * i + j] = position[j];
+        }
+        walk[4 * i + 3] = 0.;
+        scattered[4 * i] = uniform(engine) * rMax;
+        scattered[4 * i + 1] = uniform(engine) * rMax;
+        scattered[4 * i + 2] = uniform(engine) * zMax;
+        scattered[4 * i + 3] = 0.;
+    }
+
+    auto time = [&](const G4MagneticField &field, const std::vector<G4double> &points) {
+        G4double value[3], sum = 0.;
+        auto start = std::chrono::steady_clock::now();
+        for (G4int i = 0; i < n; i++) {
+            field.GetFieldValue(&points[4 * i], value);
+            sum += value[2];
+        }
+        G4double ns = std::chrono::duration<G4double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        // Use the result, so the loop is not optimised away
+        volatile G4double sink = sum;
+        (void)sink;
+        return ns / n;
+    };
+
+    G4cout << G4endl << "Field evaluation, " << n << " calls (ns/call)" << G4endl
+           << " uniform field, random walk:    " << time(*fUniformField, walk) << G4endl
+           << " uniform field, random points:  " << time(*fUniformField, scattered) << G4endl
+           << " field map, random walk:        " << time(*fFieldMap, walk) << G4endl
+           << " field map, random points:      " << time(*fFieldMap, scattered) << G4endl;
+}
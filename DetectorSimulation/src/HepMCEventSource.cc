@@ -0,0 +1,353 @@
+#include "HepMCEventSource.hh"
+#include "HepMCIndexedReader.hh"
+
+#include "G4Exception.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/ReaderAscii.h"
+
+#include "BinaryEventFormat.h"
+
+#include <chrono>
+#include <set>
+
+HepMCEventSource &HepMCEventSource::Instance()
+{
+    static HepMCEventSource instance;
+    return instance;
+}
+
+HepMCEventSource::~HepMCEventSource()
+{
+    Close();
+}
+
+void HepMCEventSource::Open(const G4String &fileName, std::size_t prefetch, const HepMCSelection &selection)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fQueue && fileName == fFileName && selection == fSelection)
+        return;
+
+    // A different file or selection was requested: stop the old reader before
+    // replacing the queue. Only done between runs, when no worker is popping events.
+    StopReader();
+
+    std::shared_ptr<HepMC3::ReaderAscii> reader;
+    std::shared_ptr<HepMCIndex> index;
+    std::shared_ptr<B8Event::Reader> binaryReader;
+    if (B8Event::HasExtension(fileName))
+    {
+        try
+        {
+            binaryReader = std::make_shared<B8Event::Reader>(fileName);
+        }
+        catch (const std::exception &error)
+        {
+            G4Exception("HepMCEventSource::Open",
+                        "BINARY_READER_FAIL",
+                        FatalException,
+                        error.what());
+            return;
+        }
+    }
+    else if (selection.NeedsIndex() || fSkip > 0)
+    {
+        // A resumed run jumps over the events already transported through the index
+        index = std::make_shared<HepMCIndex>();
+        if (!index->Open(fileName))
+        {
+            if (selection.NeedsIndex())
+            {
+                G4Exception("HepMCEventSource::Open",
+                            "HEPMC_INDEX_FAIL",
+                            FatalException,
+                            ("Cannot open or build index for HepMC file " + fileName).c_str());
+                return;
+            }
+            G4cout << "HepMCEventSource: no index for " << fileName
+                   << ", parsing the " << fSkip << " events to skip" << G4endl;
+            index.reset();
+        }
+    }
+    if (!binaryReader && !index)
+    {
+        reader = std::make_shared<HepMC3::ReaderAscii>(fileName);
+        if (reader->failed())
+        {
+            G4Exception("HepMCEventSource::Open",
+                        "HEPMC_READER_FAIL",
+                        FatalException,
+                        ("Cannot open HepMC file " + fileName).c_str());
+            return;
+        }
+    }
+
+    G4cout << "HepMCEventSource: reading " << fileName
+           << (index ? " through its index" : "")
+           << " with " << prefetch << " events prefetched" << G4endl;
+
+    fFileName = fileName;
+    fSelection = selection;
+    fQueue = std::make_unique<BoundedQueue<PrimaryEventRecord>>(prefetch);
+    fFinished = false;
+    fStop = false;
+    fEventsRead = 0;
+    if (binaryReader)
+        fReaderThread = std::thread(&HepMCEventSource::ReadBinaryLoop, this, binaryReader, selection);
+    else if (index)
+    {
+        fReaderThread = std::thread(&HepMCEventSource::ReadIndexedLoop, this, index, selection, fSkip);
+        fSkip = 0;
+    }
+    else
+        fReaderThread = std::thread(&HepMCEventSource::ReadLoop, this, reader);
+
+    // Without an index the skipped events are read and dropped. Other workers
+    // wait on the mutex, so nobody pops these before they are gone
+    for (; fSkip > 0; fSkip--)
+        Next();
+}
+
+std::unique_ptr<PrimaryEventRecord> HepMCEventSource::Next()
+{
+    if (!fQueue)
+        return nullptr;
+
+    for (;;)
+    {
+        // Read before the pop, so an event pushed after a failed pop changes it
+        G4long numPushed = fEventsRead.load(std::memory_order_acquire);
+        if (auto record = fQueue->TryPop())
+            return std::unique_ptr<PrimaryEventRecord>(record);
+
+        // Reader may have pushed its last events between the pop and this check
+        if (fFinished.load(std::memory_order_acquire))
+            return std::unique_ptr<PrimaryEventRecord>(fQueue->TryPop());
+
+        // Sleep until the reader pushes another event or reaches the end
+        std::unique_lock<std::mutex> lock(fWaitMutex);
+        fEventPushed.wait(lock, [&] {
+            return fEventsRead.load(std::memory_order_relaxed) != numPushed
+                || fFinished.load(std::memory_order_relaxed);
+        });
+    }
+}
+
+void HepMCEventSource::Close()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    StopReader();
+    fQueue.reset();
+    fFileName = "";
+    fSelection = {};
+}
+
+void HepMCEventSource::StopReader()
+{
+    if (fReaderThread.joinable())
+    {
+        fStop = true;
+        fReaderThread.join();
+    }
+    if (fQueue)
+    {
+        while (auto record = fQueue->TryPop())
+            delete record;
+    }
+}
+
+void HepMCEventSource::Push(PrimaryEventRecord *record)
+{
+    while (!fQueue->TryPush(record))
+    {
+        if (fStop.load(std::memory_order_relaxed))
+        {
+            delete record;
+            return;
+        }
+        // Workers are behind: no point burning a core while the queue is full
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    // Counted under the lock, so a worker cannot miss it between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock(fWaitMutex);
+        fEventsRead.fetch_add(1, std::memory_order_release);
+    }
+    fEventPushed.notify_one();
+}
+
+void HepMCEventSource::Finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(fWaitMutex);
+        fFinished.store(true, std::memory_order_release);
+    }
+    fEventPushed.notify_all();
+}
+
+PrimaryEventRecord *HepMCEventSource::Convert(HepMC3::GenEvent &hepmcEvent)
+{
+    hepmcEvent.set_units(HepMC3::Units::GEV, HepMC3::Units::MM);
+
+    auto record = new PrimaryEventRecord();
+    record->eventNumber = hepmcEvent.event_number();
+
+    for (const auto &vertex : hepmcEvent.vertices())
+    {
+        PrimaryVertexRecord vertexRecord;
+        auto position = vertex->position();
+        vertexRecord.position = G4ThreeVector(position.x() * mm, position.y() * mm, position.z() * mm);
+        // HepMC3 stores time as c*t in length units
+        vertexRecord.time = position.t() * mm / CLHEP::c_light;
+
+        for (const auto &particle : vertex->particles_out())
+        {
+            // HepMC3 status convention: 1 is usually final state
+            if (particle->status() != 1)
+                continue;
+
+            auto momentum = particle->momentum();
+            vertexRecord.particles.push_back(
+                {particle->pid(), G4ThreeVector(momentum.px() * GeV, momentum.py() * GeV, momentum.pz() * GeV)});
+        }
+
+        // Only keep vertices that actually have primaries
+        if (!vertexRecord.particles.empty())
+            record->vertices.push_back(std::move(vertexRecord));
+    }
+
+    return record;
+}
+
+void HepMCEventSource::ReadLoop(std::shared_ptr<HepMC3::ReaderAscii> reader)
+{
+    HepMC3::GenEvent hepmcEvent;
+
+    while (!fStop.load(std::memory_order_relaxed))
+    {
+        if (!reader->read_event(hepmcEvent) || reader->failed())
+            break;
+
+        Push(Convert(hepmcEvent));
+        hepmcEvent.clear();
+    }
+
+    reader->close();
+    Finish();
+}
+
+void HepMCEventSource::ReadIndexedLoop(std::shared_ptr<HepMCIndex> index, HepMCSelection selection, G4long skip)
+{
+    // Positions in the file of the events to read, in the order they are transported
+    std::vector<std::size_t> positions;
+    if (!selection.eventNumbers.empty())
+    {
+        for (auto eventNumber : selection.eventNumbers)
+        {
+            auto position = index->Find(eventNumber);
+            if (position < 0)
+            {
+                G4cout << "HepMCEventSource: event " << eventNumber << " is not in "
+                       << fFileName << ", skipped" << G4endl;
+                continue;
+            }
+            positions.push_back(position);
+        }
+    }
+    else
+    {
+        for (std::size_t i = selection.firstEvent; i < index->Size(); i += selection.stride)
+            positions.push_back(i);
+    }
+
+    // One reader for the whole file, so every event has the run info of its header
+    HepMCIndexedReader reader(*index);
+    G4long numRead = 0;
+    HepMC3::GenEvent hepmcEvent;
+    for (auto position : positions)
+    {
+        if (fStop.load(std::memory_order_relaxed))
+            break;
+        if (selection.maxEvents >= 0 && numRead >= selection.maxEvents)
+            break;
+        // Cached summary avoids parsing events that would be rejected anyway
+        if ((*index)[position].numFinalState < static_cast<std::uint32_t>(selection.minFinalState))
+            continue;
+        // Already transported before a resume: counted but never parsed
+        if (skip > 0)
+        {
+            skip--;
+            numRead++;
+            continue;
+        }
+
+        // Parse just this event straight out of the mapped file
+        if (!reader.Read(position, hepmcEvent))
+            break;
+
+        Push(Convert(hepmcEvent));
+        hepmcEvent.clear();
+        numRead++;
+    }
+
+    Finish();
+}
+
+void HepMCEventSource::ReadBinaryLoop(std::shared_ptr<B8Event::Reader> reader, HepMCSelection selection)
+{
+    // Decoding is cheap enough that selections are applied while streaming
+    std::set<G4long> eventNumbers(selection.eventNumbers.begin(), selection.eventNumbers.end());
+
+    B8Event::Event event;
+    G4long position = -1;
+    G4long numRead = 0;
+    while (!fStop.load(std::memory_order_relaxed) && reader->Next(event))
+    {
+        position++;
+        if (selection.maxEvents >= 0 && numRead >= selection.maxEvents)
+            break;
+
+        if (!eventNumbers.empty())
+        {
+            if (eventNumbers.count(event.eventNumber) == 0)
+                continue;
+        }
+        else if (position < selection.firstEvent || (position - selection.firstEvent) % selection.stride != 0)
+        {
+            continue;
+        }
+
+        auto record = new PrimaryEventRecord();
+        record->eventNumber = event.eventNumber;
+        G4int numFinalState = 0;
+        for (const auto &vertex : event.vertices)
+        {
+            PrimaryVertexRecord vertexRecord;
+            vertexRecord.position = G4ThreeVector(vertex.x * mm, vertex.y * mm, vertex.z * mm);
+            vertexRecord.time = vertex.t * mm / CLHEP::c_light;
+            for (const auto &particle : vertex.particles)
+            {
+                vertexRecord.particles.push_back(
+                    {particle.pdg, G4ThreeVector(particle.px * GeV, particle.py * GeV, particle.pz * GeV)});
+            }
+            numFinalState += vertex.particles.size();
+            record->vertices.push_back(std::move(vertexRecord));
+        }
+
+        if (numFinalState < selection.minFinalState)
+        {
+            delete record;
+            continue;
+        }
+
+        Push(record);
+        numRead++;
+    }
+
+    Finish();
+}
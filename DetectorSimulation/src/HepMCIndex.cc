@@ -0,0 +1,203 @@
+#include "HepMCIndex.hh"
+
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+constexpr char kIndexMagic[8] = {'B', '8', 'H', 'M', 'C', 'I', 'D', 'X'};
+constexpr std::uint32_t kIndexVersion = 1;
+
+struct HepMCIndexHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entrySize;
+    std::uint64_t numEvents;
+    std::uint64_t sourceSize;       // used to detect a stale index
+    std::int64_t sourceModified;
+    std::uint64_t endOffset;        // end of the last event
+};
+
+bool SourceStamp(const std::string &fileName, std::uint64_t &size, std::int64_t &modified)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(fileName, error);
+    if (error)
+        return false;
+    modified = std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+    return !error;
+}
+}
+
+bool HepMCIndex::Build(const std::string &hepmcFile, const std::string &indexFile)
+{
+    HepMCIndexHeader header{};
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.version = kIndexVersion;
+    header.entrySize = sizeof(HepMCIndexEntry);
+    if (!SourceStamp(hepmcFile, header.sourceSize, header.sourceModified))
+        return false;
+
+    MappedFile source;
+    if (!source.Open(hepmcFile))
+        return false;
+
+    std::vector<HepMCIndexEntry> entries;
+    header.endOffset = source.Size();
+
+    // HepMC3 ASCII is line based and every record type is keyed by its first
+    // character, so one pass over the lines is enough to find the events.
+    const char *data = source.Data();
+    std::size_t size = source.Size();
+    std::size_t lineStart = 0;
+    while (lineStart < size)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(data + lineStart, '\n', size - lineStart));
+        std::size_t next = lineEnd ? (lineEnd - data) + 1 : size;
+        std::string_view line(data + lineStart, next - lineStart);
+
+        if (line.size() > 1 && line[1] == ' ')
+        {
+            switch (line[0])
+            {
+            case 'E':
+            {
+                HepMCIndexEntry entry{};
+                entry.offset = lineStart;
+                entry.eventNumber = std::strtoll(line.data() + 2, nullptr, 10);
+                entries.push_back(entry);
+                break;
+            }
+            case 'V':
+                if (!entries.empty())
+                    entries.back().numVertices++;
+                break;
+            case 'P':
+                if (!entries.empty())
+                {
+                    entries.back().numParticles++;
+                    // status is the last field of a particle line
+                    auto trimmed = line.substr(0, line.find_last_not_of(" \r\n") + 1);
+                    auto status = trimmed.substr(trimmed.find_last_of(' ') + 1);
+                    if (status == "1")
+                        entries.back().numFinalState++;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        else if (line.rfind("HepMC::Asciiv3-END_EVENT_LISTING", 0) == 0)
+        {
+            header.endOffset = lineStart;
+        }
+
+        lineStart = next;
+    }
+    header.numEvents = entries.size();
+
+    // Write to a temporary file first, so a concurrent reader never maps half an index
+    std::string tmpFile = indexFile + ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(HepMCIndexEntry));
+        if (!out)
+        {
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpFile.c_str(), indexFile.c_str()) != 0)
+    {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+
+    G4cout << "HepMCIndex: indexed " << entries.size() << " events of " << hepmcFile
+           << " into " << indexFile << G4endl;
+    return true;
+}
+
+bool HepMCIndex::Open(const std::string &hepmcFile)
+{
+    std::string indexFile = IndexFileName(hepmcFile);
+
+    std::uint64_t sourceSize;
+    std::int64_t sourceModified;
+    if (!SourceStamp(hepmcFile, sourceSize, sourceModified) || !fEventFile.Open(hepmcFile))
+        return false;
+
+    auto headerValid = [&]() {
+        if (fIndexFile.Size() < sizeof(HepMCIndexHeader))
+            return false;
+        auto header = reinterpret_cast<const HepMCIndexHeader *>(fIndexFile.Data());
+        return std::memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) == 0
+            && header->version == kIndexVersion
+            && header->entrySize == sizeof(HepMCIndexEntry)
+            && header->sourceSize == sourceSize
+            && header->sourceModified == sourceModified
+            && fIndexFile.Size() == sizeof(HepMCIndexHeader) + header->numEvents * sizeof(HepMCIndexEntry);
+    };
+
+    if (!fIndexFile.Open(indexFile) || !headerValid())
+    {
+        if (!Build(hepmcFile, indexFile) || !fIndexFile.Open(indexFile) || !headerValid())
+            return false;
+    }
+
+    auto header = reinterpret_cast<const HepMCIndexHeader *>(fIndexFile.Data());
+    fEntries = reinterpret_cast<const HepMCIndexEntry *>(fIndexFile.Data() + sizeof(HepMCIndexHeader));
+    fNumEvents = header->numEvents;
+    fEndOffset = header->endOffset;
+
+    fSorted = std::is_sorted(fEntries, fEntries + fNumEvents,
+                             [](const HepMCIndexEntry &a, const HepMCIndexEntry &b) {
+                                 return a.eventNumber < b.eventNumber;
+                             });
+    fLookup.clear();
+    return true;
+}
+
+std::int64_t HepMCIndex::Find(std::int64_t eventNumber) const
+{
+    if (fSorted)
+    {
+        auto it = std::lower_bound(fEntries, fEntries + fNumEvents, eventNumber,
+                                   [](const HepMCIndexEntry &entry, std::int64_t number) {
+                                       return entry.eventNumber < number;
+                                   });
+        if (it == fEntries + fNumEvents || it->eventNumber != eventNumber)
+            return -1;
+        return it - fEntries;
+    }
+
+    if (fLookup.empty())
+    {
+        for (std::size_t i = 0; i < fNumEvents; i++)
+            fLookup.emplace(fEntries[i].eventNumber, i);
+    }
+    auto it = fLookup.find(eventNumber);
+    return it == fLookup.end() ? -1 : it->second;
+}
+
+std::string_view HepMCIndex::EventText(std::size_t i) const
+{
+    std::uint64_t begin = fEntries[i].offset;
+    std::uint64_t end = (i + 1 < fNumEvents) ? fEntries[i + 1].offset : fEndOffset;
+    return std::string_view(fEventFile.Data() + begin, end - begin);
+}
+
+std::string_view HepMCIndex::HeaderText() const
+{
+    std::uint64_t end = fNumEvents > 0 ? fEntries[0].offset : fEndOffset;
+    return std::string_view(fEventFile.Data(), end);
+}
@@ -0,0 +1,38 @@
+#include "HepMCIndexedReader.hh"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenRunInfo.h"
+#include "HepMC3/ReaderAscii.h"
+
+HepMCIndexedReader::HepMCIndexedReader(const HepMCIndex &index)
+    : fIndex(index), fStream(&fBuffer)
+{
+    Point(fIndex.HeaderText());
+    fReader = std::make_unique<HepMC3::ReaderAscii>(fStream);
+
+    // The header holds no E line, so this reads the run info and stops at its end
+    HepMC3::GenEvent header;
+    fReader->read_event(header);
+}
+
+HepMCIndexedReader::~HepMCIndexedReader() = default;
+
+bool HepMCIndexedReader::Read(std::size_t position, HepMC3::GenEvent &event)
+{
+    if (position >= fIndex.Size())
+        return false;
+    Point(fIndex.EventText(position));
+    return fReader->read_event(event);
+}
+
+std::shared_ptr<HepMC3::GenRunInfo> HepMCIndexedReader::GetRunInfo() const
+{
+    return fReader->run_info();
+}
+
+void HepMCIndexedReader::Point(std::string_view text)
+{
+    fBuffer.Point(text);
+    // The previous text ended in end of file
+    fStream.clear();
+}
@@ -0,0 +1,44 @@
+#include "MappedFile.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string &fileName)
+{
+    Close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    fData = static_cast<const char *>(data);
+    fSize = info.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (fData)
+        ::munmap(const_cast<char *>(fData), fSize);
+    fData = nullptr;
+    fSize = 0;
+}
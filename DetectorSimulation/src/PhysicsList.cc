@@ -0,0 +1,101 @@
+#include "PhysicsList.hh"
+
+#include "G4DecayPhysics.hh"
+#include "G4EmExtraPhysics.hh"
+#include "G4EmStandardPhysics.hh"
+#include "G4EmStandardPhysics_option1.hh"
+#include "G4EmStandardPhysics_option3.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "G4HadronElasticPhysics.hh"
+#include "G4HadronPhysicsFTFP_BERT.hh"
+#include "G4IonPhysics.hh"
+#include "G4NeutronTrackingCut.hh"
+#include "G4PhysListFactory.hh"
+#include "G4StepLimiterPhysics.hh"
+#include "G4StoppingPhysics.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <sstream>
+
+PhysicsList::PhysicsList(const G4String &emOption, G4bool decay, const G4String &hadronic)
+{
+    SetVerboseLevel(1);
+    SetDefaultCutValue(0.7 * mm);
+
+    if (emOption == "opt1") {
+        RegisterPhysics(new G4EmStandardPhysics_option1());
+    }
+    else if (emOption == "opt3") {
+        RegisterPhysics(new G4EmStandardPhysics_option3());
+    }
+    else if (emOption == "opt4") {
+        RegisterPhysics(new G4EmStandardPhysics_option4());
+    }
+    else {
+        RegisterPhysics(new G4EmStandardPhysics());
+    }
+
+    if (decay) {
+        RegisterPhysics(new G4DecayPhysics());
+    }
+
+    if (hadronic == "elastic" || hadronic == "full") {
+        RegisterPhysics(new G4HadronElasticPhysics());
+    }
+    if (hadronic == "full") {
+        // Same hadronic constructors as FTFP_BERT
+        RegisterPhysics(new G4EmExtraPhysics());
+        RegisterPhysics(new G4HadronPhysicsFTFP_BERT());
+        RegisterPhysics(new G4StoppingPhysics());
+        RegisterPhysics(new G4IonPhysics());
+        RegisterPhysics(new G4NeutronTrackingCut());
+    }
+}
+
+G4VModularPhysicsList *PhysicsList::Create(const G4String &spec)
+{
+    G4VModularPhysicsList *physicsList = nullptr;
+
+    std::istringstream is(spec);
+    std::string name;
+    std::getline(is, name, ',');
+
+    if (name == "lean") {
+        G4String emOption = "opt0";
+        G4bool decay = true;
+        G4String hadronic = "elastic";
+
+        std::string option;
+        while (std::getline(is, option, ',')) {
+            auto pos = option.find('=');
+            std::string key = option.substr(0, pos);
+            std::string value = pos == std::string::npos ? "" : option.substr(pos + 1);
+            if (key == "em" && (value == "opt0" || value == "opt1" || value == "opt3" || value == "opt4")) {
+                emOption = value;
+            }
+            else if (key == "decay" && (value == "on" || value == "off")) {
+                decay = value == "on";
+            }
+            else if (key == "hadronic" && (value == "none" || value == "elastic" || value == "full")) {
+                hadronic = value;
+            }
+            else {
+                G4cerr << "Invalid physics list option: " << option << G4endl;
+                return nullptr;
+            }
+        }
+        physicsList = new PhysicsList(emOption, decay, hadronic);
+    }
+    else {
+        G4PhysListFactory factory;
+        if (!is.eof() || !factory.IsReferencePhysList(name)) {
+            G4cerr << "Unknown physics list: " << spec << G4endl;
+            return nullptr;
+        }
+        physicsList = factory.GetReferencePhysList(name);
+    }
+
+    physicsList->RegisterPhysics(new G4StepLimiterPhysics());
+    return physicsList;
+}
@@ -0,0 +1,34 @@
+#include "PrimaryFilter.hh"
+
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+
+PrimaryFilter::Decision PrimaryFilter::Apply(G4int pdg, const G4ThreeVector &momentum) const
+{
+    if (!enabled)
+        return kAccepted;
+
+    // Cheapest checks first, the particle table lookup last
+    if (!pdgWhitelist.empty() && pdgWhitelist.count(pdg) == 0)
+        return kPDG;
+
+    G4double pt = momentum.perp();
+    if (pt < minPt)
+        return kPt;
+
+    // Particles along the beam axis have infinite pseudorapidity
+    if (pt == 0.)
+        return kEta;
+    G4double eta = momentum.pseudoRapidity();
+    if (eta < etaMin || eta > etaMax)
+        return kEta;
+
+    if (chargedOnly)
+    {
+        auto definition = G4ParticleTable::GetParticleTable()->FindParticle(pdg);
+        if (!definition || definition->GetPDGCharge() == 0.)
+            return kNeutral;
+    }
+
+    return kAccepted;
+}
@@ -29,6 +29,11 @@
 
 #include "PrimaryGeneratorAction.hh"
 
+#include "EventRandom.hh"
+#include "HepMCEventSource.hh"
+#include "PrimaryGeneratorMessenger.hh"
+#include "RunAction.hh"
+
 #include "Randomize.hh"
 
 #include "G4Box.hh"
@@ -36,21 +41,19 @@
 #include "G4LogicalVolumeStore.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4ios.hh"
-#include "Randomize.hh"
 
-PrimaryGeneratorAction::PrimaryGeneratorAction(const std::string &hepmcFile)
-    : hepMCReader(hepmcFile)
+#include <fstream>
+#include <mutex>
+
+PrimaryGeneratorAction::PrimaryGeneratorAction(RunAction *runAction, const std::string &hepmcFile)
+    : fHepMCFileName(hepmcFile), fRunAction(runAction)
 {
-    if (hepMCReader.failed())
-    {
-        G4Exception("PrimaryGeneratorAction",
-                    "HEPMC_READER_FAIL",
-                    FatalException,
-                    ("Cannot open HepMC file " + hepmcFile).c_str());
-    }
+    fMessenger = new PrimaryGeneratorMessenger(this);
 
     fPossibleMomenta = {
         0.1 * GeV, 0.15 * GeV, 0.2 * GeV, 0.3 * GeV, 0.5 * GeV, 0.7 * GeV, 1.0 * GeV,
@@ -67,75 +70,180 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(const std::string &hepmcFile)
     fParticleGun->SetParticleDefinition(particleDefinition);
 }
 
+PrimaryGeneratorAction::~PrimaryGeneratorAction()
+{
+    delete fMessenger;
+    delete fParticleGun;
+}
+
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event)
 {
-    // Uniform pseudorapidity in [-3.5, 3.5]
-    G4double eta = -3.5 + 7.0 * G4UniformRand();
-    G4double phi = 2.0 * CLHEP::pi * G4UniformRand();
-    G4double theta = 2.0 * std::atan(std::exp(-eta));
+    // Replaces the seeds the run manager drew for this event, so transport
+    // depends on the event ID rather than on the order events were handed out
+    EventRandom::SeedEngine(GetRunSeed(), event->GetEventID() + RunAction::eventIDOffset);
+
+    if (fMode == "hepmc") {
+        GenerateFromHepMC(event);
+    }
+    else if (fMode == "pythia") {
+        GenerateFromPythia(event);
+    }
+    else {
+        GenerateFromGun(event);
+    }
+}
+
+G4long PrimaryGeneratorAction::GetRunSeed() const
+{
+    return fRunAction ? fRunAction->runSeed : 1;
+}
+
+void PrimaryGeneratorAction::GenerateFromGun(G4Event *event)
+{
+    auto rng = EventRandom::Stream(GetRunSeed(), event->GetEventID() + RunAction::eventIDOffset, EventRandom::kGun);
+
+    // Each particle gets its own vertex and track ID
+    for (G4int i = 0; i < fGunMultiplicity; i++) {
+        // Uniform pseudorapidity in [-3.5, 3.5]
+        G4double eta = -3.5 + 7.0 * rng.Uniform();
+        G4double phi = 2.0 * CLHEP::pi * rng.Uniform();
+        G4double theta = 2.0 * std::atan(std::exp(-eta));
+
+        G4double px = std::sin(theta) * std::cos(phi);
+        G4double py = std::sin(theta) * std::sin(phi);
+        G4double pz = std::cos(theta);
+
+        fParticleGun->SetParticleMomentumDirection(G4ThreeVector(px, py, pz));
+
+        G4double momentum = fGunMomentum > 0. ? fGunMomentum
+                                              : fPossibleMomenta[static_cast<std::size_t>(rng.Uniform() * fPossibleMomenta.size())];
+        fParticleGun->SetParticleMomentum(momentum);
+        fParticleGun->SetParticlePosition(G4ThreeVector(0., 0., 0.));
+        fParticleGun->GeneratePrimaryVertex(event);
+    }
+}
+
+void PrimaryGeneratorAction::GenerateFromHepMC(G4Event *event)
+{
+    // All workers share one reader, so each generator event is only transported once.
+    // Opened at the first event of each run, not every event, as Open locks the source.
+    auto &source = HepMCEventSource::Instance();
+    G4int runID = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+    if (runID != fHepMCRunID) {
+        source.Open(fHepMCFileName, fPrefetch, fHepMCSelection);
+        fHepMCRunID = runID;
+    }
+
+    auto record = source.Next();
+    if (!record) {
+        G4Exception("PrimaryGeneratorAction::GenerateFromHepMC",
+                    "HEPMC_EXHAUSTED",
+                    JustWarning,
+                    ("No events left in " + fHepMCFileName + ", aborting run").c_str());
+        G4RunManager::GetRunManager()->AbortRun(true);
+        return;
+    }
 
-    G4double px = std::sin(theta) * std::cos(phi);
-    G4double py = std::sin(theta) * std::sin(phi);
-    G4double pz = std::cos(theta);
+    AddPrimaries(*record, event);
+}
 
-    fParticleGun->SetParticleMomentumDirection(G4ThreeVector(px, py, pz));
+void PrimaryGeneratorAction::GenerateFromPythia(G4Event *event)
+{
+#ifdef WITH_PYTHIA8
+    // One Pythia per worker thread; re-initialised only when the settings change
+    if (!fPythiaGenerator) {
+        fPythiaGenerator = std::make_unique<PythiaGenerator>();
+    }
+    if (!fPythiaGenerator->IsInitialized(fPythiaSettings)) {
+        fPythiaGenerator->Initialize(fPythiaSettings);
+    }
+
+    // Seeded from the event ID, so the Pythia event belongs to the event and not the thread
+    G4long eventID = event->GetEventID() + RunAction::eventIDOffset;
+    auto rng = EventRandom::Stream(GetRunSeed(), eventID, EventRandom::kPythia);
+    // Pythia takes seeds from 1 to 900000000, 0 would seed it from the clock
+    auto seed = static_cast<G4long>(rng.Next() % 899999999 + 1);
+
+    PrimaryEventRecord record;
+    if (!fPythiaGenerator->Next(seed, record)) {
+        G4Exception("PrimaryGeneratorAction::GenerateFromPythia",
+                    "PYTHIA_EVENT_FAIL",
+                    JustWarning,
+                    "Pythia failed to generate an event, it is left empty");
+        return;
+    }
+    record.eventNumber = eventID;
+
+    AddPrimaries(record, event);
+#else
+    G4Exception("PrimaryGeneratorAction::GenerateFromPythia",
+                "NO_PYTHIA8",
+                FatalException,
+                "Pythia mode needs DetectorSimulation to be configured with -DWITH_PYTHIA8=ON");
+#endif
+}
 
-    G4double momentum = fPossibleMomenta[std::rand() % fPossibleMomenta.size()];
-    fParticleGun->SetParticleMomentum(momentum);
-    fParticleGun->SetParticlePosition(G4ThreeVector(0., 0., 0.));
-    fParticleGun->GeneratePrimaryVertex(event);
-    return;
+void PrimaryGeneratorAction::LoadEventList(const G4String &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in) {
+        G4Exception("PrimaryGeneratorAction::LoadEventList",
+                    "EVENT_LIST_FAIL",
+                    FatalException,
+                    ("Cannot open event list " + fileName).c_str());
+        return;
+    }
 
+    // Whitespace separated HepMC event numbers
+    fHepMCSelection.eventNumbers.clear();
+    G4long eventNumber;
+    while (in >> eventNumber) {
+        fHepMCSelection.eventNumbers.push_back(eventNumber);
+    }
+}
 
-    /* Emit particles from HepMC file
-    G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
-    std::string hepmcFileName = "../electron_proton.hepmc";
-    HepMC3::ReaderAscii hepMCReader("events.hepmc");
+void PrimaryGeneratorAction::BuildHepMCIndex()
+{
+    // Command is broadcast to every worker: the first one builds, the others find it fresh
+    static std::mutex indexMutex;
+    std::lock_guard<std::mutex> lock(indexMutex);
+
+    HepMCIndex index;
+    if (!index.Open(fHepMCFileName)) {
+        G4Exception("PrimaryGeneratorAction::BuildHepMCIndex",
+                    "HEPMC_INDEX_FAIL",
+                    JustWarning,
+                    ("Cannot build index for " + fHepMCFileName).c_str());
+    }
+}
 
-    while (!hepMCReader.failed())
+void PrimaryGeneratorAction::AddPrimaries(const PrimaryEventRecord &record, G4Event *event)
+{
+    for (const auto &vertex : record.vertices)
     {
-        HepMC3::GenEvent hepmcEvent;
-        hepMCReader.read_event(hepmcEvent);
+        auto g4Vertex = new G4PrimaryVertex(vertex.position, vertex.time);
 
-        for (auto vertex : hepmcEvent.vertices())
+        for (const auto &particle : vertex.particles)
         {
-            auto position = vertex->position();
-
-            auto g4Vertex = new G4PrimaryVertex(
-                position.x() * mm,
-                position.y() * mm,
-                position.z() * mm,
-                position.t() * ns);
-
-            for (auto particle : vertex->particles_out())
-            {
-                // HepMC3 status convention: 1 is usually final state
-                if (particle->status() != 1)
-                    continue;
-
-                G4ParticleDefinition *particleDef = particleTable->FindParticle(particle->pid());
-                G4cout << "Emitted " << particleDef->GetParticleName() << " with energy " << particle->momentum().e() << " GeV" << G4endl;
-
-                auto momentum = particle->momentum();
-                auto primary = new G4PrimaryParticle(
-                    particle->pid(),
-                    momentum.px() * GeV,
-                    momentum.py() * GeV,
-                    momentum.pz() * GeV);
-
-                g4Vertex->SetPrimary(primary);
-            }
-
-            // Only keep vertices that actually have primaries
-            if (g4Vertex->GetNumberOfParticle() > 0)
-            {
-                event->AddPrimaryVertex(g4Vertex);
-            }
-            else
-            {
-                delete g4Vertex;
-            }
+            auto decision = fFilter.Apply(particle.pdg, particle.momentum);
+            if (fRunAction)
+                fRunAction->CountPrimary(decision);
+            if (decision != PrimaryFilter::kAccepted)
+                continue;
+
+            auto primary = new G4PrimaryParticle(
+                particle.pdg,
+                particle.momentum.x(),
+                particle.momentum.y(),
+                particle.momentum.z());
+
+            g4Vertex->SetPrimary(primary);
         }
+
+        // Only keep vertices with particles left after the prefilter
+        if (g4Vertex->GetNumberOfParticle() > 0)
+            event->AddPrimaryVertex(g4Vertex);
+        else
+            delete g4Vertex;
     }
-    */  
-}
\ No newline at end of file
+}
@@ -0,0 +1,273 @@
+#include "PrimaryGeneratorMessenger.hh"
+
+#include "PrimaryGeneratorAction.hh"
+
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+PrimaryGeneratorMessenger::PrimaryGeneratorMessenger(PrimaryGeneratorAction *generator)
+    : fPrimaryGenerator(generator)
+{
+    fGeneratorDirectory = new G4UIdirectory("/generator/");
+    fGeneratorDirectory->SetGuidance("Primary generator control");
+
+    fGunDirectory = new G4UIdirectory("/generator/gun/");
+    fGunDirectory->SetGuidance("Particle gun in gun mode");
+
+    fHepMCDirectory = new G4UIdirectory("/generator/hepmc/");
+    fHepMCDirectory->SetGuidance("HepMC3 event input");
+
+    fFilterDirectory = new G4UIdirectory("/generator/filter/");
+    fFilterDirectory->SetGuidance("Kinematic prefilter on generator particles");
+
+    fPythiaDirectory = new G4UIdirectory("/generator/pythia/");
+    fPythiaDirectory->SetGuidance("In-process Pythia8 e+p generator");
+
+    fModeCmd = new G4UIcmdWithAString("/generator/mode", this);
+    fModeCmd->SetGuidance("Select the source of primaries");
+    fModeCmd->SetGuidance("  gun   : particle gun in |eta| < 3.5");
+    fModeCmd->SetGuidance("  hepmc : events from the shared HepMC3 reader");
+    fModeCmd->SetGuidance("  pythia: e+p collisions generated in process by each worker");
+    fModeCmd->SetParameterName("mode", false);
+    fModeCmd->SetCandidates("gun hepmc pythia");
+    fModeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMultiplicityCmd = new G4UIcmdWithAnInteger("/generator/gun/multiplicity", this);
+    fMultiplicityCmd->SetGuidance("Set number of independent gun particles shot per event");
+    fMultiplicityCmd->SetGuidance("Each one gets its own TrackID and row in the tracks ntuple");
+    fMultiplicityCmd->SetParameterName("multiplicity", false);
+    fMultiplicityCmd->SetRange("multiplicity > 0");
+    fMultiplicityCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fGunMomentumCmd = new G4UIcmdWithADoubleAndUnit("/generator/gun/momentum", this);
+    fGunMomentumCmd->SetGuidance("Set a fixed gun momentum (0 picks one of the standard momenta at random)");
+    fGunMomentumCmd->SetParameterName("momentum", false);
+    fGunMomentumCmd->SetUnitCategory("Energy");
+    fGunMomentumCmd->SetRange("momentum >= 0");
+    fGunMomentumCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fHepMCFileCmd = new G4UIcmdWithAString("/generator/hepmc/file", this);
+    fHepMCFileCmd->SetGuidance("Set HepMC3 ASCII input file, or .b8ev/.b8ev.zst binary file from CollisionSimulation");
+    fHepMCFileCmd->SetParameterName("fileName", false);
+    fHepMCFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fPrefetchCmd = new G4UIcmdWithAnInteger("/generator/hepmc/prefetch", this);
+    fPrefetchCmd->SetGuidance("Set number of events parsed ahead of the workers");
+    fPrefetchCmd->SetParameterName("prefetch", false);
+    fPrefetchCmd->SetRange("prefetch > 0");
+    fPrefetchCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fFirstEventCmd = new G4UIcmdWithAnInteger("/generator/hepmc/firstEvent", this);
+    fFirstEventCmd->SetGuidance("Start at the k-th event of the file (counting from 0)");
+    fFirstEventCmd->SetParameterName("firstEvent", false);
+    fFirstEventCmd->SetRange("firstEvent >= 0");
+    fFirstEventCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fStrideCmd = new G4UIcmdWithAnInteger("/generator/hepmc/stride", this);
+    fStrideCmd->SetGuidance("Only read every n-th event of the file");
+    fStrideCmd->SetGuidance("With firstEvent i and stride N, job i of N reads a disjoint share of the file");
+    fStrideCmd->SetParameterName("stride", false);
+    fStrideCmd->SetRange("stride > 0");
+    fStrideCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMaxEventsCmd = new G4UIcmdWithAnInteger("/generator/hepmc/maxEvents", this);
+    fMaxEventsCmd->SetGuidance("Stop after n selected events (-1 for no limit)");
+    fMaxEventsCmd->SetParameterName("maxEvents", false);
+    fMaxEventsCmd->SetRange("maxEvents >= -1");
+    fMaxEventsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMinFinalStateCmd = new G4UIcmdWithAnInteger("/generator/hepmc/minFinalState", this);
+    fMinFinalStateCmd->SetGuidance("Skip events with fewer final state particles, using the index summary");
+    fMinFinalStateCmd->SetParameterName("minFinalState", false);
+    fMinFinalStateCmd->SetRange("minFinalState >= 0");
+    fMinFinalStateCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fEventListCmd = new G4UIcmdWithAString("/generator/hepmc/eventList", this);
+    fEventListCmd->SetGuidance("Only read the HepMC event numbers listed in a text file");
+    fEventListCmd->SetParameterName("fileName", false);
+    fEventListCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fUseIndexCmd = new G4UIcmdWithABool("/generator/hepmc/useIndex", this);
+    fUseIndexCmd->SetGuidance("Read through the byte-offset index even without a selection");
+    fUseIndexCmd->SetParameterName("useIndex", true);
+    fUseIndexCmd->SetDefaultValue(true);
+    fUseIndexCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fBuildIndexCmd = new G4UIcmdWithoutParameter("/generator/hepmc/buildIndex", this);
+    fBuildIndexCmd->SetGuidance("Build the byte-offset index of the HepMC file now if missing or stale");
+    fBuildIndexCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fFilterEnableCmd = new G4UIcmdWithABool("/generator/filter/enable", this);
+    fFilterEnableCmd->SetGuidance("Drop generator particles that fail the prefilter");
+    fFilterEnableCmd->SetParameterName("enable", true);
+    fFilterEnableCmd->SetDefaultValue(true);
+    fFilterEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fEtaRangeCmd = new G4UIcommand("/generator/filter/etaRange", this);
+    fEtaRangeCmd->SetGuidance("Set accepted pseudorapidity range");
+    auto etaMin = new G4UIparameter("etaMin", 'd', false);
+    fEtaRangeCmd->SetParameter(etaMin);
+    auto etaMax = new G4UIparameter("etaMax", 'd', false);
+    fEtaRangeCmd->SetParameter(etaMax);
+    fEtaRangeCmd->SetRange("etaMin < etaMax");
+    fEtaRangeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMinPtCmd = new G4UIcmdWithADoubleAndUnit("/generator/filter/minPt", this);
+    fMinPtCmd->SetGuidance("Set minimum transverse momentum");
+    fMinPtCmd->SetParameterName("minPt", false);
+    fMinPtCmd->SetUnitCategory("Energy");
+    fMinPtCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fChargedOnlyCmd = new G4UIcmdWithABool("/generator/filter/chargedOnly", this);
+    fChargedOnlyCmd->SetGuidance("Drop neutral particles, which cannot leave SVT hits");
+    fChargedOnlyCmd->SetParameterName("chargedOnly", true);
+    fChargedOnlyCmd->SetDefaultValue(true);
+    fChargedOnlyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fAddPDGCmd = new G4UIcmdWithAnInteger("/generator/filter/addPDG", this);
+    fAddPDGCmd->SetGuidance("Add a PDG code to the whitelist (empty whitelist accepts all)");
+    fAddPDGCmd->SetParameterName("pdg", false);
+    fAddPDGCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fClearPDGCmd = new G4UIcmdWithoutParameter("/generator/filter/clearPDG", this);
+    fClearPDGCmd->SetGuidance("Clear the PDG whitelist");
+    fClearPDGCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fProtonEnergyCmd = new G4UIcmdWithADoubleAndUnit("/generator/pythia/protonEnergy", this);
+    fProtonEnergyCmd->SetGuidance("Set proton beam energy");
+    fProtonEnergyCmd->SetParameterName("protonEnergy", false);
+    fProtonEnergyCmd->SetUnitCategory("Energy");
+    fProtonEnergyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fElectronEnergyCmd = new G4UIcmdWithADoubleAndUnit("/generator/pythia/electronEnergy", this);
+    fElectronEnergyCmd->SetGuidance("Set electron beam energy");
+    fElectronEnergyCmd->SetParameterName("electronEnergy", false);
+    fElectronEnergyCmd->SetUnitCategory("Energy");
+    fElectronEnergyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fQ2minCmd = new G4UIcmdWithADouble("/generator/pythia/Q2min", this);
+    fQ2minCmd->SetGuidance("Set minimum Q^2 in GeV^2");
+    fQ2minCmd->SetParameterName("Q2min", false);
+    fQ2minCmd->SetRange("Q2min >= 0");
+    fQ2minCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fReadStringCmd = new G4UIcmdWithAString("/generator/pythia/readString", this);
+    fReadStringCmd->SetGuidance("Pass any other setting to Pythia, e.g. \"HadronLevel:all = off\"");
+    fReadStringCmd->SetParameterName("setting", false);
+    fReadStringCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+PrimaryGeneratorMessenger::~PrimaryGeneratorMessenger()
+{
+    delete fModeCmd;
+    delete fMultiplicityCmd;
+    delete fGunMomentumCmd;
+    delete fHepMCFileCmd;
+    delete fPrefetchCmd;
+    delete fFirstEventCmd;
+    delete fStrideCmd;
+    delete fMaxEventsCmd;
+    delete fMinFinalStateCmd;
+    delete fEventListCmd;
+    delete fUseIndexCmd;
+    delete fBuildIndexCmd;
+    delete fFilterEnableCmd;
+    delete fEtaRangeCmd;
+    delete fMinPtCmd;
+    delete fChargedOnlyCmd;
+    delete fAddPDGCmd;
+    delete fClearPDGCmd;
+    delete fFilterDirectory;
+    delete fProtonEnergyCmd;
+    delete fElectronEnergyCmd;
+    delete fQ2minCmd;
+    delete fReadStringCmd;
+    delete fPythiaDirectory;
+    delete fHepMCDirectory;
+    delete fGunDirectory;
+    delete fGeneratorDirectory;
+}
+
+void PrimaryGeneratorMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+    if (command == fModeCmd) {
+        fPrimaryGenerator->SetMode(newValue);
+    }
+    if (command == fMultiplicityCmd) {
+        fPrimaryGenerator->SetGunMultiplicity(fMultiplicityCmd->GetNewIntValue(newValue));
+    }
+    if (command == fGunMomentumCmd) {
+        fPrimaryGenerator->SetGunMomentum(fGunMomentumCmd->GetNewDoubleValue(newValue));
+    }
+    if (command == fHepMCFileCmd) {
+        fPrimaryGenerator->SetHepMCFileName(newValue);
+    }
+    if (command == fPrefetchCmd) {
+        fPrimaryGenerator->SetPrefetch(fPrefetchCmd->GetNewIntValue(newValue));
+    }
+    if (command == fFirstEventCmd) {
+        fPrimaryGenerator->GetHepMCSelection().firstEvent = fFirstEventCmd->GetNewIntValue(newValue);
+    }
+    if (command == fStrideCmd) {
+        fPrimaryGenerator->GetHepMCSelection().stride = fStrideCmd->GetNewIntValue(newValue);
+    }
+    if (command == fMaxEventsCmd) {
+        fPrimaryGenerator->GetHepMCSelection().maxEvents = fMaxEventsCmd->GetNewIntValue(newValue);
+    }
+    if (command == fMinFinalStateCmd) {
+        fPrimaryGenerator->GetHepMCSelection().minFinalState = fMinFinalStateCmd->GetNewIntValue(newValue);
+    }
+    if (command == fEventListCmd) {
+        fPrimaryGenerator->LoadEventList(newValue);
+    }
+    if (command == fUseIndexCmd) {
+        fPrimaryGenerator->GetHepMCSelection().useIndex = fUseIndexCmd->GetNewBoolValue(newValue);
+    }
+    if (command == fBuildIndexCmd) {
+        fPrimaryGenerator->BuildHepMCIndex();
+    }
+    if (command == fFilterEnableCmd) {
+        fPrimaryGenerator->GetFilter().enabled = fFilterEnableCmd->GetNewBoolValue(newValue);
+    }
+    if (command == fEtaRangeCmd) {
+        std::istringstream is(newValue);
+        auto &filter = fPrimaryGenerator->GetFilter();
+        is >> filter.etaMin >> filter.etaMax;
+    }
+    if (command == fMinPtCmd) {
+        fPrimaryGenerator->GetFilter().minPt = fMinPtCmd->GetNewDoubleValue(newValue);
+    }
+    if (command == fChargedOnlyCmd) {
+        fPrimaryGenerator->GetFilter().chargedOnly = fChargedOnlyCmd->GetNewBoolValue(newValue);
+    }
+    if (command == fAddPDGCmd) {
+        fPrimaryGenerator->GetFilter().pdgWhitelist.insert(fAddPDGCmd->GetNewIntValue(newValue));
+    }
+    if (command == fClearPDGCmd) {
+        fPrimaryGenerator->GetFilter().pdgWhitelist.clear();
+    }
+    if (command == fProtonEnergyCmd) {
+        fPrimaryGenerator->GetPythiaSettings().protonEnergy = fProtonEnergyCmd->GetNewDoubleValue(newValue);
+    }
+    if (command == fElectronEnergyCmd) {
+        fPrimaryGenerator->GetPythiaSettings().electronEnergy = fElectronEnergyCmd->GetNewDoubleValue(newValue);
+    }
+    if (command == fQ2minCmd) {
+        fPrimaryGenerator->GetPythiaSettings().Q2min = fQ2minCmd->GetNewDoubleValue(newValue);
+    }
+    if (command == fReadStringCmd) {
+        G4String setting = newValue;
+        if (setting.size() > 1 && setting.front() == '"' && setting.back() == '"') {
+            setting = setting.substr(1, setting.size() - 2);
+        }
+        fPrimaryGenerator->GetPythiaSettings().extraSettings.push_back(setting);
+    }
+}
@@ -0,0 +1,93 @@
+#include "PythiaGenerator.hh"
+
+#include "G4Exception.hh"
+
+#include "Pythia8/Pythia.h"
+
+PythiaGenerator::PythiaGenerator() = default;
+
+PythiaGenerator::~PythiaGenerator() = default;
+
+void PythiaGenerator::Initialize(const PythiaSettings &settings)
+{
+    // Printing the banner and init summary once per thread would flood the output
+    fPythia = std::make_unique<Pythia8::Pythia>("../share/Pythia8/xmldoc", false);
+    fSettings = settings;
+
+    auto &pythia = *fPythia;
+    pythia.readString("Beams:idA = 2212");      // Proton
+    pythia.readString("Beams:idB = 11");        // Electron
+    pythia.readString("Beams:frameType = 2");   // Lab frame
+    pythia.readString("Beams:eA = " + std::to_string(settings.protonEnergy / GeV));
+    pythia.readString("Beams:eB = " + std::to_string(settings.electronEnergy / GeV));
+    pythia.readString("WeakBosonExchange:ff2ff(t:gmZ) = on");
+    pythia.readString("SpaceShower:dipoleRecoil = on");
+    pythia.readString("PhaseSpace:Q2min = " + std::to_string(settings.Q2min));
+    pythia.readString("Print:quiet = on");
+
+    for (const auto &setting : settings.extraSettings)
+    {
+        if (!pythia.readString(setting))
+        {
+            G4Exception("PythiaGenerator::Initialize",
+                        "PYTHIA_SETTING",
+                        JustWarning,
+                        ("Pythia did not accept setting: " + setting).c_str());
+        }
+    }
+
+    if (!pythia.init())
+    {
+        G4Exception("PythiaGenerator::Initialize",
+                    "PYTHIA_INIT_FAIL",
+                    FatalException,
+                    "Pythia initialisation failed");
+    }
+}
+
+bool PythiaGenerator::Next(G4long seed, PrimaryEventRecord &record)
+{
+    auto &pythia = *fPythia;
+
+    // Pythia accepts seeds up to 900000000
+    pythia.rndm.init(static_cast<int>(seed % 900000000));
+    if (!pythia.next())
+        return false;
+
+    record.eventNumber = fNumGenerated++;
+    record.vertices.clear();
+
+    const auto &event = pythia.event;
+    for (int i = 0; i < event.size(); i++)
+    {
+        const auto &particle = event[i];
+        if (!particle.isFinal())
+            continue;
+
+        // Pythia uses GeV and mm, with time as c*t in mm
+        G4ThreeVector position(particle.xProd() * mm, particle.yProd() * mm, particle.zProd() * mm);
+        G4double time = particle.tProd() * mm / CLHEP::c_light;
+
+        // Almost all particles share the primary interaction point, so a linear
+        // search over the few distinct vertices is enough
+        PrimaryVertexRecord *vertex = nullptr;
+        for (auto &existing : record.vertices)
+        {
+            if (existing.position == position && existing.time == time)
+            {
+                vertex = &existing;
+                break;
+            }
+        }
+        if (!vertex)
+        {
+            record.vertices.push_back({position, time, {}});
+            vertex = &record.vertices.back();
+        }
+
+        vertex->particles.push_back(
+            {particle.id(), G4ThreeVector(particle.px() * GeV, particle.py() * GeV, particle.pz() * GeV)});
+    }
+
+    return true;
+}
@@ -34,14 +34,22 @@
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4AnalysisManager.hh"
+#include "G4AccumulableManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <vector>
 
 // static members defined (thread-local qualifiers must match declaration)
 G4ThreadLocal std::vector<G4double> RunAction::hitPositionX;
 G4ThreadLocal std::vector<G4double> RunAction::hitPositionY;
 G4ThreadLocal std::vector<G4double> RunAction::hitPositionZ;
+G4ThreadLocal std::vector<G4int> RunAction::hitLayerID;
+G4ThreadLocal std::vector<G4int> RunAction::hitDetectorID;
+G4ThreadLocal G4double RunAction::ntupleFillTime = 0.;
 
 RunAction::RunAction()
 {
@@ -55,21 +63,69 @@ RunAction::RunAction()
 
     analysisManager->SetNtupleMerging(true);
     
-    // Each row contains the original particle parameters, and vector of hit positions
+    // Each row contains the original parameters of one primary, and vector of its hit positions
     analysisManager->CreateNtuple("tracks", "Track parameters");
     analysisManager->CreateNtupleDColumn("MomentumX");
     analysisManager->CreateNtupleDColumn("MomentumY");
     analysisManager->CreateNtupleDColumn("MomentumZ");
     analysisManager->CreateNtupleIColumn("ParticleID");
     analysisManager->CreateNtupleIColumn("EventID");
+    analysisManager->CreateNtupleIColumn("TrackID");
     analysisManager->CreateNtupleIColumn("NumHits");
 
     // Vector branches holding hit coordinates for each track
     analysisManager->CreateNtupleDColumn("HitPositionX", hitPositionX);
     analysisManager->CreateNtupleDColumn("HitPositionY", hitPositionY);
     analysisManager->CreateNtupleDColumn("HitPositionZ", hitPositionZ);
+    analysisManager->CreateNtupleIColumn("HitLayerID", hitLayerID);
+    analysisManager->CreateNtupleIColumn("HitDetectorID", hitDetectorID);
 
     analysisManager->FinishNtuple();
+
+    // With /output/reconstruct, one row per fitted primary: the columns of
+    // Reconstruction's fit_tracks, with the same selection
+    analysisManager->CreateNtuple("fits", "Fitted track parameters");
+    analysisManager->CreateNtupleIColumn("EventID");
+    analysisManager->CreateNtupleIColumn("TrackID");
+    analysisManager->CreateNtupleIColumn("ParticleID");
+    analysisManager->CreateNtupleIColumn("NumHits");
+    analysisManager->CreateNtupleDColumn("MomentumX");
+    analysisManager->CreateNtupleDColumn("MomentumY");
+    analysisManager->CreateNtupleDColumn("MomentumZ");
+    analysisManager->CreateNtupleDColumn("TrueP");
+    analysisManager->CreateNtupleDColumn("Eta");
+    analysisManager->CreateNtupleDColumn("FitD0");
+    analysisManager->CreateNtupleDColumn("FitZ0");
+    analysisManager->CreateNtupleDColumn("FitPhi0");
+    analysisManager->CreateNtupleDColumn("FitPT");
+    analysisManager->CreateNtupleDColumn("FitTanl");
+    analysisManager->CreateNtupleDColumn("FitChi2");
+    analysisManager->FinishNtuple();
+
+    // Only the ntuples a run fills are written
+    analysisManager->SetActivation(true);
+
+    // Transverse momentum of the primaries stopped by each stepping rule, with
+    // histogram IDs equal to SteppingAction::Rule
+    for (G4int rule = 0; rule < SteppingAction::kNumRules; rule++) {
+        G4String name = SteppingAction::ruleNames[rule];
+        analysisManager->CreateH1("stopped_" + name, "pT of primaries stopped by " + name,
+                                  100, 0., 2. * GeV, "GeV");
+    }
+
+    auto accumulableManager = G4AccumulableManager::Instance();
+    for (auto &count : fPrimaryCounts) {
+        accumulableManager->Register(count);
+    }
+    accumulableManager->Register(fSecondariesTracked);
+    accumulableManager->Register(fSecondariesKilled);
+    accumulableManager->Register(fPrimaryTracks);
+    accumulableManager->Register(fPrimarySteps);
+    for (auto &count : fStoppedCounts) {
+        accumulableManager->Register(count);
+    }
+    accumulableManager->Register(fNtupleFillTime);
+    accumulableManager->Register(fWorkerWriteTime);
 }
 
 void RunAction::BeginOfRunAction(const G4Run *run)
@@ -77,17 +133,132 @@ void RunAction::BeginOfRunAction(const G4Run *run)
     // inform the runManager to save random number seed
     G4RunManager::GetRunManager()->SetRandomNumberStore(false);
 
+    G4AccumulableManager::Instance()->Reset();
+    ntupleFillTime = 0.;
+
+    if (IsMaster()) {
+        if (sharded && !inCheckpointSegment && run->GetNumberOfEventToBeProcessed() > 0) {
+            G4Exception("RunAction::BeginOfRunAction",
+                        "SHARD_PLAIN_BEAMON",
+                        FatalException,
+                        "With --shard, run events with /checkpoint/beamOn: /run/beamOn is not sliced "
+                        "between the shards and would run every event in each of them");
+        }
+        fTimer.Start();
+    }
+
     auto analysisManager = G4AnalysisManager::Instance();
+    analysisManager->SetNtupleActivation(0, fitter == kNoFit || rawHitFraction > 0.);
+    analysisManager->SetNtupleActivation(1, fitter != kNoFit);
 
     std::string fileName = "output/" + outputFileName;
     analysisManager->OpenFile(fileName);
 }
 
-void RunAction::EndOfRunAction(const G4Run *)
+void RunAction::EndOfRunAction(const G4Run *run)
 {
     auto analysisManager = G4AnalysisManager::Instance();
+
+    // Workers merge their ntuple into the master's on Write. Timed before the
+    // counters are merged, so the time is included in the master's totals.
+    if (!IsMaster()) {
+        auto start = std::chrono::steady_clock::now();
+        analysisManager->Write();
+        analysisManager->CloseFile();
+        fWorkerWriteTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        fNtupleFillTime += ntupleFillTime;
+        G4AccumulableManager::Instance()->Merge();
+        return;
+    }
+
+    G4AccumulableManager::Instance()->Merge();
+    fNtupleFillTime += ntupleFillTime;     // sequential mode fills on the master
+    PrintPrimaryCounts();
+    PrintTransportReport(run);
+    PrintSteppingReport();
+
+    auto start = std::chrono::steady_clock::now();
     analysisManager->Write();
     analysisManager->CloseFile();
+    G4double writeTime = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+    G4cout << " Output written in " << writeTime << " s" << G4endl;
+}
+
+void RunAction::PrintPrimaryCounts() const
+{
+    G4long total = 0;
+    for (const auto &count : fPrimaryCounts) {
+        total += count.GetValue();
+    }
+    // Only the generator paths that apply the prefilter count particles
+    if (total == 0) return;
+
+    G4cout << G4endl
+           << "--------------------- Generator prefilter ---------------------" << G4endl
+           << " Generator particles : " << total << G4endl
+           << " Transported         : " << fPrimaryCounts[PrimaryFilter::kAccepted].GetValue() << G4endl
+           << " Dropped, eta        : " << fPrimaryCounts[PrimaryFilter::kEta].GetValue() << G4endl
+           << " Dropped, pT         : " << fPrimaryCounts[PrimaryFilter::kPt].GetValue() << G4endl
+           << " Dropped, neutral    : " << fPrimaryCounts[PrimaryFilter::kNeutral].GetValue() << G4endl
+           << " Dropped, PDG code   : " << fPrimaryCounts[PrimaryFilter::kPDG].GetValue() << G4endl
+           << "----------------------------------------------------------------" << G4endl;
+}
+
+void RunAction::PrintTransportReport(const G4Run *run)
+{
+    fTimer.Stop();
+    G4int numEvents = run->GetNumberOfEvent();
+    if (numEvents == 0) return;
+
+    // User plus system time of the whole process, so all worker threads are included
+    G4double cpuTime = fTimer.GetUserElapsed() + fTimer.GetSystemElapsed();
+    G4double cpuPerEvent = cpuTime / numEvents;
+    G4double wallTime = fTimer.GetRealElapsed();
+    G4long killed = fSecondariesKilled.GetValue();
+    G4long tracked = fSecondariesTracked.GetValue();
+    G4long primaries = fPrimaryTracks.GetValue();
+
+    G4cout << G4endl
+           << "--------------------- Transport ---------------------" << G4endl
+           << " Events               : " << numEvents << G4endl
+           << " CPU time             : " << cpuTime << " s (" << cpuPerEvent * 1000 << " ms/event)" << G4endl
+           << " Wall time            : " << wallTime << " s (" << numEvents / wallTime << " events/s)" << G4endl
+           << " Steps per primary    : " << (primaries > 0 ? G4double(fPrimarySteps.GetValue()) / primaries : 0.) << G4endl
+           << " Secondaries tracked  : " << tracked << G4endl
+           << " Secondaries killed   : " << killed << G4endl;
+
+    // Time the threads were not computing: waiting on locks, on each other
+    // at the end of the run, or on I/O
+    G4int threads = std::max(1, G4Threading::GetNumberOfRunningWorkerThreads());
+    G4cout << " Threads              : " << threads << G4endl
+           << " CPU utilisation      : " << cpuTime / (wallTime * threads) * 100 << " %" << G4endl
+           << " Ntuple fill          : " << fNtupleFillTime.GetValue() << " s over all threads" << G4endl
+           << " Ntuple merge (end)   : " << fWorkerWriteTime.GetValue() << " s over all threads" << G4endl;
+
+    // A run that kills nothing is the full mode reference for later runs
+    if (killed == 0) {
+        fFullModeCPUPerEvent = cpuPerEvent;
+    }
+    else if (fFullModeCPUPerEvent > 0.) {
+        G4double saved = 1. - cpuPerEvent / fFullModeCPUPerEvent;
+        G4cout << " Full mode reference  : " << fFullModeCPUPerEvent * 1000 << " ms/event" << G4endl
+               << " CPU time saved       : " << saved * 100 << " %" << G4endl;
+    }
+    else {
+        G4cout << " (run with /transport/secondaries full first to compare with the full mode)" << G4endl;
+    }
+    G4cout << "-----------------------------------------------------" << G4endl;
+}
+
+void RunAction::PrintSteppingReport() const
+{
+    G4cout << G4endl
+           << "--------------------- Stepping policy ---------------------" << G4endl;
+    for (G4int rule = 0; rule < SteppingAction::kNumRules; rule++) {
+        G4cout << " Stopped by " << std::setw(10) << std::left << SteppingAction::ruleNames[rule]
+               << ": " << fStoppedCounts[rule].GetValue() << G4endl;
+    }
+    G4cout << "-----------------------------------------------------------" << G4endl;
 }
 
 RunAction::~RunAction()
@@ -26,6 +26,9 @@
 #include "RunActionMessenger.hh"
 #include "RunAction.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADouble.hh"
 #include "G4UIdirectory.hh"
 
 RunActionMessenger::RunActionMessenger(RunAction* runAction)
@@ -34,15 +37,55 @@ RunActionMessenger::RunActionMessenger(RunAction* runAction)
     fFileCmd = new G4UIcmdWithAString("/output/setFileName", this);
     fFileCmd->SetGuidance("Set output file name");
     fFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fTruthHitsCmd = new G4UIcmdWithABool("/output/storeTruthHits", this);
+    fTruthHitsCmd->SetGuidance("Store unsmeared hit positions, to apply the resolution when reading");
+    fTruthHitsCmd->SetGuidance("/det/res is then ignored, see Analysis/fit_tracks.py --resolutions");
+    fTruthHitsCmd->SetParameterName("storeTruthHits", true);
+    fTruthHitsCmd->SetDefaultValue(true);
+    fTruthHitsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fRunSeedCmd = new G4UIcmdWithAnInteger("/random/runSeed", this);
+    fRunSeedCmd->SetGuidance("Set the run seed: every event is seeded from it and its event ID,");
+    fRunSeedCmd->SetGuidance("so it is reproduced whatever the number of threads or processes");
+    fRunSeedCmd->SetParameterName("runSeed", false);
+    fRunSeedCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fReconstructCmd = new G4UIcmdWithAString("/output/reconstruct", this);
+    fReconstructCmd->SetGuidance("Fit the tracks at the end of each event and write their parameters to the fits");
+    fReconstructCmd->SetGuidance("ntuple: helix (Karimaki fit) or kalman (with multiple scattering), none to only");
+    fReconstructCmd->SetGuidance("write the hits. The hits of a track are then kept for /output/rawHitFraction of them");
+    fReconstructCmd->SetParameterName("fitter", false);
+    fReconstructCmd->SetCandidates("none helix kalman");
+    fReconstructCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fRawHitFractionCmd = new G4UIcmdWithADouble("/output/rawHitFraction", this);
+    fRawHitFractionCmd->SetGuidance("Fraction of the fitted tracks that also keep their hits in the tracks ntuple");
+    fRawHitFractionCmd->SetParameterName("fraction", false);
+    fRawHitFractionCmd->SetRange("fraction >= 0 && fraction <= 1");
+    fRawHitFractionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 RunActionMessenger::~RunActionMessenger()
 {
     delete fFileCmd;
+    delete fTruthHitsCmd;
+    delete fRunSeedCmd;
+    delete fReconstructCmd;
+    delete fRawHitFractionCmd;
 }
 
 void RunActionMessenger::SetNewValue(G4UIcommand* command, G4String value)
 {
     if (command == fFileCmd)
         fRunAction->SetOutputFileName(value);
+    if (command == fTruthHitsCmd)
+        fRunAction->SetStoreTruthHits(fTruthHitsCmd->GetNewBoolValue(value));
+    if (command == fRunSeedCmd)
+        fRunAction->SetRunSeed(fRunSeedCmd->GetNewIntValue(value));
+    if (command == fReconstructCmd)
+        fRunAction->SetFitter(value == "helix" ? RunAction::kHelixFit
+                              : value == "kalman" ? RunAction::kKalmanFit : RunAction::kNoFit);
+    if (command == fRawHitFractionCmd)
+        fRunAction->SetRawHitFraction(fRawHitFractionCmd->GetNewDoubleValue(value));
 }
@@ -0,0 +1,142 @@
+#include "ScanDriver.hh"
+
+#include "G4StateManager.hh"
+#include "G4Timer.hh"
+#include "G4UImanager.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+
+const std::vector<ScanDriver::Column> &ScanDriver::KnownColumns()
+{
+    static const std::vector<Column> columns = {
+        {"name", "/output/setFileName {}.root", false},
+        {"events", "", false},
+        {"materialWidth1", "/det/materialWidth1 {}", true},
+        {"materialWidth2", "/det/materialWidth2 {}", true},
+        {"materialWidth3", "/det/materialWidth3 {}", true},
+        {"resolution", "/det/res {} um", false},
+        {"field", "/globalField/setValue 0 0 {} tesla", false},
+        {"particle", "/gun/particle {}", false},
+    };
+    return columns;
+}
+
+G4bool ScanDriver::Load(const G4String &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in) {
+        G4cerr << "ScanDriver: cannot open " << fileName << G4endl;
+        return false;
+    }
+
+    fColumns.clear();
+    fRows.clear();
+
+    std::string line;
+    G4int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream is(line);
+        std::vector<G4String> fields;
+        std::string field;
+        while (is >> field) {
+            fields.push_back(field);
+        }
+        if (fields.empty()) continue;
+
+        // The first line names the columns
+        if (fColumns.empty()) {
+            for (const auto &name : fields) {
+                const Column *column = nullptr;
+                for (const auto &known : KnownColumns()) {
+                    if (known.name == name) column = &known;
+                }
+                if (!column) {
+                    G4cerr << "ScanDriver: unknown column " << name << " in " << fileName << G4endl;
+                    return false;
+                }
+                if (name == "name") fNameColumn = fColumns.size();
+                if (name == "events") fEventsColumn = fColumns.size();
+                fColumns.push_back(column);
+            }
+            if (fNameColumn < 0 || fEventsColumn < 0) {
+                G4cerr << "ScanDriver: " << fileName << " needs name and events columns" << G4endl;
+                return false;
+            }
+            continue;
+        }
+
+        if (fields.size() != fColumns.size()) {
+            G4cerr << "ScanDriver: " << fileName << ":" << lineNumber << " has " << fields.size()
+                   << " values for " << fColumns.size() << " columns" << G4endl;
+            return false;
+        }
+        fRows.push_back(fields);
+    }
+
+    if (fRows.empty()) {
+        G4cerr << "ScanDriver: no configurations in " << fileName << G4endl;
+        return false;
+    }
+    return true;
+}
+
+void ScanDriver::Run()
+{
+    auto stateManager = G4StateManager::GetStateManager();
+    std::vector<G4String> current(fColumns.size());
+
+    G4Timer total;
+    total.Start();
+    for (std::size_t row = 0; row < fRows.size(); row++) {
+        const auto &values = fRows[row];
+        G4cout << G4endl << "Scan configuration " << row + 1 << "/" << fRows.size() << ": "
+               << values[fNameColumn] << G4endl;
+
+        // Only what differs from the previous configuration is applied
+        auto applyChanged = [&](G4bool geometry) {
+            G4bool changed = false;
+            for (std::size_t i = 0; i < fColumns.size(); i++) {
+                const auto &column = *fColumns[i];
+                if (column.geometry != geometry || column.command.empty() || values[i] == current[i]) continue;
+                G4String command = column.command;
+                command.replace(command.find("{}"), 2, values[i]);
+                Apply(command);
+                current[i] = values[i];
+                changed = true;
+            }
+            return changed;
+        };
+
+        // The geometry first, so it is built or rebuilt once with all of it;
+        // the other commands only exist once the kernel is initialised
+        G4bool geometryChanged = applyChanged(true);
+        if (stateManager->GetCurrentState() == G4State_PreInit) {
+            Apply("/run/initialize");
+        }
+        else if (geometryChanged) {
+            Apply("/run/reinitializeGeometry");
+        }
+        applyChanged(false);
+
+        Apply("/run/beamOn " + values[fEventsColumn]);
+    }
+    total.Stop();
+
+    G4cout << G4endl << "Scan of " << fRows.size() << " configurations finished in "
+           << total.GetRealElapsed() << " s" << G4endl;
+}
+
+void ScanDriver::Apply(const G4String &command) const
+{
+    G4int status = G4UImanager::GetUIpointer()->ApplyCommand(command);
+    if (status != 0) {
+        G4Exception("ScanDriver::Apply",
+                    "SCAN_COMMAND",
+                    FatalException,
+                    ("Command failed (status " + std::to_string(status) + "): " + command).c_str());
+    }
+}
@@ -0,0 +1,35 @@
+#include "SensorTileParameterisation.hh"
+
+#include "G4VPhysicalVolume.hh"
+
+#include <algorithm>
+#include <cmath>
+
+SensorTileParameterisation::SensorTileParameterisation(G4double innerRadius, G4double outerRadius,
+                                                       G4double tileWidth, G4double tileLength)
+{
+    // Row by row in y, then along x
+    G4int numColumns = 2 * G4int(std::ceil(outerRadius / tileWidth));
+    G4int numRows = 2 * G4int(std::ceil(outerRadius / tileLength));
+    for (G4int row = 0; row < numRows; row++) {
+        G4double y = (row - numRows / 2 + 0.5) * tileLength;
+        for (G4int column = 0; column < numColumns; column++) {
+            G4double x = (column - numColumns / 2 + 0.5) * tileWidth;
+
+            // Farthest corner inside the outer radius, nearest point outside the inner one
+            G4double farX = std::abs(x) + tileWidth / 2;
+            G4double farY = std::abs(y) + tileLength / 2;
+            G4double nearX = std::max(0., std::abs(x) - tileWidth / 2);
+            G4double nearY = std::max(0., std::abs(y) - tileLength / 2);
+            if (std::hypot(farX, farY) <= outerRadius && std::hypot(nearX, nearY) >= innerRadius) {
+                fPositions.emplace_back(x, y, 0.);
+            }
+        }
+    }
+}
+
+void SensorTileParameterisation::ComputeTransformation(const G4int copyNo, G4VPhysicalVolume *physVol) const
+{
+    physVol->SetTranslation(fPositions[copyNo]);
+    physVol->SetRotation(nullptr);
+}
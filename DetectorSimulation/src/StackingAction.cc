@@ -0,0 +1,27 @@
+#include "StackingAction.hh"
+
+#include "RunAction.hh"
+#include "StackingActionMessenger.hh"
+
+#include "G4Track.hh"
+
+StackingAction::StackingAction(RunAction *runAction) : fRunAction(runAction)
+{
+    fMessenger = new StackingActionMessenger(this);
+}
+
+StackingAction::~StackingAction()
+{
+    delete fMessenger;
+}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track *track)
+{
+    if (track->GetParentID() == 0) return fUrgent;
+
+    G4bool keep = fPolicy == kFull
+        || (fPolicy == kThreshold && track->GetKineticEnergy() > fThreshold);
+
+    fRunAction->CountSecondary(keep);
+    return keep ? fUrgent : fKill;
+}
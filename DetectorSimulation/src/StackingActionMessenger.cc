@@ -0,0 +1,55 @@
+#include "StackingActionMessenger.hh"
+
+#include "StackingAction.hh"
+
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIdirectory.hh"
+
+StackingActionMessenger::StackingActionMessenger(StackingAction *stackingAction)
+    : fStackingAction(stackingAction)
+{
+    fTransportDirectory = new G4UIdirectory("/transport/");
+    fTransportDirectory->SetGuidance("Transport policy for secondaries");
+
+    fPolicyCmd = new G4UIcmdWithAString("/transport/secondaries", this);
+    fPolicyCmd->SetGuidance("Select which secondaries are tracked");
+    fPolicyCmd->SetGuidance("  full     : all of them");
+    fPolicyCmd->SetGuidance("  kill     : none, only primaries are transported");
+    fPolicyCmd->SetGuidance("  threshold: those above /transport/secondaryThreshold");
+    fPolicyCmd->SetParameterName("policy", false);
+    fPolicyCmd->SetCandidates("full kill threshold");
+    fPolicyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fThresholdCmd = new G4UIcmdWithADoubleAndUnit("/transport/secondaryThreshold", this);
+    fThresholdCmd->SetGuidance("Set kinetic energy above which secondaries are tracked in threshold mode");
+    fThresholdCmd->SetParameterName("threshold", false);
+    fThresholdCmd->SetUnitCategory("Energy");
+    fThresholdCmd->SetRange("threshold >= 0");
+    fThresholdCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+StackingActionMessenger::~StackingActionMessenger()
+{
+    delete fPolicyCmd;
+    delete fThresholdCmd;
+    delete fTransportDirectory;
+}
+
+void StackingActionMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+    if (command == fPolicyCmd) {
+        if (newValue == "kill") {
+            fStackingAction->SetPolicy(StackingAction::kKill);
+        }
+        else if (newValue == "threshold") {
+            fStackingAction->SetPolicy(StackingAction::kThreshold);
+        }
+        else {
+            fStackingAction->SetPolicy(StackingAction::kFull);
+        }
+    }
+    if (command == fThresholdCmd) {
+        fStackingAction->SetThreshold(fThresholdCmd->GetNewDoubleValue(newValue));
+    }
+}
@@ -1,13 +1,131 @@
 #include "SteppingAction.hh"
+#include "DetectorConstruction.hh"
+#include "RunAction.hh"
+#include "SteppingActionMessenger.hh"
+
+#include "G4AnalysisManager.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4RunManager.hh"
 #include "G4Step.hh"
 #include "G4Track.hh"
 #include "G4SystemOfUnits.hh"
 
+#include <cmath>
+#include <ctime>
+
+const std::array<const char *, SteppingAction::kNumRules> SteppingAction::ruleNames = {
+    "maxSteps", "envelope", "halfTurns", "inward", "watchdog"
+};
+
+SteppingAction::SteppingAction(RunAction *runAction) : fRunAction(runAction)
+{
+    fMessenger = new SteppingActionMessenger(this);
+}
+
+SteppingAction::~SteppingAction()
+{
+    delete fMessenger;
+}
+
 void SteppingAction::UserSteppingAction(const G4Step* step) {
     G4Track* track = step->GetTrack();
-    // Kill particle after 10000 steps
-    if (track->GetCurrentStepNumber() > 10000) {
-        track->SetTrackStatus(fStopAndKill);
+    G4int stepNumber = track->GetCurrentStepNumber();
+    if (stepNumber == 1) {
+        StartTrack(step);
+    }
+
+    // Kill particle after fMaxSteps steps
+    if (fMaxSteps > 0 && stepNumber > fMaxSteps) {
+        Kill(step, kMaxSteps);
         return;
     }
+
+    // Thread CPU time is checked every 100 steps, which is cheap enough
+    if (fEventTimeLimit > 0. && (fEventTimedOut || stepNumber % 100 == 0)) {
+        if (fEventTimedOut || ThreadCPUTime() - fEventStartTime > fEventTimeLimit) {
+            fEventTimedOut = true;
+            Kill(step, kWatchdog);
+            return;
+        }
+    }
+
+    const G4ThreeVector &position = step->GetPostStepPoint()->GetPosition();
+
+    if (fEnvelope) {
+        auto detConstruction = static_cast<const DetectorConstruction*>(
+            G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+        if (position.perp() > detConstruction->GetEnvelopeRadius()
+            || std::abs(position.z()) > detConstruction->GetEnvelopeHalfLength()) {
+            Kill(step, kEnvelope);
+            return;
+        }
+    }
+
+    if (track->GetDefinition()->GetPDGCharge() == 0.) return;
+
+    if (fMaxHalfTurns > 0) {
+        // Total turning angle of the momentum in the transverse plane
+        G4double phi = step->GetPostStepPoint()->GetMomentumDirection().phi();
+        G4double dPhi = std::remainder(phi - fLastPhi, 2 * CLHEP::pi);
+        fTurnAngle += std::abs(dPhi);
+        fLastPhi = phi;
+        if (fTurnAngle > fMaxHalfTurns * CLHEP::pi) {
+            Kill(step, kHalfTurns);
+            return;
+        }
+    }
+
+    if (fKillInward) {
+        // A track that went outwards and is now heading back towards the beam axis
+        G4double radius = position.perp();
+        fMaxRadius = std::max(fMaxRadius, radius);
+        const G4ThreeVector &direction = step->GetPostStepPoint()->GetMomentumDirection();
+        G4bool inward = position.x() * direction.x() + position.y() * direction.y() < 0.;
+        G4double tolerance = 1 * mm;
+        if (inward && fMaxRadius > fStartRadius + tolerance && radius < fMaxRadius - tolerance) {
+            Kill(step, kInward);
+            return;
+        }
+    }
+}
+
+void SteppingAction::StartTrack(const G4Step *step)
+{
+    const auto preStepPoint = step->GetPreStepPoint();
+    fTurnAngle = 0.;
+    fLastPhi = preStepPoint->GetMomentumDirection().phi();
+    fStartRadius = preStepPoint->GetPosition().perp();
+    fMaxRadius = fStartRadius;
+
+    if (fEventTimeLimit > 0.) {
+        G4int eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+        if (eventID != fEventID) {
+            fEventID = eventID;
+            fEventStartTime = ThreadCPUTime();
+            fEventTimedOut = false;
+        }
+    }
+}
+
+void SteppingAction::Kill(const G4Step *step, Rule rule)
+{
+    G4Track* track = step->GetTrack();
+    track->SetTrackStatus(fStopAndKill);
+
+    fRunAction->CountStopped(rule);
+    if (track->GetParentID() == 0) {
+        G4double mass = track->GetDefinition()->GetPDGMass();
+        G4double kineticEnergy = track->GetVertexKineticEnergy();
+        G4double momentum = std::sqrt(kineticEnergy * (kineticEnergy + 2 * mass));
+        G4double pT = momentum * track->GetVertexMomentumDirection().perp();
+        G4AnalysisManager::Instance()->FillH1(rule, pT);
+    }
+}
+
+G4double SteppingAction::ThreadCPUTime()
+{
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * s + time.tv_nsec * ns;
 }
@@ -0,0 +1,76 @@
+#include "SteppingActionMessenger.hh"
+
+#include "SteppingAction.hh"
+
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIdirectory.hh"
+
+SteppingActionMessenger::SteppingActionMessenger(SteppingAction *steppingAction)
+    : fSteppingAction(steppingAction)
+{
+    fSteppingDirectory = new G4UIdirectory("/stepping/");
+    fSteppingDirectory->SetGuidance("Track termination policy");
+
+    fMaxStepsCmd = new G4UIcmdWithAnInteger("/stepping/maxSteps", this);
+    fMaxStepsCmd->SetGuidance("Kill tracks after n steps (0 disables)");
+    fMaxStepsCmd->SetParameterName("maxSteps", false);
+    fMaxStepsCmd->SetRange("maxSteps >= 0");
+    fMaxStepsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fEnvelopeCmd = new G4UIcmdWithABool("/stepping/envelope", this);
+    fEnvelopeCmd->SetGuidance("Kill tracks once they leave the cylinder enclosing the SVT");
+    fEnvelopeCmd->SetParameterName("envelope", true);
+    fEnvelopeCmd->SetDefaultValue(true);
+    fEnvelopeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fMaxHalfTurnsCmd = new G4UIcmdWithAnInteger("/stepping/maxHalfTurns", this);
+    fMaxHalfTurnsCmd->SetGuidance("Kill charged tracks after n half-turns in the transverse plane (0 disables)");
+    fMaxHalfTurnsCmd->SetParameterName("maxHalfTurns", false);
+    fMaxHalfTurnsCmd->SetRange("maxHalfTurns >= 0");
+    fMaxHalfTurnsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fKillInwardCmd = new G4UIcmdWithABool("/stepping/killInward", this);
+    fKillInwardCmd->SetGuidance("Kill charged tracks once they spiral back towards the beam axis");
+    fKillInwardCmd->SetParameterName("killInward", true);
+    fKillInwardCmd->SetDefaultValue(true);
+    fKillInwardCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+    fEventTimeLimitCmd = new G4UIcmdWithADoubleAndUnit("/stepping/eventTimeLimit", this);
+    fEventTimeLimitCmd->SetGuidance("Kill the remaining tracks of an event after this thread CPU time (0 disables)");
+    fEventTimeLimitCmd->SetParameterName("eventTimeLimit", false);
+    fEventTimeLimitCmd->SetUnitCategory("Time");
+    fEventTimeLimitCmd->SetDefaultUnit("s");
+    fEventTimeLimitCmd->SetRange("eventTimeLimit >= 0");
+    fEventTimeLimitCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+SteppingActionMessenger::~SteppingActionMessenger()
+{
+    delete fMaxStepsCmd;
+    delete fEnvelopeCmd;
+    delete fMaxHalfTurnsCmd;
+    delete fKillInwardCmd;
+    delete fEventTimeLimitCmd;
+    delete fSteppingDirectory;
+}
+
+void SteppingActionMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+    if (command == fMaxStepsCmd) {
+        fSteppingAction->SetMaxSteps(fMaxStepsCmd->GetNewIntValue(newValue));
+    }
+    if (command == fEnvelopeCmd) {
+        fSteppingAction->SetEnvelope(fEnvelopeCmd->GetNewBoolValue(newValue));
+    }
+    if (command == fMaxHalfTurnsCmd) {
+        fSteppingAction->SetMaxHalfTurns(fMaxHalfTurnsCmd->GetNewIntValue(newValue));
+    }
+    if (command == fKillInwardCmd) {
+        fSteppingAction->SetKillInward(fKillInwardCmd->GetNewBoolValue(newValue));
+    }
+    if (command == fEventTimeLimitCmd) {
+        fSteppingAction->SetEventTimeLimit(fEventTimeLimitCmd->GetNewDoubleValue(newValue));
+    }
+}
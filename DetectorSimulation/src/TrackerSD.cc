@@ -31,19 +31,28 @@
 #include "EventAction.hh"
 #include "RunAction.hh"
 #include "DetectorConstruction.hh"
+#include "DetectorID.hh"
+#include "EventRandom.hh"
+#include "HelixFit.hh"
+#include "KalmanFit.hh"
 
-#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <vector>
 
-#include "Randomize.hh"
-
 #include "G4RunManager.hh"
 #include "G4EventManager.hh"
 #include "G4AnalysisManager.hh"
+#include "G4FieldManager.hh"
+#include "G4Field.hh"
+#include "G4ParticleTable.hh"
+#include "G4TransportationManager.hh"
 #include "G4HCofThisEvent.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
 #include "G4ThreeVector.hh"
+#include "G4VTouchable.hh"
 #include "G4ios.hh"
 #include "G4SystemOfUnits.hh"
 
@@ -58,7 +67,13 @@ void TrackerSD::Initialize(G4HCofThisEvent *hce)
     fHitsCollection = new TrackerHitsCollection(SensitiveDetectorName, collectionName[0]);
     G4int hcID = G4SDManager::GetSDMpointer()->GetCollectionID(collectionName[0]);
     hce->AddHitsCollection(hcID, fHitsCollection);
-    fEventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+    fEventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID() + RunAction::eventIDOffset;
+
+    auto runAction = static_cast<const RunAction*>(G4RunManager::GetRunManager()->GetUserRunAction());
+    G4long runSeed = runAction ? runAction->runSeed : 1;
+    fEfficiencyRNG = EventRandom::Stream(runSeed, fEventID, EventRandom::kEfficiency);
+    fSmearingRNG = EventRandom::Stream(runSeed, fEventID, EventRandom::kSmearing);
+    fRawHitRNG = EventRandom::Stream(runSeed, fEventID, EventRandom::kRawHits);
 }
 
 G4bool TrackerSD::ProcessHits(G4Step *step, G4TouchableHistory *)
@@ -68,8 +83,35 @@ G4bool TrackerSD::ProcessHits(G4Step *step, G4TouchableHistory *)
         return false; // Discard secondary particles
     }
 
-    // Simulate minimum energy threshold of couple hundred e-h pairs
+    G4int detectorID = track->GetVolume()->GetCopyNo();
+    G4ThreeVector position = step->GetPostStepPoint()->GetPosition();
+    G4ThreeVector momentum = step->GetPostStepPoint()->GetMomentum();
     double edep = step->GetTotalEnergyDeposit();
+
+    if (fStaveIDs) {
+        // The layer volume is the world's daughter; barrel staves are the sector replicas inside it
+        auto touchable = step->GetPreStepPoint()->GetTouchable();
+        G4int levels = touchable->GetHistoryDepth() - 1;
+        G4int stave = levels > 1 ? touchable->GetReplicaNumber(levels - 1) : 0;
+        detectorID = DetectorID::Pack(touchable->GetCopyNumber(levels), stave, touchable->GetReplicaNumber(0));
+    }
+
+    if (!fMergedSurfaces.empty()) {
+        // The step ends outside the layer when it leaves it, so take the layer from the pre-step point
+        auto preStepPoint = step->GetPreStepPoint();
+        detectorID = preStepPoint->GetTouchable()->GetCopyNumber();
+
+        G4double fraction, siliconFraction;
+        if (!FindMergedCrossing(step, detectorID, fraction, siliconFraction)) {
+            return false;
+        }
+        position = preStepPoint->GetPosition() + fraction * step->GetDeltaPosition();
+        momentum = preStepPoint->GetMomentum()
+                   + fraction * (step->GetPostStepPoint()->GetMomentum() - preStepPoint->GetMomentum());
+        edep *= siliconFraction;
+    }
+
+    // Simulate minimum energy threshold of couple hundred e-h pairs
     double threshold = 1 * keV;
     if (edep < threshold) {
         return false;
@@ -77,7 +119,7 @@ G4bool TrackerSD::ProcessHits(G4Step *step, G4TouchableHistory *)
 
     // Simulate missed hits due to detector inefficiencies
     double efficiency = 0.99; 
-    if (G4UniformRand() > efficiency) {
+    if (fEfficiencyRNG.Uniform() > efficiency) {
         return false;
     }
 
@@ -85,11 +127,11 @@ G4bool TrackerSD::ProcessHits(G4Step *step, G4TouchableHistory *)
     hit->trackID = track->GetTrackID();
     hit->eventID = fEventID;
     hit->pdg = track->GetParticleDefinition()->GetPDGEncoding();
-    hit->detectorID = track->GetVolume()->GetCopyNo();
+    hit->detectorID = detectorID;
     hit->time = track->GetGlobalTime();
     hit->edep = edep;
-    hit->pos = step->GetPostStepPoint()->GetPosition();
-    hit->momentum = step->GetPostStepPoint()->GetMomentum();
+    hit->pos = position;
+    hit->momentum = momentum;
 
     fHitsCollection->insert(hit);
 
@@ -100,34 +142,178 @@ void TrackerSD::EndOfEvent(G4HCofThisEvent *)
 {
     auto analysisManager = G4AnalysisManager::Instance();
 
-    RunAction::hitPositionX.clear();
-    RunAction::hitPositionY.clear();
-    RunAction::hitPositionZ.clear();
-
-    std::size_t numHits = fHitsCollection->entries();
-    for (std::size_t i = 0; i < numHits; i++) {
-        auto hit = (*fHitsCollection)[i];
-        G4ThreeVector smearedPos = GetSmearedPosition(*hit);
-        RunAction::hitPositionX.push_back(smearedPos.x());
-        RunAction::hitPositionY.push_back(smearedPos.y());
-        RunAction::hitPositionZ.push_back(smearedPos.z());
-    }
-
     // Retrieve stored track metadata from event action
     auto eventAction = static_cast<EventAction*>(
         G4EventManager::GetEventManager()->GetUserEventAction());
-    if (eventAction) {
-        const TrackInfo &info = eventAction->trackInfo;
+    if (!eventAction) return;
+
+    auto runAction = static_cast<const RunAction*>(G4RunManager::GetRunManager()->GetUserRunAction());
+    G4bool storeTruthHits = runAction && runAction->storeTruthHits;
+    G4bool reconstruct = runAction && runAction->fitter != RunAction::kNoFit;
+
+    // Group hits by primary: hits are only made by primaries, and sorting
+    // keeps each track's hits in the order they were recorded
+    std::vector<const TrackerHit*> hits(fHitsCollection->GetVector()->begin(),
+                                        fHitsCollection->GetVector()->end());
+    std::stable_sort(hits.begin(), hits.end(), [](const TrackerHit *a, const TrackerHit *b) {
+        return a->trackID < b->trackID;
+    });
+
+    // One row per primary, including primaries that left no hits
+    auto hit = hits.begin();
+    for (const auto &[trackID, info] : eventAction->primaries) {
+        RunAction::hitPositionX.clear();
+        RunAction::hitPositionY.clear();
+        RunAction::hitPositionZ.clear();
+        RunAction::hitLayerID.clear();
+        RunAction::hitDetectorID.clear();
+        fFitX.clear();
+        fFitY.clear();
+        fFitZ.clear();
+        fFitLayerIDs.clear();
+
+        while (hit != hits.end() && (*hit)->trackID < trackID) ++hit;
+        for (; hit != hits.end() && (*hit)->trackID == trackID; ++hit) {
+            G4ThreeVector pos = storeTruthHits ? (*hit)->pos : GetSmearedPosition(**hit);
+            RunAction::hitPositionX.push_back(pos.x());
+            RunAction::hitPositionY.push_back(pos.y());
+            RunAction::hitPositionZ.push_back(pos.z());
+            RunAction::hitLayerID.push_back(DetectorID::Layer((*hit)->detectorID));
+            RunAction::hitDetectorID.push_back((*hit)->detectorID);
+
+            // The fit always sees the hits as measured
+            if (reconstruct) {
+                G4ThreeVector measured = storeTruthHits ? GetSmearedPosition(**hit) : pos;
+                fFitX.push_back(measured.x());
+                fFitY.push_back(measured.y());
+                fFitZ.push_back(measured.z());
+                fFitLayerIDs.push_back(DetectorID::Layer((*hit)->detectorID));
+            }
+        }
+
+        if (reconstruct) {
+            FillFit(*runAction, info);
+            // Drawn for every primary, so which ones keep their hits depends
+            // only on the event
+            if (!(fRawHitRNG.Uniform() < runAction->rawHitFraction)) continue;
+        }
+
         analysisManager->FillNtupleDColumn(0, 0, info.momentum.x());
         analysisManager->FillNtupleDColumn(0, 1, info.momentum.y());
         analysisManager->FillNtupleDColumn(0, 2, info.momentum.z());
         analysisManager->FillNtupleIColumn(0, 3, info.pdg);
         analysisManager->FillNtupleIColumn(0, 4, info.eventID);
-        analysisManager->FillNtupleIColumn(0, 5, numHits);
+        analysisManager->FillNtupleIColumn(0, 5, info.trackID);
+        analysisManager->FillNtupleIColumn(0, 6, RunAction::hitPositionX.size());
+        // Rows are handed to the master's ntuple when a basket fills, under a
+        // lock, so this is where ntuple merging shows up in the event loop
+        auto start = std::chrono::steady_clock::now();
         analysisManager->AddNtupleRow(0);
+        RunAction::ntupleFillTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
     }
 }
 
+void TrackerSD::FillFit(const RunAction &runAction, const TrackInfo &info)
+{
+    // Same selection as Reconstruction's fit_tracks
+    constexpr std::size_t kMinHitsPerTrack = 4;
+    constexpr G4double kCutoffMomentum = 50 * GeV;
+    std::size_t numHits = fFitX.size();
+    if (numHits < kMinHitsPerTrack) return;
+
+    // Field at the origin, inside the solenoid
+    G4double B = 0.;
+    auto fieldManager = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+    if (auto field = fieldManager->GetDetectorField()) {
+        const G4double origin[4] = {0., 0., 0., 0.};
+        G4double value[6] = {};
+        field->GetFieldValue(origin, value);
+        B = value[2] / tesla;
+    }
+
+    HelixFit::Parameters p;
+    G4double chi2 = 0.;
+    if (runAction.fitter == RunAction::kKalmanFit) {
+        auto detConstruction = static_cast<const DetectorConstruction*>(
+            G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+        // Geometry and material can change between runs, so built per event
+        auto material = KalmanFit::SVTMaterial(detConstruction->GetMaterialWidth1(),
+                                               detConstruction->GetMaterialWidth2(),
+                                               detConstruction->GetMaterialWidth3());
+        KalmanFit::Options options;
+        options.B = B;
+        options.resolution = detConstruction->GetResolution() / mm;
+        auto particle = G4ParticleTable::GetParticleTable()->FindParticle(info.pdg);
+        if (particle) options.mass = particle->GetPDGMass() / MeV;
+        chi2 = KalmanFit::Fit(material, options, numHits, fFitX.data(), fFitY.data(), fFitZ.data(),
+                              fFitLayerIDs.data(), p);
+    }
+    else {
+        p = HelixFit::Fit(B, numHits, fFitX.data(), fFitY.data(), fFitZ.data());
+    }
+    // NaN momenta are kept, as in fit_tracks
+    if (std::hypot(p.pT, p.tanl * p.pT) * MeV > kCutoffMomentum) return;
+
+    auto analysisManager = G4AnalysisManager::Instance();
+    G4double trueP = info.momentum.mag();
+    analysisManager->FillNtupleIColumn(1, 0, info.eventID);
+    analysisManager->FillNtupleIColumn(1, 1, info.trackID);
+    analysisManager->FillNtupleIColumn(1, 2, info.pdg);
+    analysisManager->FillNtupleIColumn(1, 3, numHits);
+    analysisManager->FillNtupleDColumn(1, 4, info.momentum.x());
+    analysisManager->FillNtupleDColumn(1, 5, info.momentum.y());
+    analysisManager->FillNtupleDColumn(1, 6, info.momentum.z());
+    analysisManager->FillNtupleDColumn(1, 7, trueP);
+    analysisManager->FillNtupleDColumn(1, 8, std::atanh(info.momentum.z() / trueP));
+    analysisManager->FillNtupleDColumn(1, 9, p.d0);
+    analysisManager->FillNtupleDColumn(1, 10, p.z0);
+    analysisManager->FillNtupleDColumn(1, 11, p.phi0);
+    analysisManager->FillNtupleDColumn(1, 12, p.pT);
+    analysisManager->FillNtupleDColumn(1, 13, p.tanl);
+    analysisManager->FillNtupleDColumn(1, 14, chi2);
+    auto start = std::chrono::steady_clock::now();
+    analysisManager->AddNtupleRow(1);
+    RunAction::ntupleFillTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TrackerSD::SetMergedLayers(const std::vector<G4double> &barrelRadii,
+                                const std::vector<G4double> &discZPositions, G4double siWidth)
+{
+    fMergedSurfaces = barrelRadii;
+    fMergedSurfaces.insert(fMergedSurfaces.end(), discZPositions.begin(), discZPositions.end());
+    fNumBarrels = barrelRadii.size();
+    fSiWidth = siWidth;
+}
+
+G4bool TrackerSD::FindMergedCrossing(const G4Step *step, G4int detectorID, G4double &fraction,
+                                     G4double &siliconFraction) const
+{
+    if (detectorID < 0 || detectorID >= G4int(fMergedSurfaces.size())) {
+        return false;
+    }
+
+    // Coordinate normal to the layer: radius for barrels, z for discs
+    const auto &pre = step->GetPreStepPoint()->GetPosition();
+    const auto &post = step->GetPostStepPoint()->GetPosition();
+    G4bool barrel = detectorID < fNumBarrels;
+    G4double a = barrel ? pre.perp() : pre.z();
+    G4double b = barrel ? post.perp() : post.z();
+    if (a == b) {
+        return false;
+    }
+
+    // Exit surface of the silicon in the direction of travel
+    G4double surface = fMergedSurfaces[detectorID] + (b > a ? fSiWidth / 2 : -fSiWidth / 2);
+    if ((a < surface) == (b < surface)) {
+        return false;
+    }
+    fraction = (surface - a) / (b - a);
+
+    // Part of the step's deposit that would be in the silicon
+    siliconFraction = std::min(1., fSiWidth / std::abs(b - a));
+    return true;
+}
+
 G4ThreeVector TrackerSD::GetSmearedPosition(const TrackerHit& hit)
 {
     auto detConstruction = static_cast<const DetectorConstruction*>(
@@ -135,17 +321,17 @@ G4ThreeVector TrackerSD::GetSmearedPosition(const TrackerHit& hit)
     
     G4double resolution = detConstruction->GetResolution();
     // Barrel
-    if (hit.detectorID < 5) {
+    if (DetectorID::Layer(hit.detectorID) < 5) {
         double radius = hit.pos.perp();
         double phi = hit.pos.phi();
-        double smearedZ = hit.pos.z() + G4RandGauss::shoot(0, resolution);
-        double smearedPhi = phi + G4RandGauss::shoot(0, resolution / radius);
+        double smearedZ = hit.pos.z() + fSmearingRNG.Gauss(0, resolution);
+        double smearedPhi = phi + fSmearingRNG.Gauss(0, resolution / radius);
         return G4ThreeVector(radius * std::cos(smearedPhi), radius * std::sin(smearedPhi), smearedZ);
     } 
     // Discs
     else { 
-        double smearedX = hit.pos.x() + G4RandGauss::shoot(0, resolution);
-        double smearedY = hit.pos.y() + G4RandGauss::shoot(0, resolution);
+        double smearedX = hit.pos.x() + fSmearingRNG.Gauss(0, resolution);
+        double smearedY = hit.pos.y() + fSmearingRNG.Gauss(0, resolution);
         return G4ThreeVector(smearedX, smearedY, hit.pos.z());
     }
 }
\ No newline at end of file
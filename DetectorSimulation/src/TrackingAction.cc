@@ -24,6 +24,7 @@
 
 #include "TrackingAction.hh"
 #include "EventAction.hh"
+#include "RunAction.hh"
 
 #include "G4UserTrackingAction.hh"
 #include "G4AnalysisManager.hh"
@@ -37,14 +38,23 @@ void TrackingAction::PreUserTrackingAction(const G4Track* track)
 
     // gather initial parameters for this primary track
     TrackInfo info;
-    info.eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+    info.eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID() + RunAction::eventIDOffset;
     info.momentum = track->GetMomentum();
     info.pdg = track->GetDynamicParticle()->GetPDGcode();
+    info.trackID = track->GetTrackID();
 
     // hand the information off to the event action for later filling
     auto eventAction = static_cast<EventAction*>(
         G4EventManager::GetEventManager()->GetUserEventAction());
     if (eventAction) {
-        eventAction->trackInfo = info;
+        eventAction->primaries[info.trackID] = info;
     }
 }
+
+void TrackingAction::PostUserTrackingAction(const G4Track* track)
+{
+    if (track->GetParentID() != 0) return;
+
+    // steps per primary, the cost of field propagation and of the stepping policy
+    fRunAction->CountPrimarySteps(track->GetCurrentStepNumber());
+}
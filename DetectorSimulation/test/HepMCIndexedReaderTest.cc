@@ -0,0 +1,149 @@
+// Events read through the HepMC3 index (HepMCIndexedReader) must be the ones
+// a sequential ReaderAscii gives, run info included: tools, weight names and
+// run attributes from the file header, and the named weights of each event.
+//
+// Usage: HepMCIndexedReaderTest   (run by ctest; returns 1 on any difference)
+
+#include "HepMCIndex.hh"
+#include "HepMCIndexedReader.hh"
+
+#include "HepMC3/Attribute.h"
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenRunInfo.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/ReaderAscii.h"
+#include "HepMC3/WriterAscii.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int gFailures = 0;
+
+template <typename T>
+void Check(const T &indexed, const T &sequential, const std::string &what)
+{
+    if (indexed == sequential)
+        return;
+    std::cerr << "FAIL: " << what << " differs between indexed and sequential reads" << std::endl;
+    gFailures++;
+}
+
+std::vector<std::string> ToolNames(const HepMC3::GenRunInfo &runInfo)
+{
+    std::vector<std::string> names;
+    for (const auto &tool : runInfo.tools())
+        names.push_back(tool.name + " " + tool.version + " " + tool.description);
+    return names;
+}
+
+void CompareRunInfo(const HepMC3::GenRunInfo &indexed, const HepMC3::GenRunInfo &sequential,
+                    const std::string &what)
+{
+    Check(indexed.weight_names(), sequential.weight_names(), what + " weight names");
+    Check(ToolNames(indexed), ToolNames(sequential), what + " tools");
+    Check(indexed.attribute_as_string("seed"), sequential.attribute_as_string("seed"), what + " seed attribute");
+}
+
+void WriteFile(const std::string &fileName, int numEvents)
+{
+    auto runInfo = std::make_shared<HepMC3::GenRunInfo>();
+    runInfo->set_weight_names({"nominal", "muR2", "muR0.5"});
+    runInfo->tools().push_back({"HepMCIndexedReaderTest", "1.0", "indexed read test"});
+    runInfo->add_attribute("seed", std::make_shared<HepMC3::IntAttribute>(42));
+
+    HepMC3::WriterAscii writer(fileName, runInfo);
+    for (int i = 0; i < numEvents; i++)
+    {
+        HepMC3::GenEvent event(runInfo, HepMC3::Units::GEV, HepMC3::Units::MM);
+        event.set_event_number(100 + i);
+        auto vertex = std::make_shared<HepMC3::GenVertex>(HepMC3::FourVector(0., 0., 0.1 * i, 0.));
+        vertex->add_particle_in(std::make_shared<HepMC3::GenParticle>(HepMC3::FourVector(0., 0., 18., 18.), 11, 4));
+        for (int j = 0; j <= i; j++)
+        {
+            vertex->add_particle_out(
+                std::make_shared<HepMC3::GenParticle>(HepMC3::FourVector(0.1 * j, 0.2, 1., 1.1), 211, 1));
+        }
+        event.add_vertex(vertex);
+        event.weights() = {1. + i, 2. + i, 0.5 + i};
+        writer.write_event(event);
+    }
+    writer.close();
+}
+
+}
+
+int main()
+{
+    constexpr int kNumEvents = 6;
+    std::string fileName = (std::filesystem::temp_directory_path() / "HepMCIndexedReaderTest.hepmc").string();
+    WriteFile(fileName, kNumEvents);
+
+    std::vector<std::shared_ptr<HepMC3::GenEvent>> sequential;
+    HepMC3::ReaderAscii sequentialReader(fileName);
+    for (;;)
+    {
+        auto event = std::make_shared<HepMC3::GenEvent>();
+        if (!sequentialReader.read_event(*event) || sequentialReader.failed())
+            break;
+        sequential.push_back(event);
+    }
+    sequentialReader.close();
+    Check<std::size_t>(sequential.size(), kNumEvents, "number of sequential events");
+
+    HepMCIndex index;
+    if (!index.Open(fileName))
+    {
+        std::cerr << "FAIL: cannot index " << fileName << std::endl;
+        return 1;
+    }
+    Check<std::size_t>(index.Size(), sequential.size(), "number of indexed events");
+
+    // Out of order and starting past the first event, as a selection would
+    HepMCIndexedReader indexedReader(index);
+    CompareRunInfo(*indexedReader.GetRunInfo(), *sequentialReader.run_info(), "run info");
+    for (std::size_t position : {3, 0, 5, 1, 4, 2})
+    {
+        if (position >= sequential.size())
+            continue;
+        const auto &expected = *sequential[position];
+        std::string what = "event " + std::to_string(position);
+
+        HepMC3::GenEvent event;
+        if (!indexedReader.Read(position, event))
+        {
+            std::cerr << "FAIL: cannot read " << what << " through the index" << std::endl;
+            gFailures++;
+            continue;
+        }
+        Check(event.event_number(), expected.event_number(), what + " number");
+        Check(event.particles().size(), expected.particles().size(), what + " particles");
+        Check(event.weights(), expected.weights(), what + " weights");
+        if (!event.run_info())
+        {
+            std::cerr << "FAIL: " << what << " has no run info" << std::endl;
+            gFailures++;
+            continue;
+        }
+        CompareRunInfo(*event.run_info(), *expected.run_info(), what);
+        if (event.run_info()->weight_names() != expected.run_info()->weight_names())
+            continue;
+        for (const auto &name : expected.run_info()->weight_names())
+            Check(event.weight(name), expected.weight(name), what + " weight " + name);
+    }
+
+    std::remove(HepMCIndex::IndexFileName(fileName).c_str());
+    std::remove(fileName.c_str());
+
+    if (gFailures > 0)
+        return 1;
+    std::cout << "HepMCIndexedReaderTest: " << kNumEvents << " events identical through the index" << std::endl;
+    return 0;
+}
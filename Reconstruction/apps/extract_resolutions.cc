@@ -0,0 +1,257 @@
+// Track parameter resolutions of fitted tracks, for the plots of
+// Analysis/tracking_performance.ipynb.
+//
+// Usage: extract_resolutions [-j threads] [--eta-edges e0,e1,...]... [--p-edges p0,p1,... (MeV)] [--by-hits]
+//                            [--bootstrap n] [--seed n] -o <table.csv> [name=]<fits>[,<fits>...]...
+//   e.g. extract_resolutions -o Analysis/output/resolutions.csv default=Analysis/output/default.csv
+//                            material_x2=DetectorSimulation/output/material_x2_fits.root
+//
+// Each configuration is one or more files of fitted tracks: the fits tree of
+// fit_tracks or of a /output/reconstruct run (.root, read with RDataFrame if
+// built with ROOT), or a CSV of fit_tracks.py. Without a name it is named
+// after its first file. Every file is read once, and the residuals collected
+// by (eta bin, true momentum, NumHits) on -j threads (default: one per core).
+//
+// --eta-edges gives a set of eta bins and can be repeated; by default the
+// bins of the notebook, -3, -1, 1, 3 and every 0.5 from -3.5 to 3.5. The true
+// momentum is rounded to the MeV unless --p-edges gives bins. --by-hits adds
+// the groups of each NumHits to those of all tracks (NumHits 0).
+//
+// The core Gaussian of each residual is fitted as in Resolution.hh, its
+// errors from --bootstrap resamplings (default 200), and the table written
+// with one row per configuration, group and variable, in the units the
+// notebook plots: pT and p in percent, d0 and z0 in mm, phi0 and theta in rad.
+
+#include "Resolution.hh"
+
+#ifdef B8_WITH_ROOT
+#include "ROOT/RDataFrame.hxx"
+#include "TROOT.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::vector<double> ParseList(const std::string &text)
+{
+    std::vector<double> values;
+    std::istringstream list(text);
+    std::string value;
+    while (std::getline(list, value, ',')) values.push_back(std::stod(value));
+    return values;
+}
+
+std::vector<std::string_view> Split(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    for (std::size_t start = 0;;)
+    {
+        auto end = line.find(',', start);
+        fields.push_back(line.substr(start, end - start));
+        if (end == std::string_view::npos) return fields;
+        start = end + 1;
+    }
+}
+
+// A CSV of fit_tracks.py, by column name
+bool ReadCSV(const std::string &fileName, Resolution::Samples &samples)
+{
+    std::ifstream in(fileName);
+    std::string line;
+    if (!in || !std::getline(in, line))
+    {
+        std::cerr << "Cannot read " << fileName << std::endl;
+        return false;
+    }
+
+    const char *names[] = {"True pX", "True pY", "True pZ", "Fit d0", "Fit z0", "Fit phi0", "Fit pT", "Fit tanl",
+                           "NumHits"};
+    constexpr int kNumColumns = std::size(names);
+    int columns[kNumColumns];
+    auto header = Split(line);
+    for (int c = 0; c < kNumColumns; c++)
+    {
+        auto column = std::find(header.begin(), header.end(), names[c]);
+        if (column == header.end())
+        {
+            std::cerr << fileName << " has no " << names[c] << " column" << std::endl;
+            return false;
+        }
+        columns[c] = column - header.begin();
+    }
+
+    double values[kNumColumns];
+    while (std::getline(in, line))
+    {
+        auto fields = Split(line);
+        for (int c = 0; c < kNumColumns; c++)
+        {
+            values[c] = std::nan("");
+            if (columns[c] >= static_cast<int>(fields.size())) continue;
+            auto field = fields[columns[c]];
+            std::from_chars(field.data(), field.data() + field.size(), values[c]);
+        }
+        samples.Fill({values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7],
+                      static_cast<int>(values[8])});
+    }
+    return true;
+}
+
+#ifdef B8_WITH_ROOT
+// The fits trees of the files, each thread of RDataFrame into its own samples
+bool ReadFits(const std::vector<std::string> &fileNames, Resolution::Samples &samples)
+{
+    ROOT::RDataFrame frame("fits", fileNames);
+    std::vector<Resolution::Samples> slots(frame.GetNSlots(), Resolution::Samples(samples.GetBinning()));
+    frame.ForeachSlot(
+        [&slots](unsigned slot, double pX, double pY, double pZ, double d0, double z0, double phi0, double pT,
+                 double tanl, int numHits) {
+            slots[slot].Fill({pX, pY, pZ, d0, z0, phi0, pT, tanl, numHits});
+        },
+        {"MomentumX", "MomentumY", "MomentumZ", "FitD0", "FitZ0", "FitPhi0", "FitPT", "FitTanl", "NumHits"});
+    for (auto &slot : slots) samples.Merge(slot);
+    return true;
+}
+#endif
+
+}
+
+int main(int argc, char **argv)
+{
+    unsigned numThreads = 0;
+    Resolution::Binning binning;
+    bool byHits = false;
+    int numBootstraps = 200;
+    std::uint64_t seed = 0;
+    std::string outputName;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) numThreads = std::stoul(argv[++i]);
+        else if (arg == "--eta-edges" && i + 1 < argc) binning.etaEdges.push_back(ParseList(argv[++i]));
+        else if (arg == "--p-edges" && i + 1 < argc) binning.pEdges = ParseList(argv[++i]);
+        else if (arg == "--by-hits") byHits = true;
+        else if (arg == "--bootstrap" && i + 1 < argc) numBootstraps = std::stoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoull(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputName = argv[++i];
+        else inputs.push_back(arg);
+    }
+    auto increasing = [](const std::vector<double> &edges) {
+        return edges.size() >= 2 && std::is_sorted(edges.begin(), edges.end());
+    };
+    bool edgesOK = std::all_of(binning.etaEdges.begin(), binning.etaEdges.end(), increasing)
+                   && (binning.pEdges.empty() || increasing(binning.pEdges));
+    if (outputName.empty() || inputs.empty() || !edgesOK)
+    {
+        std::cerr << "Usage: extract_resolutions [-j threads] [--eta-edges e0,e1,...]... [--p-edges p0,p1,... (MeV)]\n"
+                  << "                           [--by-hits] [--bootstrap n] [--seed n]\n"
+                  << "                           -o <table.csv> [name=]<fits>[,<fits>...]..." << std::endl;
+        return 1;
+    }
+    if (binning.etaEdges.empty())
+    {
+        binning.etaEdges.push_back({-3., -1., 1., 3.});
+        binning.etaEdges.emplace_back();
+        for (int i = 0; i <= 14; i++) binning.etaEdges.back().push_back(-3.5 + 0.5 * i);
+    }
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // name=file,file,... or file,...
+    std::vector<std::pair<std::string, Resolution::Samples>> configurations;
+    std::vector<std::vector<std::string>> files;
+    for (const auto &input : inputs)
+    {
+        auto equals = input.find('=');
+        std::string list = equals == std::string::npos ? input : input.substr(equals + 1);
+        std::vector<std::string> fileNames;
+        std::istringstream names(list);
+        std::string fileName;
+        while (std::getline(names, fileName, ',')) fileNames.push_back(fileName);
+        if (fileNames.empty()) continue;
+        std::string name = equals == std::string::npos ? std::filesystem::path(fileNames.front()).stem().string()
+                                                       : input.substr(0, equals);
+        configurations.emplace_back(name, Resolution::Samples(binning));
+        files.push_back(fileNames);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+#ifdef B8_WITH_ROOT
+    ROOT::EnableImplicitMT(numThreads);
+#endif
+
+    // CSV files are parsed on a thread each; ROOT files are read one
+    // configuration at a time on all threads
+    std::vector<std::pair<std::size_t, std::string>> csvFiles;
+    for (std::size_t c = 0; c < configurations.size(); c++)
+    {
+        std::vector<std::string> rootFiles;
+        for (const auto &fileName : files[c])
+        {
+            if (fileName.ends_with(".csv")) csvFiles.emplace_back(c, fileName);
+            else rootFiles.push_back(fileName);
+        }
+        if (rootFiles.empty()) continue;
+#ifdef B8_WITH_ROOT
+        ok = ReadFits(rootFiles, configurations[c].second) && ok;
+#else
+        std::cerr << "Built without ROOT, cannot read " << rootFiles.front() << std::endl;
+        return 1;
+#endif
+    }
+
+    std::vector<Resolution::Samples> csvSamples(csvFiles.size(), Resolution::Samples(binning));
+    std::atomic<std::size_t> next = 0;
+    std::atomic<bool> csvOK = true;
+    auto readCSV = [&]() {
+        for (std::size_t i = next++; i < csvFiles.size(); i = next++)
+        {
+            if (!ReadCSV(csvFiles[i].second, csvSamples[i])) csvOK = false;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<std::size_t>(numThreads, csvFiles.size()); i++) threads.emplace_back(readCSV);
+    readCSV();
+    for (auto &thread : threads) thread.join();
+    for (std::size_t i = 0; i < csvFiles.size(); i++) configurations[csvFiles[i].first].second.Merge(csvSamples[i]);
+    if (!ok || !csvOK) return 1;
+
+    std::size_t numTracks = 0;
+    for (const auto &[name, samples] : configurations) numTracks += samples.GetNumTracks();
+    auto read = std::chrono::steady_clock::now();
+
+    auto rows = Resolution::Extract(configurations, byHits, numBootstraps, seed, numThreads);
+    auto fitted = std::chrono::steady_clock::now();
+
+    std::ofstream out(outputName);
+    if (!out)
+    {
+        std::cerr << "Cannot create " << outputName << std::endl;
+        return 1;
+    }
+    Resolution::WriteTable(out, rows);
+
+    auto seconds = [](auto from, auto to) { return std::chrono::duration<double>(to - from).count(); };
+    std::cout << "Read " << numTracks << " tracks of " << configurations.size() << " configurations in "
+              << seconds(start, read) << " s, fitted " << rows.size() << " residual distributions in "
+              << seconds(read, fitted) << " s on " << numThreads << " threads, written to " << outputName
+              << std::endl;
+    return 0;
+}
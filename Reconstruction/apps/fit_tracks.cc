@@ -0,0 +1,187 @@
+// Fit the tracks ntuple of DetectorSimulation, the C++ counterpart of
+// Analysis/fit_tracks.py.
+//
+// Usage: fit_tracks [-B tesla] [-j threads] [--resolutions r1,r2,... (um)] [--seed n]
+//                   [--kalman w1,w2,w3] [--hit-resolution r (um)] -o <output.root> <input.root...>
+//   e.g. fit_tracks -o DetectorSimulation/output/default_fits.root DetectorSimulation/output/default.root
+//
+// Tracks with fewer than 4 hits are skipped, the others fitted with HelixFit
+// and those fitted above 50 GeV dropped, as in fit_tracks.py. The fits are
+// written to a fits tree, one row per track: the truth momentum, eta, the
+// fitted d0, z0, phi0, pT and tan(lambda), and the IDs of the track.
+//
+// The input is read with RDataFrame on -j threads (default: one per core),
+// each taking its own clusters of entries, and the rows are written as they
+// are fitted, so nothing is held in memory and the throughput is that of
+// reading and decompressing the input.
+//
+// --resolutions smears the truth hits of a /output/storeTruthHits run at
+// each resolution, as fit_tracks.py --resolutions does with the same random
+// numbers, and writes one <output>_<r>um.root per resolution. All of them
+// are filled in a single pass over the input.
+//
+// --kalman fits with the Kalman filter of KalmanFit instead, with multiple
+// scattering in the material of a run with /det/materialWidth1/2/3 w1, w2 and
+// w3, and adds its chi2 (FitChi2). The hits are taken to have the resolution
+// they were smeared with, or --hit-resolution (default 7 um, /det/res).
+
+#include "HelixFit.hh"
+#include "HitSmearing.hh"
+#include "KalmanFit.hh"
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RVec.hxx"
+#include "TROOT.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+constexpr int kMinHitsPerTrack = 4;
+constexpr double kCutoffMomentum = 50000;       // MeV
+
+// <stem>_<r>um.root, with r formatted as %g like fit_tracks.py
+std::string ResolutionName(const std::string &outputName, double resolution)
+{
+    auto stem = outputName.ends_with(".root") ? outputName.substr(0, outputName.size() - 5) : outputName;
+    std::ostringstream name;
+    name << stem << "_" << resolution << "um.root";
+    return name.str();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    double B = 1.7;
+    unsigned numThreads = 0;
+    std::uint64_t seed = 0;
+    std::vector<double> resolutions;
+    std::vector<double> materialWidths;
+    double hitResolution = 7;
+    std::string outputName;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-B" && i + 1 < argc) B = std::stod(argv[++i]);
+        else if (arg == "-j" && i + 1 < argc) numThreads = std::stoul(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoull(argv[++i]);
+        else if (arg == "--resolutions" && i + 1 < argc)
+        {
+            std::istringstream list(argv[++i]);
+            std::string resolution;
+            while (std::getline(list, resolution, ',')) resolutions.push_back(std::stod(resolution));
+        }
+        else if (arg == "--kalman" && i + 1 < argc)
+        {
+            std::istringstream list(argv[++i]);
+            std::string width;
+            while (std::getline(list, width, ',')) materialWidths.push_back(std::stod(width));
+        }
+        else if (arg == "--hit-resolution" && i + 1 < argc) hitResolution = std::stod(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputName = argv[++i];
+        else inputs.push_back(arg);
+    }
+    bool kalman = !materialWidths.empty();
+    if (outputName.empty() || inputs.empty() || (kalman && materialWidths.size() != 3))
+    {
+        std::cerr << "Usage: fit_tracks [-B tesla] [-j threads] [--resolutions r1,r2,... (um)] [--seed n]\n"
+                  << "                  [--kalman w1,w2,w3] [--hit-resolution r (um)] -o <output.root> <input.root...>"
+                  << std::endl;
+        return 1;
+    }
+    KalmanFit::Material material;
+    if (kalman) material = KalmanFit::SVTMaterial(materialWidths[0], materialWidths[1], materialWidths[2]);
+
+    ROOT::EnableImplicitMT(numThreads);
+    ROOT::RDataFrame frame("tracks", inputs);
+
+    auto momentum = [](double pX, double pY, double pZ) { return std::sqrt(pX * pX + pY * pY + pZ * pZ); };
+    auto selected = frame.Filter([](int numHits) { return numHits >= kMinHitsPerTrack; }, {"NumHits"})
+                        .Define("TrueP", momentum, {"MomentumX", "MomentumY", "MomentumZ"})
+                        .Define("Eta", [](double pZ, double p) { return std::atanh(pZ / p); }, {"MomentumZ", "TrueP"});
+
+    // Without --resolutions the hits are fitted as they were written
+    std::vector<std::pair<double, std::string>> outputs;
+    if (resolutions.empty()) outputs.emplace_back(0., outputName);
+    for (double resolution : resolutions) outputs.emplace_back(resolution, ResolutionName(outputName, resolution));
+
+    std::vector<std::string> columns = {"EventID", "TrackID", "ParticleID", "NumHits",
+                                        "MomentumX", "MomentumY", "MomentumZ", "TrueP", "Eta",
+                                        "FitD0", "FitZ0", "FitPhi0", "FitPT", "FitTanl"};
+    if (kalman) columns.push_back("FitChi2");
+    ROOT::RDF::RSnapshotOptions snapshotOptions;
+    snapshotOptions.fLazy = true;
+
+    std::vector<ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager>>> snapshots;
+    std::vector<ROOT::RDF::RResultPtr<ULong64_t>> counts;
+    for (const auto &[resolution, fileName] : outputs)
+    {
+        // hit positions are in mm
+        double smearing = resolution * 1e-3;
+        KalmanFit::Options fitOptions;
+        fitOptions.B = B;
+        fitOptions.resolution = smearing > 0 ? smearing : hitResolution * 1e-3;
+        auto fitTrack = [&material, fitOptions, kalman, smearing, seed](
+                            const ROOT::RVecD &hitX, const ROOT::RVecD &hitY, const ROOT::RVecD &hitZ,
+                            const ROOT::RVecI &layerIDs, int eventID, int trackID) {
+            ROOT::RVecD x = hitX, y = hitY, z = hitZ;
+            if (smearing > 0)
+            {
+                HitSmearing::SmearTrack(smearing, seed, eventID, trackID, x.size(), layerIDs.data(),
+                                        x.data(), y.data(), z.data());
+            }
+            HelixFit::Parameters p;
+            double chi2 = 0.;
+            if (kalman)
+            {
+                chi2 = KalmanFit::Fit(material, fitOptions, x.size(), x.data(), y.data(), z.data(), layerIDs.data(), p);
+            }
+            else
+            {
+                p = HelixFit::Fit(fitOptions.B, x.size(), x.data(), y.data(), z.data());
+            }
+            return ROOT::RVecD{p.d0, p.z0, p.phi0, p.pT, p.tanl, chi2};
+        };
+
+        // NaN momenta are kept, as in fit_tracks.py
+        auto fitted = selected
+                          .Define("Fit", fitTrack, {"HitPositionX", "HitPositionY", "HitPositionZ", "HitLayerID",
+                                                    "EventID", "TrackID"})
+                          .Define("FitD0", [](const ROOT::RVecD &fit) { return fit[0]; }, {"Fit"})
+                          .Define("FitZ0", [](const ROOT::RVecD &fit) { return fit[1]; }, {"Fit"})
+                          .Define("FitPhi0", [](const ROOT::RVecD &fit) { return fit[2]; }, {"Fit"})
+                          .Define("FitPT", [](const ROOT::RVecD &fit) { return fit[3]; }, {"Fit"})
+                          .Define("FitTanl", [](const ROOT::RVecD &fit) { return fit[4]; }, {"Fit"})
+                          .Define("FitChi2", [](const ROOT::RVecD &fit) { return fit[5]; }, {"Fit"})
+                          .Filter([](double pT, double tanl) { return !(std::hypot(pT, tanl * pT) > kCutoffMomentum); },
+                                  {"FitPT", "FitTanl"});
+
+        counts.push_back(fitted.Count());
+        snapshots.push_back(fitted.Snapshot("fits", fileName, columns, snapshotOptions));
+    }
+    auto numSelected = selected.Count();
+
+    // Every output is filled in the one event loop this starts
+    auto start = std::chrono::steady_clock::now();
+    ULong64_t numRows = *frame.Count();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Read " << numRows << " tracks in " << seconds << " s (" << numRows / seconds << " tracks/s), "
+              << *numSelected << " with at least " << kMinHitsPerTrack << " hits, on "
+              << ROOT::GetThreadPoolSize() << " threads" << std::endl;
+    for (std::size_t i = 0; i < outputs.size(); i++)
+    {
+        std::cout << "  " << *counts[i] << " fits written to " << outputs[i].second << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+// Merge the outputs of DetectorSimulation --shard i/n into one file.
+//
+// Usage: merge_shards -o <merged.root> <shard sidecars...>
+//   e.g. merge_shards -o output/run.root output/run.shard*.shard
+//
+// Each sidecar (.shard), written once its shard has finished, names the
+// files holding that shard and its slice of the event IDs. Before anything
+// is written the shards are checked to be all present, to agree on the run
+// (number of events, run seed, number of shards) and to cover every event ID
+// exactly once. The rows of the tracks ntuple, and of the fits ntuple of a
+// run with /output/reconstruct, are then checked to lie in their shard's
+// slice with no (EventID, TrackID) twice, reading only those two columns, and
+// each ntuple is copied basket by basket without being decompressed. The
+// histograms are summed.
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// The ntuples of DetectorSimulation, merged if the run wrote them
+const char *const kTreeNames[] = {"tracks", "fits"};
+
+struct Shard {
+    std::string sidecar;
+    int index = -1;
+    int count = 0;
+    long events = -1;
+    long first = -1;
+    long last = -1;
+    long runSeed = 0;
+    std::vector<std::string> files;     // relative to the sidecar's directory
+};
+
+bool ReadShard(const std::string &sidecar, Shard &shard)
+{
+    std::ifstream in(sidecar);
+    if (!in)
+    {
+        std::cerr << "Cannot open " << sidecar << std::endl;
+        return false;
+    }
+
+    shard.sidecar = sidecar;
+    auto directory = std::filesystem::path(sidecar).parent_path();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream is(line);
+        std::string key;
+        is >> key;
+        if (key == "shard") is >> shard.index >> shard.count;
+        else if (key == "events") is >> shard.events;
+        else if (key == "first") is >> shard.first;
+        else if (key == "last") is >> shard.last;
+        else if (key == "runSeed") is >> shard.runSeed;
+        else if (key == "file")
+        {
+            std::string file;
+            is >> file;
+            shard.files.push_back((directory / file).string());
+        }
+    }
+
+    if (shard.index < 0 || shard.count <= 0 || shard.events < 0 || shard.files.empty())
+    {
+        std::cerr << sidecar << " is not a complete shard sidecar" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Same shards of the same run, each present once, with the slices DetectorSimulation cuts
+bool CheckShards(std::vector<Shard> &shards)
+{
+    std::sort(shards.begin(), shards.end(), [](const Shard &a, const Shard &b) { return a.index < b.index; });
+
+    const auto &reference = shards.front();
+    bool ok = true;
+    for (std::size_t i = 0; i < shards.size(); i++)
+    {
+        const auto &shard = shards[i];
+        if (shard.count != reference.count || shard.events != reference.events || shard.runSeed != reference.runSeed)
+        {
+            std::cerr << shard.sidecar << " is from a different run than " << reference.sidecar << std::endl;
+            ok = false;
+        }
+        if (i > 0 && shard.index == shards[i - 1].index)
+        {
+            std::cerr << "Shard " << shard.index << " given twice: " << shards[i - 1].sidecar << " and "
+                      << shard.sidecar << std::endl;
+            ok = false;
+        }
+        if (shard.first != shard.events * shard.index / shard.count
+            || shard.last != shard.events * (shard.index + 1) / shard.count)
+        {
+            std::cerr << shard.sidecar << " has events " << shard.first << " to " << shard.last
+                      << ", not its slice of " << shard.events << std::endl;
+            ok = false;
+        }
+    }
+    if (!ok) return false;
+
+    for (int index = 0, i = 0; index < reference.count; index++)
+    {
+        if (i < static_cast<int>(shards.size()) && shards[i].index == index)
+        {
+            i++;
+            continue;
+        }
+        std::cerr << "Shard " << index << " of " << reference.count << " is missing or incomplete" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+// Whether the run wrote this ntuple, from the first file of a shard
+bool HasTree(const Shard &shard, const char *treeName)
+{
+    std::unique_ptr<TFile> file(TFile::Open(shard.files.front().c_str()));
+    return file && !file->IsZombie() && file->Get<TTree>(treeName);
+}
+
+// Every row in the shard's slice and no (EventID, TrackID) twice. Returns the number of events with rows.
+long CheckRows(const Shard &shard, const char *treeName, bool &ok)
+{
+    TChain chain(treeName);
+    for (const auto &file : shard.files) chain.Add(file.c_str());
+
+    Int_t eventID = 0;
+    Int_t trackID = 0;
+    chain.SetBranchStatus("*", false);
+    chain.SetBranchStatus("EventID", true);
+    chain.SetBranchStatus("TrackID", true);
+    chain.SetBranchAddress("EventID", &eventID);
+    chain.SetBranchAddress("TrackID", &trackID);
+
+    // 8 bytes per row, not the rows themselves
+    std::vector<std::uint64_t> keys;
+    keys.reserve(chain.GetEntries());
+    long outside = 0;
+    for (Long64_t entry = 0; chain.GetEntry(entry) > 0; entry++)
+    {
+        if (eventID < shard.first || eventID >= shard.last) outside++;
+        keys.push_back(static_cast<std::uint64_t>(eventID) << 32 | static_cast<std::uint32_t>(trackID));
+    }
+
+    std::sort(keys.begin(), keys.end());
+    long duplicates = 0;
+    long events = keys.empty() ? 0 : 1;
+    for (std::size_t i = 1; i < keys.size(); i++)
+    {
+        if (keys[i] == keys[i - 1]) duplicates++;
+        if (keys[i] >> 32 != keys[i - 1] >> 32) events++;
+    }
+
+    if (outside > 0)
+    {
+        std::cerr << shard.sidecar << ": " << outside << " " << treeName << " rows outside events " << shard.first << " to "
+                  << shard.last << std::endl;
+        ok = false;
+    }
+    if (duplicates > 0)
+    {
+        std::cerr << shard.sidecar << ": " << duplicates << " duplicated " << treeName << " rows" << std::endl;
+        ok = false;
+    }
+    return events;
+}
+
+// Sum the histograms of all files, by name
+void AddHistograms(const std::string &fileName, std::map<std::string, std::unique_ptr<TH1>> &sums)
+{
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+    if (!file || file->IsZombie()) return;
+    for (auto key : *file->GetListOfKeys())
+    {
+        auto object = static_cast<TKey *>(key)->ReadObj();
+        auto histogram = dynamic_cast<TH1 *>(object);
+        if (!histogram)
+        {
+            delete object;
+            continue;
+        }
+        auto &sum = sums[histogram->GetName()];
+        if (sum)
+        {
+            sum->Add(histogram);
+            delete histogram;
+        }
+        else
+        {
+            histogram->SetDirectory(nullptr);
+            sum.reset(histogram);
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string outputName;
+    std::vector<std::string> sidecars;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) outputName = argv[++i];
+        else sidecars.push_back(arg);
+    }
+    if (outputName.empty() || sidecars.empty())
+    {
+        std::cerr << "Usage: merge_shards -o <merged.root> <shard sidecars...>" << std::endl;
+        return 1;
+    }
+
+    std::vector<Shard> shards(sidecars.size());
+    for (std::size_t i = 0; i < sidecars.size(); i++)
+    {
+        if (!ReadShard(sidecars[i], shards[i])) return 1;
+    }
+    if (!CheckShards(shards)) return 1;
+
+    for (const auto &shard : shards)
+    {
+        for (const auto &file : shard.files)
+        {
+            if (!std::filesystem::exists(file))
+            {
+                std::cerr << shard.sidecar << ": " << file << " does not exist" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // One chain per ntuple the run wrote, the events counted from the first
+    bool ok = true;
+    long events = 0;
+    std::vector<std::unique_ptr<TChain>> chains;
+    for (const char *treeName : kTreeNames)
+    {
+        if (!HasTree(shards.front(), treeName)) continue;
+        auto &chain = chains.emplace_back(std::make_unique<TChain>(treeName));
+        for (const auto &shard : shards)
+        {
+            for (const auto &file : shard.files) chain->Add(file.c_str());
+            long shardEvents = CheckRows(shard, treeName, ok);
+            if (chains.size() == 1) events += shardEvents;
+        }
+    }
+    if (chains.empty())
+    {
+        std::cerr << shards.front().files.front() << " has no tracks or fits ntuple" << std::endl;
+        return 1;
+    }
+    if (!ok) return 1;
+
+    // Written only once everything checked out
+    auto output = TFile::Open(outputName.c_str(), "RECREATE");
+    if (!output || output->IsZombie())
+    {
+        std::cerr << "Cannot create " << outputName << std::endl;
+        return 1;
+    }
+    std::ostringstream rows;
+    for (auto &chain : chains)
+    {
+        rows << (rows.tellp() > 0 ? ", " : "") << chain->GetEntries() << " " << chain->GetName() << " rows";
+        chain->Merge(output, 0, "fast keep");
+    }
+
+    std::map<std::string, std::unique_ptr<TH1>> histograms;
+    for (const auto &shard : shards)
+    {
+        for (const auto &file : shard.files) AddHistograms(file, histograms);
+    }
+    output->cd();
+    for (const auto &[name, histogram] : histograms) histogram->Write();
+    output->Close();
+    delete output;
+
+    std::cout << "Merged " << shards.size() << " shards of " << shards.front().events << " events: " << rows.str()
+              << " from " << events << " events with primaries into " << outputName << std::endl;
+    return 0;
+}
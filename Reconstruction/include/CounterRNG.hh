@@ -0,0 +1,67 @@
+#ifndef CounterRNG_h
+#define CounterRNG_h 1
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <numbers>
+
+/// Counter-based random numbers.
+///
+/// The n-th number of a stream is a hash of (key, n), so a stream keyed by
+/// e.g. (seed, eventID, trackID) gives the same numbers whichever thread,
+/// job or program evaluates it, and in whatever order the streams are used.
+/// The hash is the splitmix64 finaliser, which is fast and passes BigCrush
+/// for sequential counters; this is not a cryptographic generator.
+
+namespace B8Random
+{
+
+inline std::uint64_t Mix(std::uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Combine several words into one stream key
+inline std::uint64_t Key(std::initializer_list<std::uint64_t> words)
+{
+    std::uint64_t key = 0x6A09E667F3BCC909ull;
+    for (auto word : words)
+        key = Mix(key ^ (word + 0x9E3779B97F4A7C15ull));
+    return key;
+}
+
+class CounterRNG
+{
+public:
+    explicit CounterRNG(std::uint64_t key) : fKey(key) {}
+    CounterRNG(std::initializer_list<std::uint64_t> words) : fKey(Key(words)) {}
+
+    std::uint64_t Next() { return Mix(fKey + 0x9E3779B97F4A7C15ull * ++fCounter); }
+
+    // Uniform in (0, 1), never exactly 0 so it is safe to take the log
+    double Uniform() { return ((Next() >> 11) + 0.5) * 0x1.0p-53; }
+
+    // Standard normal (Box-Muller, one value per pair of uniforms so every
+    // call consumes the same number of counters)
+    double Gauss()
+    {
+        double u1 = Uniform();
+        double u2 = Uniform();
+        return std::sqrt(-2. * std::log(u1)) * std::cos(2. * std::numbers::pi * u2);
+    }
+
+    double Gauss(double mean, double sigma) { return mean + sigma * Gauss(); }
+
+    std::uint64_t GetCounter() const { return fCounter; }
+
+private:
+    std::uint64_t fKey;
+    std::uint64_t fCounter = 0;
+};
+
+}
+
+#endif
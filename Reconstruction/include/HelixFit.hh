@@ -0,0 +1,52 @@
+#ifndef HelixFit_h
+#define HelixFit_h 1
+
+#include <cstddef>
+#include <cstdint>
+
+/// Helix fit of the hits of many tracks, the fit_helix of
+/// Analysis/helix_fitting.py in C++.
+///
+/// The circle in the xy plane is fitted with the Karimaki method, its sense
+/// of rotation taken from the unwrapped hit angles, and tan(lambda) and z0 from
+/// a straight line fit of z against the arc length. The parameters are the
+/// same as in Python: d0 and z0 in the unit of the hits (mm), phi0, pT in MeV
+/// for a field B in tesla, and tan(lambda).
+///
+/// Tracks are fitted in batches held as structures of arrays: the hits of all
+/// tracks in x, y and z, track i owning hits offsets[i] to offsets[i + 1].
+/// Each batch goes through a few passes, each one loop over tracks or hits
+/// with no branches on the data, so the compiler can vectorise them.
+
+namespace HelixFit
+{
+
+struct Parameters {
+    double d0;
+    double z0;
+    double phi0;
+    double pT;
+    double tanl;
+};
+
+// Fit one track of n hits
+Parameters Fit(double B, std::size_t n, const double *x, const double *y, const double *z);
+
+// Fit numTracks tracks into the arrays d0 ... tanl, on numThreads threads
+// (0 for one per core)
+void FitTracks(double B, std::size_t numTracks, const std::int64_t *offsets,
+               const double *x, const double *y, const double *z,
+               double *d0, double *z0, double *phi0, double *pT, double *tanl, unsigned numThreads = 0);
+
+}
+
+// C interface for Python (ctypes, see Analysis/helix_fitting.py)
+extern "C" {
+
+void b8_fit_helices(double B, std::size_t numTracks, const std::int64_t *offsets,
+                    const double *x, const double *y, const double *z,
+                    double *d0, double *z0, double *phi0, double *pT, double *tanl, unsigned numThreads);
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef HitSmearing_h
+#define HitSmearing_h 1
+
+#include <cstddef>
+#include <cstdint>
+
+/// Detector resolution applied to truth hits when they are read.
+///
+/// DetectorSimulation run with /output/storeTruthHits true writes unsmeared
+/// hit positions and their layer (HitLayerID), so one transport pass can be
+/// analysed at any number of resolutions. Smearing follows
+/// TrackerSD::GetSmearedPosition: barrel layers (ID < kNumBarrelLayers) are
+/// smeared in r*phi and z at fixed radius, discs in x and y at fixed z.
+///
+/// The random numbers of a track only depend on (seed, eventID, trackID), so
+/// a given resolution point is reproducible and different resolutions see
+/// the same underlying fluctuations, scaled.
+///
+/// All lengths are in the same unit (mm in the simulation output).
+
+namespace HitSmearing
+{
+
+constexpr int kNumBarrelLayers = 5;
+
+inline bool IsBarrel(int layerID) { return layerID < kNumBarrelLayers; }
+
+// Smear the n hits of one track in place
+void SmearTrack(double resolution, std::uint64_t seed, std::int64_t eventID, std::int64_t trackID,
+                std::size_t n, const std::int32_t *layerID, double *x, double *y, double *z);
+
+}
+
+// C interface for Python (ctypes, see Analysis/hit_smearing.py)
+extern "C" {
+
+// Smear the hits of many tracks. Track i owns hits offsets[i] to
+// offsets[i + 1]; x, y and z are overwritten.
+void b8_smear_hits(double resolution, std::uint64_t seed, std::size_t numTracks,
+                   const std::int64_t *eventIDs, const std::int64_t *trackIDs,
+                   const std::int64_t *offsets, const std::int32_t *layerIDs,
+                   double *x, double *y, double *z);
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef KalmanFit_h
+#define KalmanFit_h 1
+
+#include "HelixFit.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Kalman filter and smoother fit of tracks with multiple scattering.
+///
+/// The track is a helix in the solenoid field, from its production vertex
+/// through its hits ordered outwards. Crossing the beam pipe and each layer it
+/// has a hit on, the helix is kinked by multiple scattering: the process noise
+/// is the Highland angle of the X/X0 crossed, at the angle of incidence, for a
+/// track of the fitted momentum and the given mass. The material is that of
+/// DetectorConstruction, with each layer's support padded to its material
+/// budget (/det/materialWidth1/2/3).
+///
+/// The helix between two hits is held as its perigee parameters, so the
+/// transport from one hit to the next is the identity and only the noise
+/// changes the state. A hit measures r*phi and z on a barrel layer, x and y on
+/// a disc, with the resolution the hits were smeared with. The filter runs
+/// outwards from the Karimaki fit of HelixFit, the smoother brings every hit's
+/// information back to the vertex, and the pass is repeated once linearised
+/// about the smoothed helices.
+///
+/// Energy loss and layers crossed without a hit are not included. Parameters
+/// are returned as those of HelixFit (d0, z0 in mm, phi0, pT in MeV, tan(lambda))
+/// with the chi2 of the fit, of 2 * hits - 5 degrees of freedom.
+
+namespace KalmanFit
+{
+
+struct Material {
+    std::vector<double> layerX0;    // X/X0 of each layer, by layer ID (barrels, then discs)
+    double beamPipeRadius;          // mm
+    double beamPipeX0;
+};
+
+// The layers of DetectorConstruction with the given material budgets
+Material SVTMaterial(double width1 = 0.0007, double width2 = 0.0025, double width3 = 0.0055);
+
+struct Options {
+    double B = 1.7;                 // tesla
+    double resolution = 7e-3;       // mm, of both coordinates of a hit
+    double mass = 139.57;           // MeV, of the particle scattering (pi+)
+};
+
+// Fit one track of n hits, returning its chi2 (NaN if the fit failed)
+double Fit(const Material &material, const Options &options, std::size_t n, const double *x, const double *y,
+           const double *z, const std::int32_t *layerIDs, HelixFit::Parameters &parameters);
+
+// Fit numTracks tracks, track i owning hits offsets[i] to offsets[i + 1], on
+// numThreads threads (0 for one per core)
+void FitTracks(const Material &material, const Options &options, std::size_t numTracks,
+               const std::int64_t *offsets, const double *x, const double *y, const double *z,
+               const std::int32_t *layerIDs, double *d0, double *z0, double *phi0, double *pT, double *tanl,
+               double *chi2, unsigned numThreads = 0);
+
+}
+
+// C interface for Python (ctypes, see Analysis/helix_fitting.py)
+extern "C" {
+
+void b8_kalman_fit_tracks(double width1, double width2, double width3, double B, double resolution, double mass,
+                          std::size_t numTracks, const std::int64_t *offsets,
+                          const double *x, const double *y, const double *z, const std::int32_t *layerIDs,
+                          double *d0, double *z0, double *phi0, double *pT, double *tanl, double *chi2,
+                          unsigned numThreads);
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef Resolution_h
+#define Resolution_h 1
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/// Track parameter resolutions from fitted tracks, the gaussian_sigma loops
+/// of Analysis/tracking_performance.ipynb in C++.
+///
+/// The residuals of each fit are those of the notebook: pT and p relative to
+/// the truth in percent, d0 and z0 in mm (the truth vertex is the origin),
+/// phi0 and theta in rad. They are collected by (eta bin, true momentum,
+/// NumHits) for each configuration, an eta bin being [lo, hi) as in the
+/// notebook, and the true momentum either rounded to the MeV, like the
+/// "True p" column of fit_tracks.py, or binned.
+///
+/// The width of each residual distribution is that of a Gaussian fitted to
+/// its core: seeded with the median and the half width of the central 68%,
+/// the residuals within 2 sigma are histogrammed in 50 bins and fitted by
+/// binned maximum likelihood, and the window is moved to the fitted Gaussian
+/// until it settles. The uncertainties of the mean and sigma are the spread
+/// of refits of Poisson resamplings of the final histogram (a bootstrap of
+/// the residuals in the window). Distributions too small or too odd to fit
+/// fall back to the seed, as gaussian_sigma does.
+
+namespace Resolution
+{
+
+enum Variable { kPT, kP, kD0, kZ0, kPhi0, kTheta, kNumVariables };
+
+// Column names in the table
+extern const char *const kVariableNames[kNumVariables];
+
+// A fitted track: truth momentum (MeV) and fitted parameters as in the fits
+// tree of fit_tracks
+struct Track {
+    double pX, pY, pZ;
+    double d0, z0, phi0, pT, tanl;
+    int numHits;
+};
+
+void Residuals(const Track &track, double residuals[kNumVariables]);
+
+struct Binning {
+    // One or more sets of eta bin edges; a track goes in a bin of each
+    std::vector<std::vector<double>> etaEdges;
+    // Momentum bin edges in MeV, or empty for one bin per true momentum
+    // rounded to the MeV (the discrete momenta of the gun)
+    std::vector<double> pEdges;
+};
+
+// The residuals of the tracks of one configuration, by group
+class Samples
+{
+public:
+    explicit Samples(const Binning &binning) : fBinning(binning) {}
+
+    void Fill(const Track &track);
+    // Move the residuals of other into this one
+    void Merge(Samples &other);
+
+    std::size_t GetNumTracks() const { return fNumTracks; }
+
+    // (eta binning, eta bin, momentum bin or rounded momentum, NumHits)
+    using Key = std::tuple<int, int, std::int64_t, int>;
+    struct Cell {
+        std::array<std::vector<float>, kNumVariables> residuals;
+        double sumP = 0.;
+    };
+
+    const Binning &GetBinning() const { return fBinning; }
+    const std::map<Key, Cell> &GetCells() const { return fCells; }
+
+private:
+    Binning fBinning;
+    std::map<Key, Cell> fCells;
+    std::size_t fNumTracks = 0;
+};
+
+struct CoreFit {
+    double mean;
+    double meanError;
+    double sigma;
+    double sigmaError;
+    std::size_t entries;        // finite residuals
+    std::size_t coreEntries;    // within the final window
+    bool fitted;                // false if sigma is the seed
+};
+
+// Core Gaussian of the values, with numBootstraps resamplings for the errors
+CoreFit FitCore(std::vector<double> values, int numBootstraps, std::uint64_t seed);
+
+struct Row {
+    std::string configuration;
+    double etaLo, etaHi;
+    double p, pLo, pHi;         // MeV, p the mean true momentum of the group
+    int numHits;                // 0 for all tracks of the group
+    Variable variable;
+    CoreFit fit;
+};
+
+// Fit every group of every configuration, also split by NumHits if byHits,
+// on numThreads threads (0 for one per core)
+std::vector<Row> Extract(const std::vector<std::pair<std::string, Samples>> &configurations, bool byHits,
+                         int numBootstraps, std::uint64_t seed, unsigned numThreads = 0);
+
+// Comma separated, one row per group and variable, with a header
+void WriteTable(std::ostream &out, const std::vector<Row> &rows);
+
+}
+
+#endif
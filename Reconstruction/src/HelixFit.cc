@@ -0,0 +1,214 @@
+#include "HelixFit.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <thread>
+#include <vector>
+
+namespace HelixFit
+{
+
+namespace
+{
+
+constexpr double kPi = std::numbers::pi;
+constexpr double kSpeedOfLight = 299792458;
+constexpr double kElectronCharge = 1.602176634e-19;
+
+// Tracks per batch, so the per-track arrays of a batch stay in L1
+constexpr std::size_t kBatchSize = 256;
+
+// Correction np.unwrap adds to a step of d between consecutive angles
+inline double UnwrapCorrection(double d)
+{
+    if (std::abs(d) < kPi) return 0.;
+    // np.mod, with the sign of the divisor
+    double mod = std::fmod(d + kPi, 2 * kPi);
+    if (mod != 0. && mod < 0.) mod += 2 * kPi;
+    double wrapped = mod - kPi;
+    if (wrapped == -kPi && d > 0) wrapped = kPi;
+    return wrapped - d;
+}
+
+// Per-track quantities of one batch, as structures of arrays
+struct Batch {
+    double meanX[kBatchSize], meanY[kBatchSize];
+    double Cuu[kBatchSize], Cuv[kBatchSize], Cvv[kBatchSize], Cur2[kBatchSize], Cvr2[kBatchSize];
+    double meanR2[kBatchSize];
+    double xc[kBatchSize], yc[kBatchSize], R[kBatchSize];
+};
+
+void FitBatch(double B, std::size_t numTracks, const std::int64_t *offsets,
+              const double *x, const double *y, const double *z,
+              double *d0, double *z0, double *phi0, double *pT, double *tanl)
+{
+    Batch batch;
+
+    // Centroid, then the moments about it (karamaki_fit)
+    for (std::size_t t = 0; t < numTracks; t++)
+    {
+        std::int64_t first = offsets[t], last = offsets[t + 1];
+        double n = last - first;
+        double sumX = 0., sumY = 0.;
+        for (std::int64_t i = first; i < last; i++)
+        {
+            sumX += x[i];
+            sumY += y[i];
+        }
+        double xm = sumX / n, ym = sumY / n;
+
+        double uu = 0., uv = 0., vv = 0., ur2 = 0., vr2 = 0., r2 = 0.;
+        for (std::int64_t i = first; i < last; i++)
+        {
+            double u = x[i] - xm, v = y[i] - ym;
+            double rr = u * u + v * v;
+            uu += u * u;
+            uv += u * v;
+            vv += v * v;
+            ur2 += u * rr;
+            vr2 += v * rr;
+            r2 += rr;
+        }
+        batch.meanX[t] = xm;
+        batch.meanY[t] = ym;
+        batch.Cuu[t] = uu / n;
+        batch.Cuv[t] = uv / n;
+        batch.Cvv[t] = vv / n;
+        batch.Cur2[t] = ur2 / n;
+        batch.Cvr2[t] = vr2 / n;
+        batch.meanR2[t] = r2 / n;
+    }
+
+    // Circle of every track, then what only depends on it
+#pragma omp simd
+    for (std::size_t t = 0; t < numTracks; t++)
+    {
+        double alpha = 0.5 * batch.Cur2[t];
+        double beta = 0.5 * batch.Cvr2[t];
+        double denominator = batch.Cuu[t] * batch.Cvv[t] - batch.Cuv[t] * batch.Cuv[t];
+        double xcRel = (alpha * batch.Cvv[t] - beta * batch.Cuv[t]) / denominator;
+        double ycRel = (beta * batch.Cuu[t] - alpha * batch.Cuv[t]) / denominator;
+        double R = std::sqrt(xcRel * xcRel + ycRel * ycRel + batch.meanR2[t]);
+        double xc = xcRel + batch.meanX[t];
+        double yc = ycRel + batch.meanY[t];
+
+        batch.xc[t] = xc;
+        batch.yc[t] = yc;
+        batch.R[t] = R;
+        d0[t] = std::sqrt(xc * xc + yc * yc) - R;
+        pT[t] = kElectronCharge * B * (R * 1e-3) * kSpeedOfLight / (1e6 * kElectronCharge);
+    }
+
+    for (std::size_t t = 0; t < numTracks; t++)
+        phi0[t] = std::atan2(-batch.xc[t], batch.yc[t]);
+
+    // Sense of rotation, then z against the arc length (fit_helix)
+    std::vector<double> u;
+    for (std::size_t t = 0; t < numTracks; t++)
+    {
+        std::int64_t first = offsets[t], last = offsets[t + 1];
+        if (first == last)
+        {
+            z0[t] = tanl[t] = std::nan("");
+            continue;
+        }
+        double xc = batch.xc[t], yc = batch.yc[t];
+        double n = last - first;
+
+        // Sum of the unwrapped steps of the angle about the centre
+        double turn = 0.;
+        double previous = std::atan2(y[first] - yc, x[first] - xc);
+        for (std::int64_t i = first + 1; i < last; i++)
+        {
+            double angle = std::atan2(y[i] - yc, x[i] - xc);
+            double step = angle - previous;
+            turn += step + UnwrapCorrection(step);
+            previous = angle;
+        }
+        double R = turn > 0 ? batch.R[t] : turn < 0 ? -batch.R[t] : 0.;
+        if (R == 0.) pT[t] = 0.;
+
+        // Arc length of each hit, from its phase along the helix unwrapped and
+        // shifted to the turn of phi0
+        u.resize(last - first);
+        double phase = std::atan2(x[first] - xc, -(y[first] - yc));
+        double shift = -2. * kPi * std::nearbyint((phase - phi0[t]) / (2. * kPi));
+        double correction = 0.;
+        double sumU = 0., sumZ = 0.;
+        for (std::int64_t i = first; i < last; i++)
+        {
+            double raw = std::atan2(x[i] - xc, -(y[i] - yc));
+            if (i > first) correction += UnwrapCorrection(raw - phase);
+            phase = raw;
+            u[i - first] = R * (raw + correction + shift - phi0[t]);
+            sumU += u[i - first];
+            sumZ += z[i];
+        }
+        double meanU = sumU / n, meanZ = sumZ / n;
+
+        // Least squares line, centred. A flat u (R == 0) gets the minimum norm
+        // solution, as from np.linalg.lstsq.
+        double suu = 0., suz = 0.;
+        for (std::int64_t i = first; i < last; i++)
+        {
+            double du = u[i - first] - meanU;
+            suu += du * du;
+            suz += du * (z[i] - meanZ);
+        }
+        tanl[t] = suu > 0. ? suz / suu : 0.;
+        z0[t] = meanZ - tanl[t] * meanU;
+    }
+}
+
+}
+
+Parameters Fit(double B, std::size_t n, const double *x, const double *y, const double *z)
+{
+    std::int64_t offsets[2] = {0, static_cast<std::int64_t>(n)};
+    Parameters p;
+    FitBatch(B, 1, offsets, x, y, z, &p.d0, &p.z0, &p.phi0, &p.pT, &p.tanl);
+    return p;
+}
+
+void FitTracks(double B, std::size_t numTracks, const std::int64_t *offsets,
+               const double *x, const double *y, const double *z,
+               double *d0, double *z0, double *phi0, double *pT, double *tanl, unsigned numThreads)
+{
+    auto fitRange = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; t += kBatchSize)
+        {
+            std::size_t n = std::min(kBatchSize, end - t);
+            FitBatch(B, n, offsets + t, x, y, z, d0 + t, z0 + t, phi0 + t, pT + t, tanl + t);
+        }
+    };
+
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    // Not worth a thread for less than a few batches
+    numThreads = std::min<std::size_t>(numThreads, (numTracks + 4 * kBatchSize - 1) / (4 * kBatchSize));
+    if (numThreads <= 1)
+    {
+        fitRange(0, numTracks);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numThreads; i++)
+    {
+        threads.emplace_back(fitRange, numTracks * i / numThreads, numTracks * (i + 1) / numThreads);
+    }
+    for (auto &thread : threads) thread.join();
+}
+
+}
+
+extern "C" {
+
+void b8_fit_helices(double B, std::size_t numTracks, const std::int64_t *offsets,
+                    const double *x, const double *y, const double *z,
+                    double *d0, double *z0, double *phi0, double *pT, double *tanl, unsigned numThreads)
+{
+    HelixFit::FitTracks(B, numTracks, offsets, x, y, z, d0, z0, phi0, pT, tanl, numThreads);
+}
+
+}
@@ -0,0 +1,55 @@
+#include "HitSmearing.hh"
+
+#include "CounterRNG.hh"
+
+#include <cmath>
+
+namespace HitSmearing
+{
+
+void SmearTrack(double resolution, std::uint64_t seed, std::int64_t eventID, std::int64_t trackID,
+                std::size_t n, const std::int32_t *layerID, double *x, double *y, double *z)
+{
+    B8Random::CounterRNG rng{seed, static_cast<std::uint64_t>(eventID), static_cast<std::uint64_t>(trackID)};
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        // Two normals per hit whatever the layer type, so a hit's numbers do
+        // not depend on the layers of the hits before it
+        double g1 = rng.Gauss();
+        double g2 = rng.Gauss();
+
+        if (IsBarrel(layerID[i]))
+        {
+            double radius = std::hypot(x[i], y[i]);
+            double phi = std::atan2(y[i], x[i]) + g1 * resolution / radius;
+            x[i] = radius * std::cos(phi);
+            y[i] = radius * std::sin(phi);
+            z[i] += g2 * resolution;
+        }
+        else
+        {
+            x[i] += g1 * resolution;
+            y[i] += g2 * resolution;
+        }
+    }
+}
+
+}
+
+extern "C" {
+
+void b8_smear_hits(double resolution, std::uint64_t seed, std::size_t numTracks,
+                   const std::int64_t *eventIDs, const std::int64_t *trackIDs,
+                   const std::int64_t *offsets, const std::int32_t *layerIDs,
+                   double *x, double *y, double *z)
+{
+    for (std::size_t i = 0; i < numTracks; i++)
+    {
+        auto first = offsets[i];
+        HitSmearing::SmearTrack(resolution, seed, eventIDs[i], trackIDs[i], offsets[i + 1] - first,
+                                layerIDs + first, x + first, y + first, z + first);
+    }
+}
+
+}
@@ -0,0 +1,487 @@
+#include "KalmanFit.hh"
+
+#include "HitSmearing.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <thread>
+
+namespace KalmanFit
+{
+
+namespace
+{
+
+constexpr double kPi = std::numbers::pi;
+// pT in MeV of a track of radius 1 mm in 1 T
+constexpr double kMeVPerTeslaMM = 0.299792458;
+
+// Perigee parameters: d0, z0, phi0 (the direction of motion at the perigee),
+// kappa (the curvature in 1 / mm, positive counterclockwise) and tan(lambda).
+// The perigee is at d0 * (-sin phi0, cos phi0).
+enum { kD0, kZ0, kPhi0, kKappa, kTanl, kDim };
+using Vector = std::array<double, kDim>;
+using Matrix = std::array<double, kDim * kDim>;
+
+struct Hit {
+    double x, y, z;
+    double r;
+    bool barrel;
+    double x0;      // X/X0 of its layer
+};
+
+struct Position {
+    double x, y, z;
+    double phi;     // direction in xy
+};
+
+double Sinc(double a) { return a == 0. ? 1. : std::sin(a) / a; }
+
+double Wrap(double a) { return a - 2 * kPi * std::nearbyint(a / (2 * kPi)); }
+
+// Position a path s in xy along the helix from its perigee, written without
+// 1 / kappa so that straight tracks need no special case
+Position At(const Vector &p, double s)
+{
+    double half = 0.5 * p[kKappa] * s;
+    double chord = s * Sinc(half);
+    return {-p[kD0] * std::sin(p[kPhi0]) + chord * std::cos(p[kPhi0] + half),
+            p[kD0] * std::cos(p[kPhi0]) + chord * std::sin(p[kPhi0] + half),
+            p[kZ0] + p[kTanl] * s, p[kPhi0] + 2 * half};
+}
+
+// Path in xy from the perigee to radius r, NaN if the helix does not reach it
+double PathToRadius(const Vector &p, double r)
+{
+    double s = std::sqrt(std::max(r * r - p[kD0] * p[kD0], 0.));
+    for (int i = 0; i < 20; i++)
+    {
+        auto q = At(p, s);
+        double step = (q.x * q.x + q.y * q.y - r * r) / (2 * (q.x * std::cos(q.phi) + q.y * std::sin(q.phi)));
+        s -= step;
+        if (std::abs(step) < 1e-9) return s;
+    }
+    return std::nan("");
+}
+
+double PathTo(const Vector &p, const Hit &hit)
+{
+    return hit.barrel ? PathToRadius(p, hit.r) : (hit.z - p[kZ0]) / p[kTanl];
+}
+
+// Perigee parameters of the helix through (x, y, z) with direction phi in xy,
+// tan(lambda) and curvature kappa. Newton's method on the path back to the
+// point where the position is normal to the direction, a fixed number of
+// steps so the result is smooth in its arguments.
+Vector Through(double x, double y, double z, double phi, double tanl, double kappa)
+{
+    Vector p = {0., z, phi, kappa, tanl};
+    double s = -(x * std::cos(phi) + y * std::sin(phi));
+    for (int i = 0; i < 8; i++)
+    {
+        double half = 0.5 * kappa * s;
+        double chord = s * Sinc(half);
+        double px = x + chord * std::cos(phi + half);
+        double py = y + chord * std::sin(phi + half);
+        double direction = phi + 2 * half;
+        double f = px * std::cos(direction) + py * std::sin(direction);
+        double df = 1 + kappa * (py * std::cos(direction) - px * std::sin(direction));
+        s -= f / df;
+    }
+
+    double half = 0.5 * kappa * s;
+    double chord = s * Sinc(half);
+    double px = x + chord * std::cos(phi + half);
+    double py = y + chord * std::sin(phi + half);
+    p[kPhi0] = phi + 2 * half;
+    p[kD0] = py * std::cos(p[kPhi0]) - px * std::sin(p[kPhi0]);
+    p[kZ0] = z + tanl * s;
+    return p;
+}
+
+// Measured minus predicted position: r*phi and z on a barrel layer, x and y on a disc
+std::array<double, 2> Residual(const Vector &p, const Hit &hit)
+{
+    auto q = At(p, PathTo(p, hit));
+    if (hit.barrel) return {hit.r * Wrap(std::atan2(hit.y, hit.x) - std::atan2(q.y, q.x)), hit.z - q.z};
+    return {hit.x - q.x, hit.y - q.y};
+}
+
+// Derivatives of the predicted position, by central differences
+void Jacobian(const Vector &p, const Hit &hit, double H[2][kDim])
+{
+    Vector steps = {1e-5, 1e-5, 1e-7, 1e-6 * std::abs(p[kKappa]) + 1e-11, 1e-7};
+    for (int j = 0; j < kDim; j++)
+    {
+        Vector plus = p, minus = p;
+        plus[j] += steps[j];
+        minus[j] -= steps[j];
+        auto rPlus = Residual(plus, hit), rMinus = Residual(minus, hit);
+        for (int i = 0; i < 2; i++) H[i][j] = (rMinus[i] - rPlus[i]) / (2 * steps[j]);
+    }
+}
+
+// Covariance added to the perigee parameters by multiple scattering in x0
+// radiation lengths a path s along the helix, on a barrel layer or a disc
+Matrix Scattering(const Vector &p, double s, bool barrel, double x0, const Options &options)
+{
+    Matrix Q{};
+    if (x0 <= 0. || p[kKappa] == 0.) return Q;
+
+    auto q = At(p, s);
+    double lambda = std::atan(p[kTanl]);
+    double momentum = kMeVPerTeslaMM * options.B / std::abs(p[kKappa]) / std::cos(lambda);
+    double beta = momentum / std::hypot(momentum, options.mass);
+
+    // Thickness over the cosine of the angle to the layer normal
+    double cosIncidence = barrel ? std::cos(lambda) * std::abs(std::cos(q.phi - std::atan2(q.y, q.x)))
+                                 : std::abs(std::sin(lambda));
+    double t = x0 / std::max(cosIncidence, 0.01);
+    // Highland formula
+    double theta0 = 13.6 / (beta * momentum) * std::sqrt(t) * (1 + 0.038 * std::log(t));
+
+    // Kinks of the direction in xy and in lambda, each of theta0 in space, at fixed momentum
+    auto kinked = [&](double dPhi, double dLambda) {
+        double l = lambda + dLambda;
+        return Through(q.x, q.y, q.z, q.phi + dPhi, std::tan(l), p[kKappa] * std::cos(lambda) / std::cos(l));
+    };
+    constexpr double h = 1e-6;
+    double variances[2] = {std::pow(theta0 / std::cos(lambda), 2), theta0 * theta0};
+    for (int angle = 0; angle < 2; angle++)
+    {
+        auto plus = angle == 0 ? kinked(h, 0.) : kinked(0., h);
+        auto minus = angle == 0 ? kinked(-h, 0.) : kinked(0., -h);
+        Vector J;
+        for (int i = 0; i < kDim; i++) J[i] = (plus[i] - minus[i]) / (2 * h);
+        for (int i = 0; i < kDim; i++)
+        {
+            for (int j = 0; j < kDim; j++) Q[i * kDim + j] += variances[angle] * J[i] * J[j];
+        }
+    }
+    return Q;
+}
+
+Matrix Multiply(const Matrix &a, const Matrix &b)
+{
+    Matrix c{};
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int k = 0; k < kDim; k++)
+        {
+            for (int j = 0; j < kDim; j++) c[i * kDim + j] += a[i * kDim + k] * b[k * kDim + j];
+        }
+    }
+    return c;
+}
+
+Matrix Transpose(const Matrix &a)
+{
+    Matrix t;
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < kDim; j++) t[i * kDim + j] = a[j * kDim + i];
+    }
+    return t;
+}
+
+// Inverse of a covariance matrix, in place. It is scaled to a unit diagonal
+// first, as the parameters' variances span many orders of magnitude.
+bool Invert(Matrix &m)
+{
+    double scale[kDim];
+    for (int i = 0; i < kDim; i++)
+    {
+        if (!(m[i * kDim + i] > 0.)) return false;
+        scale[i] = 1. / std::sqrt(m[i * kDim + i]);
+    }
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < kDim; j++) m[i * kDim + j] *= scale[i] * scale[j];
+    }
+
+    // Gauss-Jordan, positive definite so without pivoting
+    for (int k = 0; k < kDim; k++)
+    {
+        double pivot = m[k * kDim + k];
+        if (!(pivot > 0.)) return false;
+        m[k * kDim + k] = 1.;
+        for (int j = 0; j < kDim; j++) m[k * kDim + j] /= pivot;
+        for (int i = 0; i < kDim; i++)
+        {
+            if (i == k) continue;
+            double factor = m[i * kDim + k];
+            m[i * kDim + k] = 0.;
+            for (int j = 0; j < kDim; j++) m[i * kDim + j] -= factor * m[k * kDim + j];
+        }
+    }
+
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < kDim; j++) m[i * kDim + j] *= scale[i] * scale[j];
+    }
+    return true;
+}
+
+// Update of the state x and its covariance P with the residual r of a hit
+// measuring H x with the given variance in both coordinates. Returns the
+// chi2 of the residual.
+double Update(Vector &x, Matrix &P, const std::array<double, 2> &r, const double H[2][kDim], double variance)
+{
+    double PHt[kDim][2];
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            PHt[i][j] = 0.;
+            for (int k = 0; k < kDim; k++) PHt[i][j] += P[i * kDim + k] * H[j][k];
+        }
+    }
+    double S[2][2];
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            S[i][j] = i == j ? variance : 0.;
+            for (int k = 0; k < kDim; k++) S[i][j] += H[i][k] * PHt[k][j];
+        }
+    }
+    double determinant = S[0][0] * S[1][1] - S[0][1] * S[1][0];
+    double inverse[2][2] = {{S[1][1] / determinant, -S[0][1] / determinant},
+                            {-S[1][0] / determinant, S[0][0] / determinant}};
+
+    double K[kDim][2];
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < 2; j++) K[i][j] = PHt[i][0] * inverse[0][j] + PHt[i][1] * inverse[1][j];
+        x[i] += K[i][0] * r[0] + K[i][1] * r[1];
+    }
+
+    // Joseph form, which keeps P positive definite when a hit shrinks it by orders of magnitude
+    Matrix IKH;
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < kDim; j++) IKH[i * kDim + j] = (i == j) - K[i][0] * H[0][j] - K[i][1] * H[1][j];
+    }
+    P = Multiply(Multiply(IKH, P), Transpose(IKH));
+    for (int i = 0; i < kDim; i++)
+    {
+        for (int j = 0; j < kDim; j++) P[i * kDim + j] += variance * (K[i][0] * K[j][0] + K[i][1] * K[j][1]);
+    }
+
+    return r[0] * (inverse[0][0] * r[0] + inverse[0][1] * r[1]) + r[1] * (inverse[1][0] * r[0] + inverse[1][1] * r[1]);
+}
+
+// Per thread buffers, state k being the helix before hit k (state 0 at the vertex)
+struct Workspace {
+    std::vector<Hit> hits;
+    std::vector<Vector> predicted, filtered, smoothed;
+    std::vector<Matrix> predictedCov, filteredCov;
+};
+
+double FitTrack(const Material &material, const Options &options, std::size_t n, const double *x,
+                const double *y, const double *z, const std::int32_t *layerIDs,
+                HelixFit::Parameters &parameters, Workspace &w)
+{
+    double nan = std::nan("");
+    parameters = {nan, nan, nan, nan, nan};
+    if (n < 3) return nan;
+
+    auto seed = HelixFit::Fit(options.B, n, x, y, z);
+    if (!(seed.pT > 0.)) return nan;
+
+    // Hits in the order the track crosses them
+    auto &hits = w.hits;
+    hits.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        int layer = layerIDs[i];
+        double x0 = layer >= 0 && layer < static_cast<int>(material.layerX0.size()) ? material.layerX0[layer] : 0.;
+        hits[i] = {x[i], y[i], z[i], std::hypot(x[i], y[i]), HitSmearing::IsBarrel(layer), x0};
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+        return a.r * a.r + a.z * a.z < b.r * b.r + b.z * b.z;
+    });
+
+    // HelixFit gives the circle, and phi0 as if the track went round it
+    // counterclockwise; the sense of rotation is from the hits
+    double R = seed.pT / (kMeVPerTeslaMM * options.B);
+    double xc = -(seed.d0 + R) * std::sin(seed.phi0);
+    double yc = (seed.d0 + R) * std::cos(seed.phi0);
+    double turn = 0.;
+    for (std::size_t i = 1; i < n; i++)
+    {
+        turn += Wrap(std::atan2(hits[i].y - yc, hits[i].x - xc) - std::atan2(hits[i - 1].y - yc, hits[i - 1].x - xc));
+    }
+    double sense = turn < 0. ? -1. : 1.;
+    Vector state = {sense * seed.d0, seed.z0, sense > 0. ? seed.phi0 : seed.phi0 + kPi, sense / R, seed.tanl};
+
+    // Loose enough not to pull the fit
+    Matrix prior{};
+    double priorSigmas[kDim] = {10., 100., 0.5, 0.5 * std::abs(state[kKappa]) + 1e-5, 1.};
+    for (int i = 0; i < kDim; i++) prior[i * kDim + i] = priorSigmas[i] * priorSigmas[i];
+
+    w.predicted.resize(n + 1);
+    w.filtered.resize(n + 1);
+    w.smoothed.resize(n + 1);
+    w.predictedCov.resize(n + 1);
+    w.filteredCov.resize(n + 1);
+    double variance = options.resolution * options.resolution;
+
+    double chi2 = 0.;
+    for (int iteration = 0; iteration < 2; iteration++)
+    {
+        // The first pass is linearised about the filtered helix, the second about the smoothed one
+        w.filtered[0] = iteration == 0 ? state : w.smoothed[0];
+        w.filteredCov[0] = prior;
+        chi2 = 0.;
+        for (std::size_t k = 1; k <= n; k++)
+        {
+            const auto &reference = iteration == 0 ? w.filtered[k - 1] : w.smoothed[k];
+
+            // Scattering since the previous state: in the beam pipe before the
+            // first hit, then in the layer of the previous hit
+            Matrix Q{};
+            if (k == 1)
+            {
+                if (std::abs(reference[kD0]) < material.beamPipeRadius && hits[0].r > material.beamPipeRadius)
+                {
+                    Q = Scattering(reference, PathToRadius(reference, material.beamPipeRadius), true,
+                                   material.beamPipeX0, options);
+                }
+            }
+            else
+            {
+                const auto &hit = hits[k - 2];
+                Q = Scattering(reference, PathTo(reference, hit), hit.barrel, hit.x0, options);
+            }
+            w.predicted[k] = w.filtered[k - 1];
+            for (int i = 0; i < kDim * kDim; i++) w.predictedCov[k][i] = w.filteredCov[k - 1][i] + Q[i];
+
+            // The hit, linearised about the reference helix
+            const auto &hit = hits[k - 1];
+            double H[2][kDim];
+            Jacobian(reference, hit, H);
+            auto r = Residual(reference, hit);
+            for (int i = 0; i < 2; i++)
+            {
+                for (int j = 0; j < kDim; j++) r[i] -= H[i][j] * (w.predicted[k][j] - reference[j]);
+            }
+            w.filtered[k] = w.predicted[k];
+            w.filteredCov[k] = w.predictedCov[k];
+            chi2 += Update(w.filtered[k], w.filteredCov[k], r, H, variance);
+        }
+        if (!std::isfinite(chi2)) return nan;
+
+        // Rauch-Tung-Striebel smoother, back to the vertex
+        w.smoothed[n] = w.filtered[n];
+        for (std::size_t k = n; k-- > 0;)
+        {
+            Matrix inverse = w.predictedCov[k + 1];
+            if (!Invert(inverse)) return nan;
+            auto A = Multiply(w.filteredCov[k], inverse);
+            for (int i = 0; i < kDim; i++)
+            {
+                w.smoothed[k][i] = w.filtered[k][i];
+                for (int j = 0; j < kDim; j++)
+                {
+                    w.smoothed[k][i] += A[i * kDim + j] * (w.smoothed[k + 1][j] - w.predicted[k + 1][j]);
+                }
+            }
+        }
+    }
+
+    // Back to the parameters of HelixFit
+    const auto &vertex = w.smoothed[0];
+    R = 1. / std::abs(vertex[kKappa]);
+    double centre = vertex[kD0] + 1. / vertex[kKappa];
+    xc = -centre * std::sin(vertex[kPhi0]);
+    yc = centre * std::cos(vertex[kPhi0]);
+    parameters.d0 = std::hypot(xc, yc) - R;
+    parameters.z0 = vertex[kZ0];
+    parameters.phi0 = std::atan2(-xc, yc);
+    parameters.pT = kMeVPerTeslaMM * options.B * R;
+    parameters.tanl = vertex[kTanl];
+    return chi2;
+}
+
+}
+
+Material SVTMaterial(double width1, double width2, double width3)
+{
+    // Barrels then discs, as the layer IDs of DetectorConstruction. The
+    // copper supports pad each layer to its budget, the discs to width2.
+    Material material;
+    material.layerX0 = {width1, width1, width1, width2, width3};
+    material.layerX0.resize(material.layerX0.size() + 10, width2);
+    // 0.757 mm of beryllium at 31 mm
+    material.beamPipeRadius = 31. + 0.757 / 2;
+    material.beamPipeX0 = 0.757 / 352.8;
+    return material;
+}
+
+double Fit(const Material &material, const Options &options, std::size_t n, const double *x, const double *y,
+           const double *z, const std::int32_t *layerIDs, HelixFit::Parameters &parameters)
+{
+    Workspace workspace;
+    return FitTrack(material, options, n, x, y, z, layerIDs, parameters, workspace);
+}
+
+void FitTracks(const Material &material, const Options &options, std::size_t numTracks,
+               const std::int64_t *offsets, const double *x, const double *y, const double *z,
+               const std::int32_t *layerIDs, double *d0, double *z0, double *phi0, double *pT, double *tanl,
+               double *chi2, unsigned numThreads)
+{
+    auto fitRange = [&](std::size_t begin, std::size_t end) {
+        Workspace workspace;
+        for (std::size_t t = begin; t < end; t++)
+        {
+            auto first = offsets[t];
+            HelixFit::Parameters p;
+            chi2[t] = FitTrack(material, options, offsets[t + 1] - first, x + first, y + first, z + first,
+                               layerIDs + first, p, workspace);
+            d0[t] = p.d0;
+            z0[t] = p.z0;
+            phi0[t] = p.phi0;
+            pT[t] = p.pT;
+            tanl[t] = p.tanl;
+        }
+    };
+
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    // Not worth a thread for less than a few hundred tracks
+    numThreads = std::min<std::size_t>(numThreads, (numTracks + 255) / 256);
+    if (numThreads <= 1)
+    {
+        fitRange(0, numTracks);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numThreads; i++)
+    {
+        threads.emplace_back(fitRange, numTracks * i / numThreads, numTracks * (i + 1) / numThreads);
+    }
+    for (auto &thread : threads) thread.join();
+}
+
+}
+
+extern "C" {
+
+void b8_kalman_fit_tracks(double width1, double width2, double width3, double B, double resolution, double mass,
+                          std::size_t numTracks, const std::int64_t *offsets,
+                          const double *x, const double *y, const double *z, const std::int32_t *layerIDs,
+                          double *d0, double *z0, double *phi0, double *pT, double *tanl, double *chi2,
+                          unsigned numThreads)
+{
+    KalmanFit::Options options;
+    options.B = B;
+    options.resolution = resolution;
+    options.mass = mass;
+    KalmanFit::FitTracks(KalmanFit::SVTMaterial(width1, width2, width3), options, numTracks, offsets,
+                         x, y, z, layerIDs, d0, z0, phi0, pT, tanl, chi2, numThreads);
+}
+
+}
@@ -0,0 +1,377 @@
+#include "Resolution.hh"
+
+#include "CounterRNG.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace Resolution
+{
+
+const char *const kVariableNames[kNumVariables] = {"pT", "p", "d0", "z0", "phi0", "theta"};
+
+namespace
+{
+
+constexpr int kNumBins = 50;
+constexpr double kWindow = 2.;             // half width of the core, in sigma
+constexpr std::size_t kMinEntries = 20;    // to fit rather than take the seed
+constexpr int kMaxWindowSteps = 10;
+
+struct Gaussian {
+    double amplitude;       // counts per bin at the mean
+    double mean;
+    double sigma;
+};
+
+// Counts of the sorted values in kNumBins bins from lo to hi
+std::vector<double> Histogram(const std::vector<double> &sorted, double lo, double hi)
+{
+    std::vector<double> counts(kNumBins, 0.);
+    double width = (hi - lo) / kNumBins;
+    auto first = std::lower_bound(sorted.begin(), sorted.end(), lo);
+    auto last = std::lower_bound(first, sorted.end(), hi);
+    for (auto value = first; value != last; ++value)
+    {
+        int bin = std::min(kNumBins - 1, static_cast<int>((*value - lo) / width));
+        counts[bin] += 1.;
+    }
+    return counts;
+}
+
+double NegativeLogLikelihood(const std::vector<double> &counts, double lo, double width, const Gaussian &g)
+{
+    double nll = 0.;
+    for (int i = 0; i < kNumBins; i++)
+    {
+        double u = (lo + (i + 0.5) * width - g.mean) / g.sigma;
+        double expected = g.amplitude * std::exp(-0.5 * u * u);
+        nll += expected - (counts[i] > 0. ? counts[i] * std::log(expected) : 0.);
+    }
+    return nll;
+}
+
+// Binned Poisson maximum likelihood fit of a Gaussian to the counts of bins
+// from lo, starting from g. Fisher scoring in (log amplitude, mean, log
+// sigma), halving steps that do not improve the likelihood.
+bool FitHistogram(const std::vector<double> &counts, double lo, double width, Gaussian &g)
+{
+    double nll = NegativeLogLikelihood(counts, lo, width, g);
+    for (int iteration = 0; iteration < 100; iteration++)
+    {
+        double score[3] = {0., 0., 0.};
+        double fisher[3][3] = {};
+        for (int i = 0; i < kNumBins; i++)
+        {
+            double d = lo + (i + 0.5) * width - g.mean;
+            double u = d / g.sigma;
+            double expected = g.amplitude * std::exp(-0.5 * u * u);
+            if (!(expected > 0.)) continue;
+            double jacobian[3] = {expected, expected * d / (g.sigma * g.sigma), expected * u * u};
+            for (int a = 0; a < 3; a++)
+            {
+                score[a] += (counts[i] / expected - 1.) * jacobian[a];
+                for (int b = 0; b < 3; b++) fisher[a][b] += jacobian[a] * jacobian[b] / expected;
+            }
+        }
+
+        // Solve fisher * step = score by Cramer's rule
+        auto det = [](const double m[3][3]) {
+            return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                   - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                   + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        };
+        double determinant = det(fisher);
+        if (!(std::abs(determinant) > 0.)) return false;
+        double step[3];
+        for (int a = 0; a < 3; a++)
+        {
+            double m[3][3];
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++) m[r][c] = c == a ? score[r] : fisher[r][c];
+            step[a] = det(m) / determinant;
+        }
+
+        Gaussian next;
+        double nextNLL = nll;
+        double scale = 1.;
+        for (int halving = 0; halving < 30; halving++, scale *= 0.5)
+        {
+            next = {g.amplitude * std::exp(scale * step[0]), g.mean + scale * step[1],
+                    g.sigma * std::exp(scale * step[2])};
+            nextNLL = NegativeLogLikelihood(counts, lo, width, next);
+            if (nextNLL <= nll) break;
+        }
+        if (!(nextNLL <= nll)) return false;
+
+        bool converged = std::abs(next.mean - g.mean) < 1e-6 * next.sigma
+                         && std::abs(next.sigma - g.sigma) < 1e-6 * next.sigma;
+        g = next;
+        nll = nextNLL;
+        if (converged) return std::isfinite(g.sigma) && g.sigma > 0.;
+    }
+    return false;
+}
+
+double Quantile(const std::vector<double> &sorted, double q)
+{
+    // Linear interpolation, as np.percentile
+    double position = q * (sorted.size() - 1);
+    std::size_t i = static_cast<std::size_t>(position);
+    if (i + 1 >= sorted.size()) return sorted.back();
+    return sorted[i] + (position - i) * (sorted[i + 1] - sorted[i]);
+}
+
+double Poisson(B8Random::CounterRNG &rng, double mean)
+{
+    if (mean <= 0.) return 0.;
+    if (mean > 30.) return std::max(0., std::nearbyint(rng.Gauss(mean, std::sqrt(mean))));
+    double limit = std::exp(-mean), product = rng.Uniform();
+    int k = 0;
+    while (product > limit)
+    {
+        product *= rng.Uniform();
+        k++;
+    }
+    return k;
+}
+
+}
+
+void Residuals(const Track &t, double residuals[kNumVariables])
+{
+    double trueP = std::sqrt(t.pX * t.pX + t.pY * t.pY + t.pZ * t.pZ);
+    double truePT = std::hypot(t.pX, t.pY);
+    double fitP = t.pT * std::sqrt(1. + t.tanl * t.tanl);
+    double phiDifference = t.phi0 - std::atan2(t.pY, t.pX);
+
+    residuals[kPT] = 100. * (t.pT - truePT) / truePT;
+    residuals[kP] = 100. * (fitP - trueP) / trueP;
+    residuals[kD0] = t.d0;
+    residuals[kZ0] = t.z0;
+    residuals[kPhi0] = std::atan2(std::cos(phiDifference), std::sin(phiDifference));
+    residuals[kTheta] = std::atan2(1., t.tanl) - std::atan2(truePT, t.pZ);
+}
+
+void Samples::Fill(const Track &track)
+{
+    double p = std::sqrt(track.pX * track.pX + track.pY * track.pY + track.pZ * track.pZ);
+    double eta = std::atanh(track.pZ / p);
+
+    std::int64_t pBin;
+    if (fBinning.pEdges.empty()) pBin = std::llround(p);
+    else
+    {
+        const auto &edges = fBinning.pEdges;
+        if (!(p >= edges.front() && p < edges.back())) return;
+        pBin = std::upper_bound(edges.begin(), edges.end(), p) - edges.begin() - 1;
+    }
+
+    double residuals[kNumVariables];
+    Residuals(track, residuals);
+    fNumTracks++;
+
+    for (std::size_t b = 0; b < fBinning.etaEdges.size(); b++)
+    {
+        const auto &edges = fBinning.etaEdges[b];
+        if (!(eta >= edges.front() && eta < edges.back())) continue;
+        int etaBin = std::upper_bound(edges.begin(), edges.end(), eta) - edges.begin() - 1;
+
+        auto &cell = fCells[{static_cast<int>(b), etaBin, pBin, track.numHits}];
+        for (int v = 0; v < kNumVariables; v++) cell.residuals[v].push_back(residuals[v]);
+        cell.sumP += p;
+    }
+}
+
+void Samples::Merge(Samples &other)
+{
+    for (auto &[key, otherCell] : other.fCells)
+    {
+        auto &cell = fCells[key];
+        for (int v = 0; v < kNumVariables; v++)
+        {
+            auto &values = cell.residuals[v];
+            if (values.empty()) values.swap(otherCell.residuals[v]);
+            else values.insert(values.end(), otherCell.residuals[v].begin(), otherCell.residuals[v].end());
+        }
+        cell.sumP += otherCell.sumP;
+    }
+    fNumTracks += other.fNumTracks;
+    other.fCells.clear();
+    other.fNumTracks = 0;
+}
+
+CoreFit FitCore(std::vector<double> values, int numBootstraps, std::uint64_t seed)
+{
+    std::erase_if(values, [](double value) { return !std::isfinite(value); });
+    std::sort(values.begin(), values.end());
+
+    CoreFit fit{std::nan(""), std::nan(""), std::nan(""), std::nan(""), values.size(), 0, false};
+    if (values.empty()) return fit;
+
+    // Seed, and the result if the core cannot be fitted
+    Gaussian g{0., Quantile(values, 0.5), 0.5 * (Quantile(values, 0.84) - Quantile(values, 0.16))};
+    fit.mean = g.mean;
+    fit.sigma = g.sigma;
+    if (values.size() < kMinEntries || !(g.sigma > 0.)) return fit;
+
+    // Move the window to the fitted core until it settles
+    std::vector<double> counts;
+    double lo = 0., width = 0.;
+    bool fitted = false;
+    for (int step = 0; step < kMaxWindowSteps; step++)
+    {
+        lo = g.mean - kWindow * g.sigma;
+        width = 2 * kWindow * g.sigma / kNumBins;
+        counts = Histogram(values, lo, lo + kNumBins * width);
+        Gaussian previous = g;
+        g.amplitude = *std::max_element(counts.begin(), counts.end());
+        if (!(g.amplitude > 0.) || !FitHistogram(counts, lo, width, g)
+            || g.sigma > kNumBins * width || std::abs(g.mean - previous.mean) > kNumBins * width)
+        {
+            return fit;
+        }
+        fitted = true;
+        if (std::abs(g.mean - previous.mean) < 1e-3 * g.sigma && std::abs(g.sigma - previous.sigma) < 1e-3 * g.sigma)
+        {
+            break;
+        }
+    }
+    if (!fitted) return fit;
+
+    fit.mean = g.mean;
+    fit.sigma = g.sigma;
+    fit.fitted = true;
+    for (double count : counts) fit.coreEntries += count;
+
+    // Poisson resamplings of the final histogram, each refitted from g
+    double sumMean = 0., sumMean2 = 0., sumSigma = 0., sumSigma2 = 0.;
+    int numFitted = 0;
+    B8Random::CounterRNG rng(seed);
+    std::vector<double> resampled(kNumBins);
+    for (int b = 0; b < numBootstraps; b++)
+    {
+        for (int i = 0; i < kNumBins; i++) resampled[i] = Poisson(rng, counts[i]);
+        Gaussian replica = g;
+        if (!FitHistogram(resampled, lo, width, replica)) continue;
+        sumMean += replica.mean;
+        sumMean2 += replica.mean * replica.mean;
+        sumSigma += replica.sigma;
+        sumSigma2 += replica.sigma * replica.sigma;
+        numFitted++;
+    }
+    if (numFitted > 1)
+    {
+        double n = numFitted;
+        fit.meanError = std::sqrt(std::max(0., (sumMean2 - sumMean * sumMean / n) / (n - 1)));
+        fit.sigmaError = std::sqrt(std::max(0., (sumSigma2 - sumSigma * sumSigma / n) / (n - 1)));
+    }
+    return fit;
+}
+
+std::vector<Row> Extract(const std::vector<std::pair<std::string, Samples>> &configurations, bool byHits,
+                         int numBootstraps, std::uint64_t seed, unsigned numThreads)
+{
+    // One task per row: the cells whose residuals it fits
+    struct Task {
+        std::vector<const Samples::Cell *> cells;
+        Row row;
+    };
+    std::vector<Task> tasks;
+    for (const auto &[name, samples] : configurations)
+    {
+        const auto &binning = samples.GetBinning();
+        const auto &cells = samples.GetCells();
+        for (auto first = cells.begin(); first != cells.end();)
+        {
+            // The cells of one group differ only in NumHits, and are adjacent
+            auto [b, etaBin, pBin, numHits] = first->first;
+            auto last = first;
+            while (last != cells.end() && std::get<0>(last->first) == b && std::get<1>(last->first) == etaBin
+                   && std::get<2>(last->first) == pBin)
+            {
+                ++last;
+            }
+
+            Row row{name, binning.etaEdges[b][etaBin], binning.etaEdges[b][etaBin + 1], 0., 0., 0., 0, kPT, {}};
+            if (binning.pEdges.empty()) row.p = row.pLo = row.pHi = pBin;
+            else
+            {
+                row.pLo = binning.pEdges[pBin];
+                row.pHi = binning.pEdges[pBin + 1];
+            }
+
+            std::vector<std::pair<int, std::vector<const Samples::Cell *>>> groups;
+            groups.emplace_back(0, std::vector<const Samples::Cell *>{});
+            for (auto cell = first; cell != last; ++cell)
+            {
+                groups.front().second.push_back(&cell->second);
+                if (byHits) groups.emplace_back(std::get<3>(cell->first), std::vector{&cell->second});
+            }
+            for (const auto &[groupHits, groupCells] : groups)
+            {
+                double sumP = 0., n = 0.;
+                for (auto cell : groupCells)
+                {
+                    sumP += cell->sumP;
+                    n += cell->residuals[0].size();
+                }
+                row.numHits = groupHits;
+                if (!binning.pEdges.empty()) row.p = sumP / n;
+                for (int v = 0; v < kNumVariables; v++)
+                {
+                    row.variable = static_cast<Variable>(v);
+                    tasks.push_back({groupCells, row});
+                }
+            }
+            first = last;
+        }
+    }
+
+    // Tasks are taken in turn by the threads, as groups differ a lot in size
+    std::vector<Row> rows(tasks.size());
+    std::atomic<std::size_t> next = 0;
+    auto work = [&]() {
+        std::vector<double> values;
+        for (std::size_t i = next++; i < tasks.size(); i = next++)
+        {
+            const auto &task = tasks[i];
+            values.clear();
+            for (auto cell : task.cells)
+            {
+                const auto &residuals = cell->residuals[task.row.variable];
+                values.insert(values.end(), residuals.begin(), residuals.end());
+            }
+            rows[i] = task.row;
+            rows[i].fit = FitCore(values, numBootstraps, B8Random::Key({seed, i}));
+        }
+    };
+
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min<std::size_t>(numThreads, tasks.size());
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < numThreads; i++) threads.emplace_back(work);
+    work();
+    for (auto &thread : threads) thread.join();
+    return rows;
+}
+
+void WriteTable(std::ostream &out, const std::vector<Row> &rows)
+{
+    out << "configuration,eta_lo,eta_hi,p,p_lo,p_hi,NumHits,variable,entries,core_entries,"
+        << "mean,mean_error,sigma,sigma_error,fitted\n";
+    auto precision = out.precision(8);
+    for (const auto &row : rows)
+    {
+        const auto &fit = row.fit;
+        out << row.configuration << ',' << row.etaLo << ',' << row.etaHi << ',' << row.p << ',' << row.pLo << ','
+            << row.pHi << ',' << row.numHits << ',' << kVariableNames[row.variable] << ',' << fit.entries << ','
+            << fit.coreEntries << ',' << fit.mean << ',' << fit.meanError << ',' << fit.sigma << ','
+            << fit.sigmaError << ',' << (fit.fitted ? 1 : 0) << '\n';
+    }
+    out.precision(precision);
+}
+
+}